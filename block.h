@@ -0,0 +1,90 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include "mzd_additional.h"
+
+#include <stdalign.h>
+#include <string.h>
+
+/**
+ * Maximal number of words in a block, i.e. blocks hold up to 512 bits.
+ */
+#define BLOCK_MAX_WORDS 8
+#define BLOCK_MAX_BITS (BLOCK_MAX_WORDS * 64)
+
+/**
+ * Plain fixed-width vector used by the generic MPC implementation. In contrast
+ * to mzd_t there is neither a header nor a row pointer array, so blocks can be
+ * stored by value in arrays. Only the first width words are used, where width
+ * is the word count of the instance, i.e. 2, 3, 4 or 8 for the usual block
+ * sizes.
+ */
+typedef struct {
+  alignas(32) word w[BLOCK_MAX_WORDS];
+} block_t;
+
+/**
+ * Loads the first row of v into a block.
+ */
+static inline void block_load(block_t* res, mzd_t const* v) {
+  memcpy(res->w, CONST_FIRST_ROW(v), v->width * sizeof(word));
+}
+
+/**
+ * Stores a block to the first row of v. Excess bits are cleared.
+ */
+static inline void block_store(mzd_t* v, block_t const* val) {
+  word* row = FIRST_ROW(v);
+  memcpy(row, val->w, v->width * sizeof(word));
+  row[v->width - 1] &= v->high_bitmask;
+}
+
+static inline void block_xor(block_t* res, block_t const* first, block_t const* second,
+                             unsigned int width) {
+  for (unsigned int i = 0; i < width; ++i) {
+    res->w[i] = first->w[i] ^ second->w[i];
+  }
+}
+
+static inline void block_and(block_t* res, block_t const* first, block_t const* second,
+                             unsigned int width) {
+  for (unsigned int i = 0; i < width; ++i) {
+    res->w[i] = first->w[i] & second->w[i];
+  }
+}
+
+/**
+ * Shifts a block by count < 64 bits in the same direction as mzd_shift_left.
+ */
+static inline void block_shift_left(block_t* res, block_t const* val, unsigned int count,
+                                    unsigned int width) {
+  if (!count) {
+    *res = *val;
+    return;
+  }
+
+  const unsigned int right_count = 64 - count;
+  for (unsigned int i = width - 1; i; --i) {
+    res->w[i] = (val->w[i] << count) | (val->w[i - 1] >> right_count);
+  }
+  res->w[0] = val->w[0] << count;
+}
+
+/**
+ * Shifts a block by count < 64 bits in the same direction as mzd_shift_right.
+ */
+static inline void block_shift_right(block_t* res, block_t const* val, unsigned int count,
+                                     unsigned int width) {
+  if (!count) {
+    *res = *val;
+    return;
+  }
+
+  const unsigned int left_count = 64 - count;
+  for (unsigned int i = 0; i < width - 1; ++i) {
+    res->w[i] = (val->w[i] >> count) | (val->w[i + 1] << left_count);
+  }
+  res->w[width - 1] = val->w[width - 1] >> count;
+}
+
+#endif
@@ -24,6 +24,12 @@ static void commit_mzd(commitment_ctx* ctx, mzd_t const* v) {
   commitment_update(ctx, CONST_FIRST_ROW(v), sizeof(word) * v->width * v->nrows);
 }
 
+// The view of a party is a single matrix whose padding words are zero, so it is
+// committed to in one update.
+static void commit_view(commitment_ctx* ctx, mzd_t const* V) {
+  commitment_update(ctx, CONST_FIRST_ROW(V), sizeof(word) * V->rowstride * V->nrows);
+}
+
 #if COMMITMENT_LENGTH == SHA256_DIGEST_LENGTH
 #define hash_mzd commit_mzd
 #else
@@ -33,8 +39,7 @@ static void hash_mzd(SHA256_CTX* ctx, mzd_t const* v) {
 #endif
 
 void H(const unsigned char k[PRNG_KEYSIZE], mzd_t* y[SC_PROOF], const view_t* v, unsigned vidx,
-       unsigned vcnt, const unsigned char r[COMMITMENT_RAND_LENGTH],
-       unsigned char hash[COMMITMENT_LENGTH]) {
+       const unsigned char r[COMMITMENT_RAND_LENGTH], unsigned char hash[COMMITMENT_LENGTH]) {
   commitment_ctx ctx;
   commitment_init(&ctx);
   commitment_update(&ctx, k, PRNG_KEYSIZE);
@@ -42,17 +47,16 @@ void H(const unsigned char k[PRNG_KEYSIZE], mzd_t* y[SC_PROOF], const view_t* v,
   for (unsigned i = 0; i < SC_PROOF; ++i) {
     commit_mzd(&ctx, y[i]);
   }
-  for (unsigned i = 0; i < vcnt; ++i) {
-    commit_mzd(&ctx, v[i].s[vidx]);
-  }
+  commit_view(&ctx, v->s[vidx]);
 
   commitment_update(&ctx, r, COMMITMENT_RAND_LENGTH);
   commitment_final(hash, &ctx);
 }
 
-static void H3_compute(unsigned char hash[SHA256_DIGEST_LENGTH], unsigned char* ch) {
+static void H3_compute(unsigned char hash[SHA256_DIGEST_LENGTH], unsigned int num_rounds,
+                       unsigned char* ch) {
   // Pick bits from hash
-  unsigned char* eof      = ch + NUM_ROUNDS;
+  unsigned char* eof      = ch + num_rounds;
   unsigned int bitTracker = 0;
   while (ch < eof) {
     if (bitTracker >= SHA256_DIGEST_LENGTH * 8) {
@@ -71,49 +75,72 @@ static void H3_compute(unsigned char hash[SHA256_DIGEST_LENGTH], unsigned char*
   }
 }
 
-void fis_H3_verify(unsigned char const h[NUM_ROUNDS][2][COMMITMENT_LENGTH],
-                   unsigned char const hp[NUM_ROUNDS][COMMITMENT_LENGTH],
-                   unsigned char const ch_in[(NUM_ROUNDS + 3) / 4], const uint8_t* m, size_t m_len,
-                   unsigned char* ch) {
+void fis_H3_verify_init(SHA256_CTX* ctx) {
+  SHA256_Init(ctx);
+}
+
+void fis_H3_verify_update(SHA256_CTX* ctx, unsigned char const h[2][COMMITMENT_LENGTH],
+                          unsigned char const hp[COMMITMENT_LENGTH], unsigned int ch) {
+  switch (ch) {
+  case 0: {
+    SHA256_Update(ctx, h, 2 * COMMITMENT_LENGTH);
+    SHA256_Update(ctx, hp, COMMITMENT_LENGTH);
+    break;
+  }
+  case 1: {
+    SHA256_Update(ctx, hp, COMMITMENT_LENGTH);
+    SHA256_Update(ctx, h, 2 * COMMITMENT_LENGTH);
+    break;
+  }
+  default: {
+    SHA256_Update(ctx, h[1], COMMITMENT_LENGTH);
+    SHA256_Update(ctx, hp, COMMITMENT_LENGTH);
+    SHA256_Update(ctx, h[0], COMMITMENT_LENGTH);
+    break;
+  }
+  }
+}
+
+void fis_H3_verify_final(SHA256_CTX* ctx, unsigned int num_rounds, const uint8_t* m, size_t m_len,
+                         unsigned char* ch) {
+  fis_H3_final(ctx, num_rounds, m, m_len, ch);
+}
+
+void fis_H3_verify(unsigned char const h[][2][COMMITMENT_LENGTH],
+                   unsigned char const hp[][COMMITMENT_LENGTH], unsigned char const* ch_in,
+                   unsigned int num_rounds, const uint8_t* m, size_t m_len, unsigned char* ch) {
   SHA256_CTX ctx;
-  SHA256_Init(&ctx);
-
-  for (unsigned i = 0; i < NUM_ROUNDS; i++) {
-    switch (getChAt(ch_in, i)) {
-    case 0: {
-      SHA256_Update(&ctx, h[i], 2 * COMMITMENT_LENGTH);
-      SHA256_Update(&ctx, hp[i], COMMITMENT_LENGTH);
-      break;
-    }
-    case 1: {
-      SHA256_Update(&ctx, hp[i], COMMITMENT_LENGTH);
-      SHA256_Update(&ctx, h[i], 2 * COMMITMENT_LENGTH);
-      break;
-    }
-    default: {
-      SHA256_Update(&ctx, h[i][1], COMMITMENT_LENGTH);
-      SHA256_Update(&ctx, hp[i], COMMITMENT_LENGTH);
-      SHA256_Update(&ctx, h[i][0], COMMITMENT_LENGTH);
-      break;
-    }
-    }
+  fis_H3_verify_init(&ctx);
+
+  for (unsigned i = 0; i < num_rounds; i++) {
+    fis_H3_verify_update(&ctx, h[i], hp[i], getChAt(ch_in, i));
   }
-  SHA256_Update(&ctx, m, m_len);
 
-  unsigned char hash[SHA256_DIGEST_LENGTH];
-  SHA256_Final(hash, &ctx);
-  H3_compute(hash, ch);
+  fis_H3_verify_final(&ctx, num_rounds, m, m_len, ch);
 }
 
-void fis_H3(unsigned char const h[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH], const uint8_t* m,
-            size_t m_len, unsigned char* ch) {
+void fis_H3_init(SHA256_CTX* ctx, unsigned char const h[][SC_PROOF][COMMITMENT_LENGTH],
+                 unsigned int num_rounds) {
+  SHA256_Init(ctx);
+  SHA256_Update(ctx, h, SC_PROOF * COMMITMENT_LENGTH * num_rounds);
+}
+
+void fis_H3_update(SHA256_CTX* ctx, const uint8_t* m, size_t m_len) {
+  SHA256_Update(ctx, m, m_len);
+}
+
+void fis_H3_final(SHA256_CTX* ctx, unsigned int num_rounds, const uint8_t* m, size_t m_len,
+                  unsigned char* ch) {
+  SHA256_Update(ctx, m, m_len);
 
   unsigned char hash[SHA256_DIGEST_LENGTH];
-  SHA256_CTX ctx;
-  SHA256_Init(&ctx);
-  SHA256_Update(&ctx, h, SC_PROOF * COMMITMENT_LENGTH * NUM_ROUNDS);
-  SHA256_Update(&ctx, m, m_len);
-  SHA256_Final(hash, &ctx);
+  SHA256_Final(hash, ctx);
+  H3_compute(hash, num_rounds, ch);
+}
 
-  H3_compute(hash, ch);
+void fis_H3(unsigned char const h[][SC_PROOF][COMMITMENT_LENGTH], unsigned int num_rounds,
+            const uint8_t* m, size_t m_len, unsigned char* ch) {
+  SHA256_CTX ctx;
+  fis_H3_init(&ctx, h, num_rounds);
+  fis_H3_final(&ctx, num_rounds, m, m_len, ch);
 }
@@ -5,25 +5,43 @@
 #include "parameters.h"
 
 /**
- * Computes commitments to the view of an execution.
+ * Computes commitments to the view of party vidx of an execution.
  */
 void H(const unsigned char k[PRNG_KEYSIZE], mzd_t* y[SC_PROOF], view_t const* v, unsigned vidx,
-       unsigned vcnt, const unsigned char r[COMMITMENT_RAND_LENGTH],
-       unsigned char hash[COMMITMENT_LENGTH]);
+       const unsigned char r[COMMITMENT_RAND_LENGTH], unsigned char hash[COMMITMENT_LENGTH]);
 
 /**
- * Computes the challenge for Fish (when signing).
+ * Computes the challenge for Fish (when signing) for num_rounds repetitions.
  */
-void fis_H3(unsigned char const h[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH], const uint8_t* m,
-            size_t m_len, unsigned char* ch);
+void fis_H3(unsigned char const h[][SC_PROOF][COMMITMENT_LENGTH], unsigned int num_rounds,
+            const uint8_t* m, size_t m_len, unsigned char* ch);
 
 /**
- * Computes the challenge for Fish (when verifying).
+ * Incremental version of fis_H3: the message is absorbed in parts after all
+ * commitments.
  */
-void fis_H3_verify(unsigned char const h[NUM_ROUNDS][SC_VERIFY][COMMITMENT_LENGTH],
-                   unsigned char const hp[NUM_ROUNDS][COMMITMENT_LENGTH],
-                   unsigned char const ch_in[(NUM_ROUNDS + 3) / 4], const uint8_t* m, size_t m_len,
-                   unsigned char* ch);
+void fis_H3_init(SHA256_CTX* ctx, unsigned char const h[][SC_PROOF][COMMITMENT_LENGTH],
+                 unsigned int num_rounds);
+void fis_H3_update(SHA256_CTX* ctx, const uint8_t* m, size_t m_len);
+void fis_H3_final(SHA256_CTX* ctx, unsigned int num_rounds, const uint8_t* m, size_t m_len,
+                  unsigned char* ch);
+
+/**
+ * Computes the challenge for Fish (when verifying) for num_rounds repetitions.
+ */
+void fis_H3_verify(unsigned char const h[][SC_VERIFY][COMMITMENT_LENGTH],
+                   unsigned char const hp[][COMMITMENT_LENGTH], unsigned char const* ch_in,
+                   unsigned int num_rounds, const uint8_t* m, size_t m_len, unsigned char* ch);
+
+/**
+ * Incremental version of fis_H3_verify: the repetitions are absorbed one at a
+ * time and in order, the message comes last.
+ */
+void fis_H3_verify_init(SHA256_CTX* ctx);
+void fis_H3_verify_update(SHA256_CTX* ctx, unsigned char const h[SC_VERIFY][COMMITMENT_LENGTH],
+                          unsigned char const hp[COMMITMENT_LENGTH], unsigned int ch);
+void fis_H3_verify_final(SHA256_CTX* ctx, unsigned int num_rounds, const uint8_t* m, size_t m_len,
+                         unsigned char* ch);
 
 static inline unsigned int getChAt(unsigned char const* const ch, unsigned int i) {
   const unsigned int idx    = i >> 2;
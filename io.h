@@ -1,6 +1,18 @@
 #ifndef IO_H
 #define IO_H
 
+/**
+ * Serializes the first numbytes bytes of a row of a matrix with vec_len columns.
+ */
+void mzd_row_to_char_array(unsigned char* dst, word const* row, unsigned numbytes,
+                           unsigned vec_len);
+
+/**
+ * Deserializes len bytes into a row of a matrix with vec_len columns.
+ */
+void mzd_row_from_char_array(word* row, unsigned char const* data, unsigned len,
+                             unsigned vec_len);
+
 unsigned char* mzd_to_char_array(mzd_t* data, unsigned numbytes);
 
 mzd_t* mzd_from_char_array(unsigned char* data, unsigned len, unsigned vec_len);
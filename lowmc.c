@@ -1,4 +1,5 @@
 #include "lowmc.h"
+#include "lowmc_impl.h"
 #include "lowmc_pars.h"
 #include "mzd_additional.h"
 
@@ -6,7 +7,7 @@
 #include "simd.h"
 #endif
 
-static void sbox_layer_bitsliced(mzd_t* out, mzd_t* in, rci_t m, mask_t const* mask) {
+static void sbox_layer_bitsliced(mzd_t* out, mzd_t const* in, mask_t const* mask) {
   mzd_and(out, in, mask->mask);
 
   mzd_t* buffer[6] = {NULL};
@@ -44,7 +45,7 @@ static void sbox_layer_bitsliced(mzd_t* out, mzd_t* in, rci_t m, mask_t const* m
 
 #ifdef WITH_OPT
 #ifdef WITH_SSE2
-__attribute__((target("sse2"))) static void sbox_layer_sse(mzd_t* out, mzd_t* in,
+__attribute__((target("sse2"))) static void sbox_layer_sse(mzd_t* out, mzd_t const* in,
                                                            mask_t const* mask) {
   __m128i const* ip = __builtin_assume_aligned(CONST_FIRST_ROW(in), 16);
   __m128i const min = *ip;
@@ -91,7 +92,7 @@ __attribute__((target("sse2"))) static void sbox_layer_sse(mzd_t* out, mzd_t* in
  * AVX2 version of LowMC. It assumes that mzd_t's row[0] is always 32 byte
  * aligned.
  */
-__attribute__((target("avx2"))) static void sbox_layer_avx(mzd_t* out, mzd_t* in,
+__attribute__((target("avx2"))) static void sbox_layer_avx(mzd_t* out, mzd_t const* in,
                                                            mask_t const* mask) {
   __m256i const* ip = __builtin_assume_aligned(CONST_FIRST_ROW(in), 32);
   __m256i const min = *ip;
@@ -134,8 +135,49 @@ __attribute__((target("avx2"))) static void sbox_layer_avx(mzd_t* out, mzd_t* in
 #endif
 #endif
 
+// Encrypts p into x with the kernels of lowmc, y is used as temporary. With
+// round_keys, the expanded key is used instead of lowmc_key.
+static void lowmc_call_generic(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key,
+                               mzd_t* const* round_keys, mzd_t* x, mzd_t const* p, mzd_t* y) {
+  lowmc_kernels_t const* kernels = &lowmc->kernels;
+
+  mzd_local_copy(x, p);
+  if (round_keys) {
+    kernels->mzd.xor(x, x, round_keys[0]);
+  } else {
+#ifdef NOSCR
+    kernels->mzd.addmul_vl(x, lowmc_key, lowmc->k0_lookup);
+#else
+    kernels->mzd.addmul_v(x, lowmc_key, lowmc->k0_matrix);
+#endif
+  }
+
+  lowmc_round_t const* round = lowmc->rounds;
+  for (unsigned i = 0; i < lowmc->r; ++i, ++round) {
+    kernels->sbox_layer(y, x, &lowmc->mask);
+
+#ifdef NOSCR
+    kernels->mzd.mul_vl(x, y, round->l_lookup);
+#else
+    kernels->mzd.mul_v(x, y, round->l_matrix);
+#endif
+    if (round_keys) {
+      // the round keys include the constant
+      kernels->mzd.xor(x, x, round_keys[i + 1]);
+      continue;
+    }
+
+    kernels->mzd.xor(x, x, round->constant);
+#ifdef NOSCR
+    kernels->mzd.addmul_vl(x, lowmc_key, round->k_lookup);
+#else
+    kernels->mzd.addmul_v(x, lowmc_key, round->k_matrix);
+#endif
+  }
+}
+
 mzd_t* lowmc_call(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p) {
-  if (p->ncols > lowmc->n) {
+  if ((size_t)p->ncols > lowmc->n) {
     printf("p larger than block size!\n");
     return NULL;
   }
@@ -143,48 +185,152 @@ mzd_t* lowmc_call(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t cons
     printf("p needs to have exactly one row!\n");
   }
 
+  if (lowmc->impl && (size_t)p->ncols == lowmc->n) {
+    return lowmc->impl->lowmc_call(lowmc, lowmc_key, p);
+  }
+
   mzd_t* x = mzd_local_init_ex(1, lowmc->n, false);
   mzd_t* y = mzd_local_init_ex(1, lowmc->n, false);
 
-  mzd_local_copy(x, p);
+  lowmc_call_generic(lowmc, lowmc_key, NULL, x, p, y);
+
+  mzd_local_free(y);
+
+  return x;
+}
+
+// Encrypts block i with the expanded key round_keys[i], or round_keys[0] if
+// shared is set, or with keys[i] if round_keys is NULL. Groups of blocks are
+// distributed over the threads.
+static void lowmc_encrypt_blocks(lowmc_t const* lowmc, lowmc_key_t const* const* keys,
+                                 mzd_t* const* const* round_keys, bool shared, mzd_t* const* c,
+                                 mzd_t const* const* p, unsigned int count) {
+  if (lowmc->impl) {
+    const unsigned int groups = (count + LOWMC_IMPL_BATCH - 1) / LOWMC_IMPL_BATCH;
+#pragma omp parallel for
+    for (unsigned int g = 0; g < groups; ++g) {
+      const unsigned int i    = g * LOWMC_IMPL_BATCH;
+      const unsigned int size = count - i < LOWMC_IMPL_BATCH ? count - i : LOWMC_IMPL_BATCH;
+
+      mzd_t* const* rk[LOWMC_IMPL_BATCH];
+      for (unsigned int b = 0; round_keys && b < size; ++b) {
+        rk[b] = round_keys[shared ? 0 : i + b];
+      }
+      lowmc->impl->lowmc_call_batch(lowmc, keys ? keys + i : NULL, round_keys ? rk : NULL, c + i,
+                                    p + i, size);
+    }
+    return;
+  }
+
+#pragma omp parallel
+  {
+    mzd_t* y = mzd_local_init_ex(1, lowmc->n, false);
+#pragma omp for
+    for (unsigned int i = 0; i < count; ++i) {
+      mzd_t* const* rk = round_keys ? round_keys[shared ? 0 : i] : NULL;
+      lowmc_call_generic(lowmc, keys ? keys[i] : NULL, rk, c[i], p[i], y);
+    }
+    mzd_local_free(y);
+  }
+}
+
+bool lowmc_encrypt_batch(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t* const* c,
+                         mzd_t const* const* p, unsigned int count) {
+  if (!count) {
+    return true;
+  }
+
+  // the key schedule is shared by all blocks
+  mzd_t** round_keys = lowmc_expand_key(lowmc, lowmc_key);
+  if (!round_keys) {
+    return false;
+  }
+
+  mzd_t* const* const shared[1] = {round_keys};
+  lowmc_encrypt_blocks(lowmc, NULL, shared, true, c, p, count);
+  lowmc_round_keys_free(round_keys);
+  return true;
+}
+
+void lowmc_encrypt_batch_keys(lowmc_t const* lowmc, lowmc_key_t const* const* lowmc_keys,
+                              mzd_t* const* c, mzd_t const* const* p, unsigned int count) {
+  if (count) {
+    lowmc_encrypt_blocks(lowmc, lowmc_keys, NULL, false, c, p, count);
+  }
+}
+
+void lowmc_encrypt_batch_round_keys(lowmc_t const* lowmc, mzd_t* const* const* round_keys,
+                                    mzd_t* const* c, mzd_t const* const* p, unsigned int count) {
+  if (count) {
+    lowmc_encrypt_blocks(lowmc, NULL, round_keys, false, c, p, count);
+  }
+}
+
+bool lowmc_encrypt_ctr(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* iv,
+                       mzd_t* const* c, unsigned int count) {
+  for (unsigned int i = 0; i < count; ++i) {
+    mzd_local_copy(c[i], iv);
+    FIRST_ROW(c[i])[0] += i;
+  }
+  // the counter blocks are encrypted in place
+  return lowmc_encrypt_batch(lowmc, lowmc_key, c, (mzd_t const* const*)c, count);
+}
+
+mzd_t** lowmc_expand_key(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key) {
+  mzd_t** round_keys = malloc(sizeof(mzd_t*) * (lowmc->r + 1));
+  if (!round_keys) {
+    return NULL;
+  }
+  mzd_local_init_multiple_ex(round_keys, lowmc->r + 1, 1, lowmc->n, false);
+
+  lowmc_expand_key_into(lowmc, lowmc_key, round_keys);
+  return round_keys;
+}
+
+void lowmc_expand_key_into(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key,
+                           mzd_t* const* round_keys) {
+  lowmc_kernels_t const* kernels = &lowmc->kernels;
+
 #ifdef NOSCR
-  mzd_addmul_vl(x, lowmc_key, lowmc->k0_lookup);
+  kernels->mzd.mul_vl(round_keys[0], lowmc_key, lowmc->k0_lookup);
 #else
-  mzd_addmul_v(x, lowmc_key, lowmc->k0_matrix);
+  kernels->mzd.mul_v(round_keys[0], lowmc_key, lowmc->k0_matrix);
 #endif
 
   lowmc_round_t const* round = lowmc->rounds;
   for (unsigned i = 0; i < lowmc->r; ++i, ++round) {
+    mzd_t* rk = round_keys[i + 1];
+    mzd_local_copy(rk, round->constant);
+#ifdef NOSCR
+    kernels->mzd.addmul_vl(rk, lowmc_key, round->k_lookup);
+#else
+    kernels->mzd.addmul_v(rk, lowmc_key, round->k_matrix);
+#endif
+  }
+}
+
+void lowmc_round_keys_free(mzd_t** round_keys) {
+  if (round_keys) {
+    mzd_local_free_multiple(round_keys);
+    free(round_keys);
+  }
+}
+
+void lowmc_select_sbox_layer(lowmc_kernels_t* kernels, size_t n, unsigned int features) {
+  kernels->sbox_layer = sbox_layer_bitsliced;
 #ifdef WITH_OPT
 #ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2 && lowmc->n == 128) {
-      sbox_layer_sse(y, x, &lowmc->mask);
-    } else
+  if ((features & CPU_FEATURE_SSE2) && n == 128) {
+    kernels->sbox_layer = sbox_layer_sse;
+  }
 #endif
 #ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2 && lowmc->n == 256) {
-      sbox_layer_avx(y, x, &lowmc->mask);
-    } else
-#endif
-#endif
-    {
-      sbox_layer_bitsliced(y, x, lowmc->m, &lowmc->mask);
-    }
-
-#ifdef NOSCR
-    mzd_mul_vl(x, y, round->l_lookup);
-#else
-    mzd_mul_v(x, y, round->l_matrix);
+  if ((features & CPU_FEATURE_AVX2) && n == 256) {
+    kernels->sbox_layer = sbox_layer_avx;
+  }
 #endif
-    mzd_xor(x, x, round->constant);
-#ifdef NOSCR
-    mzd_addmul_vl(x, lowmc_key, round->k_lookup);
 #else
-    mzd_addmul_v(x, lowmc_key, round->k_matrix);
+  (void)n;
+  (void)features;
 #endif
-  }
-
-  mzd_local_free(y);
-
-  return x;
 }
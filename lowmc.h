@@ -13,4 +13,60 @@
  */
 mzd_t* lowmc_call(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p);
 
+/**
+ * Encrypts count blocks p[i] with block size n into the preallocated vectors
+ * c[i], which may be the same as p[i]. The key schedule is expanded once for
+ * all blocks. Several blocks are processed at once by the specialized
+ * implementations, and groups of blocks run in parallel with OpenMP.
+ *
+ * \return false if the memory for the key schedule could not be allocated
+ */
+bool lowmc_encrypt_batch(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t* const* c,
+                         mzd_t const* const* p, unsigned int count);
+
+/**
+ * Like lowmc_encrypt_batch, but block i is encrypted with lowmc_keys[i], e.g.
+ * to compute many public keys.
+ */
+void lowmc_encrypt_batch_keys(lowmc_t const* lowmc, lowmc_key_t const* const* lowmc_keys,
+                              mzd_t* const* c, mzd_t const* const* p, unsigned int count);
+
+/**
+ * Like lowmc_encrypt_batch, but block i is encrypted with the expanded key
+ * round_keys[i] (see lowmc_expand_key).
+ */
+void lowmc_encrypt_batch_round_keys(lowmc_t const* lowmc, mzd_t* const* const* round_keys,
+                                    mzd_t* const* c, mzd_t const* const* p, unsigned int count);
+
+/**
+ * Computes count blocks of the key stream of LowMC in CTR mode: c[i] is the
+ * encryption of iv with i added to its first word.
+ */
+bool lowmc_encrypt_ctr(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* iv,
+                       mzd_t* const* c, unsigned int count);
+
+/**
+ * Expands the key schedule: the first vector is K_0 * key, the vector i is
+ * K_i * key + C_i for the round key matrix K_i and the constant C_i of round
+ * i = 1, ..., r. Since the key schedule is linear, the round keys of the last
+ * share of a key shared with mzd_shared_share_from_keys can be derived from
+ * these and the round keys of the other shares (see mpc_lowmc_call).
+ *
+ * \return r + 1 vectors to be freed with lowmc_round_keys_free
+ */
+mzd_t** lowmc_expand_key(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key);
+
+/**
+ * Like lowmc_expand_key, but writes the r + 1 vectors to round_keys.
+ */
+void lowmc_expand_key_into(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key,
+                           mzd_t* const* round_keys);
+
+void lowmc_round_keys_free(mzd_t** round_keys);
+
+/**
+ * Selects the S-box layer of LowMC encryption for block size n.
+ */
+void lowmc_select_sbox_layer(lowmc_kernels_t* kernels, size_t n, unsigned int features);
+
 #endif
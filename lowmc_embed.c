@@ -0,0 +1,179 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "lowmc_pars.h"
+#include "randomness.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Generates a C source file containing LowMC instances as static const
+// tables. Each matrix starts with a prebuilt 64 byte header followed by the
+// aligned row data as with mzd_local_init, so the tables can be passed to all
+// mzd_local functions as long as they are not modified.
+
+static void write_mzd(FILE* out, const char* prefix, const char* name, mzd_t const* A) {
+  // The row pointers need relocations, so they are kept separate from the data
+  // to keep the latter in pages that can be shared.
+  fprintf(out, "static word* const %s_%s_rows[%d];\n", prefix, name, A->nrows);
+  fprintf(out, "static const struct {\n");
+  fprintf(out, "  embedded_header_t header;\n");
+  fprintf(out, "  word data[%d];\n", A->nrows * A->rowstride);
+  fprintf(out, "} %s_%s __attribute__((aligned(32))) = {\n", prefix, name);
+
+  fprintf(out, "    {{.nrows         = %d,\n", A->nrows);
+  fprintf(out, "      .ncols         = %d,\n", A->ncols);
+  fprintf(out, "      .width         = %d,\n", A->width);
+  fprintf(out, "      .rowstride     = %d,\n", A->rowstride);
+  fprintf(out, "      .flags         = 0x%02x,\n", A->flags);
+  fprintf(out, "      .high_bitmask  = UINT64_C(0x%016" PRIx64 "),\n", (uint64_t)A->high_bitmask);
+  fprintf(out, "      .rows          = (word**)%s_%s_rows}},\n", prefix, name);
+
+  fprintf(out, "    {");
+  for (rci_t i = 0; i < A->nrows; ++i) {
+    for (wi_t j = 0; j < A->rowstride; ++j) {
+      const uint64_t w = j < A->width ? A->rows[i][j] : 0;
+      fprintf(out, "%s0x%" PRIx64, j ? ", " : (i ? ",\n     " : ""), w);
+    }
+  }
+  fprintf(out, "}};\n");
+
+  fprintf(out, "static word* const %s_%s_rows[%d] = {\n    ", prefix, name, A->nrows);
+  for (rci_t i = 0; i < A->nrows; ++i) {
+    fprintf(out, "%s(word*)&%s_%s.data[%d]", i ? ",\n    " : "", prefix, name,
+            i * A->rowstride);
+  }
+  fprintf(out, "};\n\n");
+}
+
+static void write_instance(FILE* out, const char* prefix, lowmc_t const* lowmc) {
+  char name[64];
+
+  write_mzd(out, prefix, "x0", lowmc->mask.x0);
+  write_mzd(out, prefix, "x1", lowmc->mask.x1);
+  write_mzd(out, prefix, "x2", lowmc->mask.x2);
+  write_mzd(out, prefix, "mask", lowmc->mask.mask);
+  write_mzd(out, prefix, "k0_matrix", lowmc->k0_matrix);
+#ifdef NOSCR
+  write_mzd(out, prefix, "k0_lookup", lowmc->k0_lookup);
+#endif
+  for (unsigned int i = 0; i < lowmc->r; ++i) {
+    snprintf(name, sizeof(name), "k_matrix_%u", i);
+    write_mzd(out, prefix, name, lowmc->rounds[i].k_matrix);
+    snprintf(name, sizeof(name), "l_matrix_%u", i);
+    write_mzd(out, prefix, name, lowmc->rounds[i].l_matrix);
+    snprintf(name, sizeof(name), "constant_%u", i);
+    write_mzd(out, prefix, name, lowmc->rounds[i].constant);
+#ifdef NOSCR
+    snprintf(name, sizeof(name), "k_lookup_%u", i);
+    write_mzd(out, prefix, name, lowmc->rounds[i].k_lookup);
+    snprintf(name, sizeof(name), "l_lookup_%u", i);
+    write_mzd(out, prefix, name, lowmc->rounds[i].l_lookup);
+#endif
+  }
+
+  fprintf(out, "static lowmc_round_t %s_rounds[%zu] = {\n", prefix, lowmc->r);
+  for (unsigned int i = 0; i < lowmc->r; ++i) {
+    fprintf(out, "    {.k_matrix = (mzd_t*)&%s_k_matrix_%u.header,\n", prefix, i);
+    fprintf(out, "     .l_matrix = (mzd_t*)&%s_l_matrix_%u.header,\n", prefix, i);
+#ifdef NOSCR
+    fprintf(out, "     .k_lookup = (mzd_t*)&%s_k_lookup_%u.header,\n", prefix, i);
+    fprintf(out, "     .l_lookup = (mzd_t*)&%s_l_lookup_%u.header,\n", prefix, i);
+#endif
+    fprintf(out, "     .constant = (mzd_t*)&%s_constant_%u.header},\n", prefix, i);
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static lowmc_t %s = {\n", prefix);
+  fprintf(out, "    .m         = %zu,\n", lowmc->m);
+  fprintf(out, "    .n         = %zu,\n", lowmc->n);
+  fprintf(out, "    .r         = %zu,\n", lowmc->r);
+  fprintf(out, "    .k         = %zu,\n", lowmc->k);
+  fprintf(out, "    .mask      = {.x0   = (mzd_t*)&%s_x0.header,\n", prefix);
+  fprintf(out, "                  .x1   = (mzd_t*)&%s_x1.header,\n", prefix);
+  fprintf(out, "                  .x2   = (mzd_t*)&%s_x2.header,\n", prefix);
+  fprintf(out, "                  .mask = (mzd_t*)&%s_mask.header},\n", prefix);
+  fprintf(out, "    .k0_matrix = (mzd_t*)&%s_k0_matrix.header,\n", prefix);
+#ifdef NOSCR
+  fprintf(out, "    .k0_lookup = (mzd_t*)&%s_k0_lookup.header,\n", prefix);
+#endif
+  fprintf(out, "    .rounds    = %s_rounds,\n", prefix);
+  fprintf(out, "    .seeded    = %s,\n", lowmc->seeded ? "true" : "false");
+  fprintf(out, "    .seed      = {");
+  for (unsigned int i = 0; i < LOWMC_SEED_SIZE; ++i) {
+    fprintf(out, "%s0x%02x", i ? ", " : "", lowmc->seed[i]);
+  }
+  fprintf(out, "},\n");
+  fprintf(out, "    .storage   = LOWMC_STORAGE_STATIC,\n");
+  fprintf(out, "};\n\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("Usage ./lowmc_embed [Output file] [SBoxes-Blocksize-Rounds-Keysize]...\n");
+    return -1;
+  }
+
+  init_EVP();
+  init_rand_bytes();
+
+  FILE* out = fopen(argv[1], "w");
+  if (!out) {
+    printf("Failed to open %s.\n", argv[1]);
+    return -1;
+  }
+
+  fprintf(out, "// generated by lowmc_embed, do not edit\n\n");
+  fprintf(out, "#ifdef HAVE_CONFIG_H\n#include <config.h>\n#endif\n\n");
+  fprintf(out, "#include \"lowmc_pars.h\"\n\n");
+  fprintf(out, "#include <stdbool.h>\n#include <stdint.h>\n\n");
+#ifdef NOSCR
+  fprintf(out, "#ifndef NOSCR\n#error \"instances were generated with NOSCR\"\n#endif\n\n");
+#else
+  fprintf(out, "#ifdef NOSCR\n#error \"instances were generated without NOSCR\"\n#endif\n\n");
+#endif
+  fprintf(out, "typedef union {\n  mzd_t header;\n  unsigned char padding[64];\n} "
+               "embedded_header_t;\n\n");
+
+  int ret = 0;
+  for (int i = 2; i < argc; ++i) {
+    unsigned int m, n, r, k;
+    if (sscanf(argv[i], "%u-%u-%u-%u", &m, &n, &r, &k) != 4) {
+      printf("Invalid parameter set %s.\n", argv[i]);
+      ret = -1;
+      break;
+    }
+
+    // use the reference instance so that all builds embed the same instances
+    lowmc_t* lowmc = lowmc_init_from_seed(m, n, r, k, NULL);
+    if (!lowmc) {
+      ret = -1;
+      break;
+    }
+
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "lowmc_%u_%u_%u_%u", m, n, r, k);
+    write_instance(out, prefix, lowmc);
+    lowmc_free(lowmc);
+  }
+
+  fprintf(out, "lowmc_t* const lowmc_embedded_instances[] = {\n");
+  for (int i = 2; i < argc && !ret; ++i) {
+    unsigned int m, n, r, k;
+    sscanf(argv[i], "%u-%u-%u-%u", &m, &n, &r, &k);
+    fprintf(out, "    &lowmc_%u_%u_%u_%u,\n", m, n, r, k);
+  }
+  fprintf(out, "    NULL};\n");
+
+  if (fclose(out) || ret) {
+    remove(argv[1]);
+    ret = -1;
+  }
+
+  deinit_rand_bytes();
+  cleanup_EVP();
+
+  return ret;
+}
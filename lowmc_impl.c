@@ -0,0 +1,145 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "lowmc_impl.h"
+#include "mpc.h"
+#include "mzd_additional.h"
+
+#if defined(WITH_OPT) && defined(NOSCR)
+#include "simd.h"
+
+// Specialized implementations for the deployed parameter sets and, for all
+// other parameters, for the block sizes of 128 and 256 bits. They rely on the
+// lookup tables of NOSCR and on one vector holding a full block, so that each
+// row of a lookup table is a single vector.
+
+#define IMPL_CONCAT2(a, b) a##_##b
+#define IMPL_CONCAT(a, b) IMPL_CONCAT2(a, b)
+
+#ifdef WITH_SSE2
+#define IMPL_TYPE __m128i
+#define IMPL_TARGET "sse2"
+#define IMPL_ZERO _mm_setzero_si128
+#define IMPL_AND _mm_and_si128
+#define IMPL_XOR _mm_xor_si128
+#define IMPL_SHIFT_LEFT mm128_shift_left
+#define IMPL_SHIFT_RIGHT mm128_shift_right
+
+#define IMPL_M 10
+#define IMPL_N 128
+#define IMPL_R 20
+#define IMPL_K 128
+#define IMPL_SUFFIX 10_128_20_128
+#include "lowmc_impl_template.h"
+
+#define IMPL_M (lowmc->m)
+#define IMPL_N 128
+#define IMPL_R (lowmc->r)
+#define IMPL_K (lowmc->k)
+#define IMPL_SUFFIX 128
+#include "lowmc_impl_template.h"
+
+#undef IMPL_SHIFT_RIGHT
+#undef IMPL_SHIFT_LEFT
+#undef IMPL_XOR
+#undef IMPL_AND
+#undef IMPL_ZERO
+#undef IMPL_TARGET
+#undef IMPL_TYPE
+#endif
+
+#ifdef WITH_AVX2
+#define IMPL_TYPE __m256i
+#define IMPL_TARGET "avx2"
+#define IMPL_ZERO _mm256_setzero_si256
+#define IMPL_AND _mm256_and_si256
+#define IMPL_XOR _mm256_xor_si256
+#define IMPL_SHIFT_LEFT mm256_shift_left
+#define IMPL_SHIFT_RIGHT mm256_shift_right
+
+#define IMPL_M 10
+#define IMPL_N 256
+#define IMPL_R 38
+#define IMPL_K 256
+#define IMPL_SUFFIX 10_256_38_256
+#include "lowmc_impl_template.h"
+
+#define IMPL_M (lowmc->m)
+#define IMPL_N 256
+#define IMPL_R (lowmc->r)
+#define IMPL_K (lowmc->k)
+#define IMPL_SUFFIX 256
+#include "lowmc_impl_template.h"
+
+#undef IMPL_SHIFT_RIGHT
+#undef IMPL_SHIFT_LEFT
+#undef IMPL_XOR
+#undef IMPL_AND
+#undef IMPL_ZERO
+#undef IMPL_TARGET
+#undef IMPL_TYPE
+#endif
+
+#define IMPL_ENTRY(m, n, r, k, avx2)                                                               \
+  {                                                                                                \
+    m, n, r, k, avx2, lowmc_call_##m##_##n##_##r##_##k, lowmc_call_batch_##m##_##n##_##r##_##k,    \
+        mpc_lowmc_call_##m##_##n##_##r##_##k, mpc_lowmc_verify_##m##_##n##_##r##_##k               \
+  }
+
+#define IMPL_ENTRY_N(n, avx2)                                                                      \
+  {                                                                                                \
+    0, n, 0, 0, avx2, lowmc_call_##n, lowmc_call_batch_##n, mpc_lowmc_call_##n,                    \
+        mpc_lowmc_verify_##n                                                                       \
+  }
+
+// the parameter sets come first, they are preferred over the block sizes
+static const lowmc_impl_t impls[] = {
+#ifdef WITH_SSE2
+    IMPL_ENTRY(10, 128, 20, 128, false),
+#endif
+#ifdef WITH_AVX2
+    IMPL_ENTRY(10, 256, 38, 256, true),
+#endif
+#ifdef WITH_SSE2
+    IMPL_ENTRY_N(128, false),
+#endif
+#ifdef WITH_AVX2
+    IMPL_ENTRY_N(256, true),
+#endif
+    {0}};
+
+static bool impl_matches(unsigned int expected, size_t value) {
+  return !expected || expected == value;
+}
+
+lowmc_impl_t const* lowmc_find_impl(size_t m, size_t n, size_t r, size_t k,
+                                    unsigned int features) {
+  const unsigned int sse2 = features & CPU_FEATURE_SSE2, avx2 = features & CPU_FEATURE_AVX2;
+  for (lowmc_impl_t const* impl = impls; impl->n; ++impl) {
+    if (impl->n != n || !impl_matches(impl->m, m) || !impl_matches(impl->r, r) ||
+        !impl_matches(impl->k, k)) {
+      continue;
+    }
+    // the key is processed in full words
+    if (k % (8 * sizeof(word))) {
+      continue;
+    }
+    if ((impl->avx2 && !avx2) || !sse2) {
+      continue;
+    }
+    return impl;
+  }
+  return NULL;
+}
+#else
+lowmc_impl_t const* lowmc_find_impl(size_t m, size_t n, size_t r, size_t k,
+                                    unsigned int features) {
+  (void)m;
+  (void)n;
+  (void)r;
+  (void)k;
+  (void)features;
+  return NULL;
+}
+#endif
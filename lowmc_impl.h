@@ -0,0 +1,47 @@
+#ifndef LOWMC_IMPL_H
+#define LOWMC_IMPL_H
+
+#include "lowmc_pars.h"
+#include "mpc_lowmc.h"
+
+// number of blocks encrypted at once by lowmc_call_batch
+#define LOWMC_IMPL_BATCH 4
+
+/**
+ * LowMC encryption, the MPC prover and the MPC verifier specialized for one
+ * parameter set or one block size. The shares are kept in registers for the
+ * whole computation. If all dimensions are compile-time constants, the loops
+ * over words and rounds are unrolled as well.
+ */
+typedef struct lowmc_impl_s {
+  // m, r and k are 0 if the implementation supports any value
+  unsigned int m;
+  unsigned int n;
+  unsigned int r;
+  unsigned int k;
+  // set if the implementation requires AVX2
+  bool avx2;
+
+  mzd_t* (*lowmc_call)(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p);
+  // encrypts count <= LOWMC_IMPL_BATCH blocks, block i either with the
+  // expanded key round_keys[i] or, if round_keys is NULL, with keys[i]
+  void (*lowmc_call_batch)(lowmc_t const* lowmc, lowmc_key_t const* const* keys,
+                           mzd_t* const* const* round_keys, mzd_t* const* c,
+                           mzd_t const* const* p, unsigned int count);
+  mzd_t** (*mpc_lowmc_call)(lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
+                            view_t* view, mzd_t*** rvec, mzd_t* const* round_keys);
+  mzd_t** (*mpc_lowmc_verify)(lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
+                              view_t const* view, mzd_t*** rvec, unsigned int ch);
+} lowmc_impl_t;
+
+/**
+ * Looks up a specialized implementation for the given parameters that only
+ * uses the instruction set extensions in features (see cpu_feature_t).
+ *
+ * \return the implementation or NULL if the generic implementation has to be
+ *         used
+ */
+lowmc_impl_t const* lowmc_find_impl(size_t m, size_t n, size_t r, size_t k,
+                                    unsigned int features);
+
+#endif
@@ -0,0 +1,343 @@
+// Template for the specialized implementations in lowmc_impl.c, included once
+// per parameter set. The includer defines the parameters
+//
+//   IMPL_M, IMPL_N, IMPL_R, IMPL_K  the LowMC parameters
+//   IMPL_SUFFIX                     the suffix of the generated functions
+//
+// where IMPL_M, IMPL_R and IMPL_K may also be read from the instance lowmc,
+// and the vector operations
+//
+//   IMPL_TYPE, IMPL_TARGET, IMPL_ZERO, IMPL_AND, IMPL_XOR, IMPL_SHIFT_LEFT
+//   and IMPL_SHIFT_RIGHT
+//
+// where one vector holds exactly one block. The parameters are undefined at
+// the end.
+
+#define IMPL_NAME(name) IMPL_CONCAT(name, IMPL_SUFFIX)
+#define IMPL_WORDS (IMPL_N / (8 * sizeof(word)))
+#define IMPL_KEY_WORDS (IMPL_K / (8 * sizeof(word)))
+
+#define IMPL_FN __attribute__((target(IMPL_TARGET)))
+#define IMPL_INLINE __attribute__((__always_inline__, target(IMPL_TARGET)))
+
+static inline IMPL_TYPE IMPL_INLINE IMPL_NAME(load)(mzd_t const* v) {
+  return *(IMPL_TYPE const*)__builtin_assume_aligned(CONST_FIRST_ROW(v), sizeof(IMPL_TYPE));
+}
+
+static inline void IMPL_INLINE IMPL_NAME(store)(mzd_t* v, IMPL_TYPE val) {
+  *(IMPL_TYPE*)__builtin_assume_aligned(FIRST_ROW(v), sizeof(IMPL_TYPE)) = val;
+}
+
+// Computes c + v * A for the lookup table A of a matrix with 64 * words rows.
+// Each row of the lookup table is a single vector.
+static inline IMPL_TYPE IMPL_INLINE IMPL_NAME(addmul_vl)(IMPL_TYPE c, word const* v,
+                                                         unsigned int words, mzd_t const* A) {
+  IMPL_TYPE const* Aptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), sizeof(IMPL_TYPE));
+  for (unsigned int w = 0; w < words; ++w) {
+    word idx = v[w];
+    for (unsigned int s = 0; s < sizeof(word); ++s, idx >>= 8, Aptr += 256) {
+      c = IMPL_XOR(c, Aptr[idx & 0xff]);
+    }
+  }
+  return c;
+}
+
+static inline IMPL_TYPE IMPL_INLINE IMPL_NAME(mul_vl)(IMPL_TYPE c, IMPL_TYPE v, mzd_t const* A) {
+  word vw[IMPL_WORDS] __attribute__((aligned(sizeof(IMPL_TYPE))));
+  *(IMPL_TYPE*)vw = v;
+  return IMPL_NAME(addmul_vl)(c, vw, IMPL_WORDS, A);
+}
+
+// Computes c[b] + v[b] * A for LOWMC_IMPL_BATCH vectors. The lookups of the
+// vectors are interleaved, so that they do not wait for each other.
+static inline void IMPL_INLINE IMPL_NAME(addmul_vl_batch)(IMPL_TYPE* c, word const* const* v,
+                                                          unsigned int words, mzd_t const* A) {
+  IMPL_TYPE const* Aptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), sizeof(IMPL_TYPE));
+  for (unsigned int w = 0; w < words; ++w) {
+    for (unsigned int s = 0; s < 8 * sizeof(word); s += 8, Aptr += 256) {
+      for (unsigned int b = 0; b < LOWMC_IMPL_BATCH; ++b) {
+        c[b] = IMPL_XOR(c[b], Aptr[(v[b][w] >> s) & 0xff]);
+      }
+    }
+  }
+}
+
+typedef struct {
+  IMPL_TYPE x0;
+  IMPL_TYPE x1;
+  IMPL_TYPE x2;
+  IMPL_TYPE mask;
+} IMPL_NAME(mask_t);
+
+static inline void IMPL_INLINE IMPL_NAME(load_masks)(IMPL_NAME(mask_t) * masks,
+                                                     mask_t const* mask) {
+  masks->x0   = IMPL_NAME(load)(mask->x0);
+  masks->x1   = IMPL_NAME(load)(mask->x1);
+  masks->x2   = IMPL_NAME(load)(mask->x2);
+  masks->mask = IMPL_NAME(load)(mask->mask);
+}
+
+static inline IMPL_TYPE IMPL_INLINE IMPL_NAME(sbox)(IMPL_TYPE in, IMPL_NAME(mask_t) const* masks) {
+  IMPL_TYPE x0m = IMPL_SHIFT_LEFT(IMPL_AND(in, masks->x0), 2);
+  IMPL_TYPE x1m = IMPL_SHIFT_LEFT(IMPL_AND(in, masks->x1), 1);
+  IMPL_TYPE x2m = IMPL_AND(in, masks->x2);
+
+  IMPL_TYPE t0 = IMPL_AND(x1m, x2m);
+  IMPL_TYPE t1 = IMPL_AND(x0m, x2m);
+  IMPL_TYPE t2 = IMPL_AND(x0m, x1m);
+
+  t0  = IMPL_XOR(t0, x0m);
+  x0m = IMPL_XOR(x0m, x1m);
+  t1  = IMPL_XOR(t1, x0m);
+  t2  = IMPL_XOR(t2, x0m);
+  t2  = IMPL_XOR(t2, x2m);
+
+  IMPL_TYPE out = IMPL_AND(in, masks->mask);
+  out           = IMPL_XOR(out, t2);
+  out           = IMPL_XOR(out, IMPL_SHIFT_RIGHT(t1, 1));
+  return IMPL_XOR(out, IMPL_SHIFT_RIGHT(t0, 2));
+}
+
+// AND gates of all parties, the outputs are added to the view vector v.
+static inline void IMPL_INLINE IMPL_NAME(mpc_and)(IMPL_TYPE res[SC_PROOF],
+                                                  IMPL_TYPE const first[SC_PROOF],
+                                                  IMPL_TYPE const second[SC_PROOF],
+                                                  IMPL_TYPE const r[SC_PROOF],
+                                                  IMPL_TYPE v[SC_PROOF], unsigned int viewshift) {
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    const unsigned int j = (m + 1) % SC_PROOF;
+
+    IMPL_TYPE tmp = IMPL_AND(IMPL_XOR(second[m], second[j]), first[m]);
+    tmp           = IMPL_XOR(tmp, IMPL_AND(first[j], second[m]));
+    res[m]        = IMPL_XOR(tmp, IMPL_XOR(r[m], r[j]));
+    v[m]          = IMPL_XOR(v[m], IMPL_SHIFT_RIGHT(res[m], viewshift));
+  }
+}
+
+// AND gates of the first party, the share of the second party is read from its
+// view vector.
+static inline void IMPL_INLINE IMPL_NAME(mpc_and_verify)(
+    IMPL_TYPE res[SC_VERIFY], IMPL_TYPE const first[SC_VERIFY], IMPL_TYPE const second[SC_VERIFY],
+    IMPL_TYPE const r[SC_VERIFY], IMPL_TYPE v[SC_VERIFY], IMPL_TYPE mx2, unsigned int viewshift) {
+  IMPL_TYPE tmp = IMPL_AND(IMPL_XOR(second[0], second[1]), first[0]);
+  tmp           = IMPL_XOR(tmp, IMPL_AND(first[1], second[0]));
+  res[0]        = IMPL_XOR(tmp, IMPL_XOR(r[0], r[1]));
+  v[0]          = IMPL_XOR(v[0], IMPL_SHIFT_RIGHT(res[0], viewshift));
+  res[1]        = IMPL_AND(IMPL_SHIFT_LEFT(v[1], viewshift), mx2);
+}
+
+// S-box layer of the MPC prover (sc == SC_PROOF) or verifier (sc == SC_VERIFY).
+static inline void IMPL_INLINE IMPL_NAME(mpc_sbox)(IMPL_TYPE* out, IMPL_TYPE const* in,
+                                                   IMPL_TYPE* v, IMPL_TYPE const* rvec,
+                                                   IMPL_NAME(mask_t) const* masks,
+                                                   unsigned int sc) {
+  IMPL_TYPE r0m[SC_PROOF], r0s[SC_PROOF], r1m[SC_PROOF], r1s[SC_PROOF], r2m[SC_PROOF];
+  IMPL_TYPE x0s[SC_PROOF], x1s[SC_PROOF], x2m[SC_PROOF];
+
+  for (unsigned int m = 0; m < sc; ++m) {
+    x0s[m] = IMPL_SHIFT_LEFT(IMPL_AND(in[m], masks->x0), 2);
+    x1s[m] = IMPL_SHIFT_LEFT(IMPL_AND(in[m], masks->x1), 1);
+    x2m[m] = IMPL_AND(in[m], masks->x2);
+
+    r0m[m] = IMPL_AND(rvec[m], masks->x0);
+    r1m[m] = IMPL_AND(rvec[m], masks->x1);
+    r2m[m] = IMPL_AND(rvec[m], masks->x2);
+    r0s[m] = IMPL_SHIFT_LEFT(r0m[m], 2);
+    r1s[m] = IMPL_SHIFT_LEFT(r1m[m], 1);
+  }
+
+  if (sc == SC_PROOF) {
+    IMPL_NAME(mpc_and)(r0m, x0s, x1s, r2m, v, 0);
+    IMPL_NAME(mpc_and)(r2m, x1s, x2m, r0s, v, 2);
+    IMPL_NAME(mpc_and)(r1m, x0s, x2m, r1s, v, 1);
+  } else {
+    IMPL_NAME(mpc_and_verify)(r0m, x0s, x1s, r2m, v, masks->x2, 0);
+    IMPL_NAME(mpc_and_verify)(r2m, x1s, x2m, r0s, v, masks->x2, 2);
+    IMPL_NAME(mpc_and_verify)(r1m, x0s, x2m, r1s, v, masks->x2, 1);
+  }
+
+  for (unsigned int m = 0; m < sc; ++m) {
+    IMPL_TYPE tmp1 = IMPL_XOR(r2m[m], x0s[m]);
+    IMPL_TYPE tmp2 = IMPL_XOR(x0s[m], x1s[m]);
+    IMPL_TYPE tmp3 = IMPL_XOR(tmp2, r1m[m]);
+
+    IMPL_TYPE mout = IMPL_AND(masks->mask, in[m]);
+    mout           = IMPL_XOR(mout, IMPL_XOR(IMPL_XOR(tmp2, r0m[m]), x2m[m]));
+    mout           = IMPL_XOR(mout, IMPL_SHIFT_RIGHT(tmp1, 2));
+    out[m]         = IMPL_XOR(mout, IMPL_SHIFT_RIGHT(tmp3, 1));
+  }
+}
+
+// Runs the MPC of the prover (sc == SC_PROOF) or the verifier (sc == SC_VERIFY)
+// for challenge ch. The view rows of all parties but the last are written, the
+// last party's view is only read by the verifier. If round_keys is set, the
+// round keys of the last party are derived from those of the other parties.
+static inline void IMPL_INLINE IMPL_NAME(mpc_run)(lowmc_t const* lowmc,
+                                                  mpc_lowmc_key_t const* lowmc_key,
+                                                  mzd_t const* p, view_t const* view,
+                                                  mzd_t*** rvec, mzd_t* const* round_keys,
+                                                  unsigned int ch, unsigned int sc,
+                                                  IMPL_TYPE* x) {
+  IMPL_NAME(mask_t) masks;
+  IMPL_NAME(load_masks)(&masks, &lowmc->mask);
+  // shares of the constants are added by the first party and, when verifying,
+  // by the second opened party if the third one is the first party
+  const unsigned int const_share = ch == 0 ? 0 : (ch == sc ? sc - 1 : SC_PROOF);
+  const unsigned int out_views   = sc == SC_PROOF ? SC_PROOF : 1;
+
+  const unsigned int derived     = round_keys ? SC_PROOF - 1 : SC_PROOF;
+
+  word const* key[SC_PROOF];
+  for (unsigned int m = 0; m < sc; ++m) {
+    key[m] = CONST_FIRST_ROW(lowmc_key->shared[m]);
+    if (m == derived) {
+      x[m] = IMPL_XOR(IMPL_NAME(load)(round_keys[0]), IMPL_XOR(x[0], x[1]));
+    } else {
+      x[m] = IMPL_NAME(addmul_vl)(IMPL_ZERO(), key[m], IMPL_KEY_WORDS, lowmc->k0_lookup);
+    }
+  }
+  if (const_share < sc) {
+    x[const_share] = IMPL_XOR(x[const_share], IMPL_NAME(load)(p));
+  }
+
+  lowmc_round_t const* round = lowmc->rounds;
+  for (unsigned int i = 0; i < IMPL_R; ++i, ++round) {
+    IMPL_TYPE r[SC_PROOF], v[SC_PROOF], y[SC_PROOF];
+    IMPL_TYPE* vrow[SC_PROOF];
+    for (unsigned int m = 0; m < sc; ++m) {
+      r[m]    = IMPL_NAME(load)(rvec[m][i]);
+      vrow[m] = __builtin_assume_aligned(ROW(view->s[m], i + 1), sizeof(IMPL_TYPE));
+      v[m]    = *vrow[m];
+    }
+
+    IMPL_NAME(mpc_sbox)(y, x, v, r, &masks, sc);
+
+    // the round keys K_i * key + C_i include the constant, which is added by
+    // the first party when proving
+    IMPL_TYPE k[SC_PROOF];
+    for (unsigned int m = 0; m < sc; ++m) {
+      if (m < out_views) {
+        *vrow[m] = v[m];
+      }
+
+      if (m == derived) {
+        k[m] = IMPL_XOR(IMPL_NAME(load)(round_keys[i + 1]), IMPL_XOR(k[0], k[1]));
+      } else {
+        k[m] = m == const_share ? IMPL_NAME(load)(round->constant) : IMPL_ZERO();
+        k[m] = IMPL_NAME(addmul_vl)(k[m], key[m], IMPL_KEY_WORDS, round->k_lookup);
+      }
+      x[m] = IMPL_NAME(mul_vl)(k[m], y[m], round->l_lookup);
+    }
+  }
+}
+
+static mzd_t* IMPL_FN IMPL_NAME(lowmc_call)(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key,
+                                            mzd_t const* p) {
+  IMPL_NAME(mask_t) masks;
+  IMPL_NAME(load_masks)(&masks, &lowmc->mask);
+
+  word const* key = CONST_FIRST_ROW(lowmc_key);
+  IMPL_TYPE x     = IMPL_NAME(addmul_vl)(IMPL_NAME(load)(p), key, IMPL_KEY_WORDS, lowmc->k0_lookup);
+
+  lowmc_round_t const* round = lowmc->rounds;
+  for (unsigned int i = 0; i < IMPL_R; ++i, ++round) {
+    x = IMPL_NAME(mul_vl)(IMPL_NAME(load)(round->constant), IMPL_NAME(sbox)(x, &masks),
+                          round->l_lookup);
+    x = IMPL_NAME(addmul_vl)(x, key, IMPL_KEY_WORDS, round->k_lookup);
+  }
+
+  mzd_t* c = mzd_local_init_ex(1, IMPL_N, false);
+  IMPL_NAME(store)(c, x);
+  return c;
+}
+
+static void IMPL_FN IMPL_NAME(lowmc_call_batch)(lowmc_t const* lowmc,
+                                                lowmc_key_t const* const* keys,
+                                                mzd_t* const* const* round_keys, mzd_t* const* c,
+                                                mzd_t const* const* p, unsigned int count) {
+  IMPL_NAME(mask_t) masks;
+  IMPL_NAME(load_masks)(&masks, &lowmc->mask);
+
+  // the unused lanes repeat the last block
+  IMPL_TYPE x[LOWMC_IMPL_BATCH];
+  word const* key[LOWMC_IMPL_BATCH]  = {NULL};
+  mzd_t* const* rk[LOWMC_IMPL_BATCH] = {NULL};
+  for (unsigned int b = 0; b < LOWMC_IMPL_BATCH; ++b) {
+    const unsigned int idx = b < count ? b : count - 1;
+    x[b]                   = IMPL_NAME(load)(p[idx]);
+    if (round_keys) {
+      rk[b] = round_keys[idx];
+      x[b]  = IMPL_XOR(x[b], IMPL_NAME(load)(rk[b][0]));
+    } else {
+      key[b] = CONST_FIRST_ROW(keys[idx]);
+    }
+  }
+  if (!round_keys) {
+    IMPL_NAME(addmul_vl_batch)(x, key, IMPL_KEY_WORDS, lowmc->k0_lookup);
+  }
+
+  lowmc_round_t const* round = lowmc->rounds;
+  for (unsigned int i = 0; i < IMPL_R; ++i, ++round) {
+    word y[LOWMC_IMPL_BATCH][IMPL_WORDS] __attribute__((aligned(sizeof(IMPL_TYPE))));
+    word const* yp[LOWMC_IMPL_BATCH];
+    for (unsigned int b = 0; b < LOWMC_IMPL_BATCH; ++b) {
+      *(IMPL_TYPE*)y[b] = IMPL_NAME(sbox)(x[b], &masks);
+      yp[b]             = y[b];
+      // the round keys include the constant
+      x[b] = IMPL_NAME(load)(round_keys ? rk[b][i + 1] : round->constant);
+    }
+    IMPL_NAME(addmul_vl_batch)(x, yp, IMPL_WORDS, round->l_lookup);
+    if (!round_keys) {
+      IMPL_NAME(addmul_vl_batch)(x, key, IMPL_KEY_WORDS, round->k_lookup);
+    }
+  }
+
+  for (unsigned int b = 0; b < count; ++b) {
+    IMPL_NAME(store)(c[b], x[b]);
+  }
+}
+
+static mzd_t** IMPL_FN IMPL_NAME(mpc_lowmc_call)(lowmc_t const* lowmc,
+                                                 mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
+                                                 view_t* view, mzd_t*** rvec,
+                                                 mzd_t* const* round_keys) {
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    mzd_local_copy_to_row(view->s[m], 0, lowmc_key->shared[m]);
+  }
+
+  IMPL_TYPE x[SC_PROOF];
+  IMPL_NAME(mpc_run)(lowmc, lowmc_key, p, view, rvec, round_keys, 0, SC_PROOF, x);
+
+  mzd_t** res = mpc_init_empty_share_vector(IMPL_N, SC_PROOF);
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    IMPL_NAME(store)(res[m], x[m]);
+    mzd_local_copy_to_row(view->s[m], IMPL_R + 1, res[m]);
+  }
+  return res;
+}
+
+static mzd_t** IMPL_FN IMPL_NAME(mpc_lowmc_verify)(lowmc_t const* lowmc,
+                                                   mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
+                                                   view_t const* view, mzd_t*** rvec,
+                                                   unsigned int ch) {
+  IMPL_TYPE x[SC_PROOF];
+  IMPL_NAME(mpc_run)(lowmc, lowmc_key, p, view, rvec, NULL, ch, SC_VERIFY, x);
+
+  mzd_t** res = mpc_init_empty_share_vector(IMPL_N, SC_VERIFY);
+  for (unsigned int m = 0; m < SC_VERIFY; ++m) {
+    IMPL_NAME(store)(res[m], x[m]);
+    mzd_local_copy_to_row(view->s[m], IMPL_R + 1, res[m]);
+  }
+  return res;
+}
+
+#undef IMPL_INLINE
+#undef IMPL_FN
+#undef IMPL_KEY_WORDS
+#undef IMPL_WORDS
+#undef IMPL_NAME
+#undef IMPL_SUFFIX
+#undef IMPL_K
+#undef IMPL_R
+#undef IMPL_N
+#undef IMPL_M
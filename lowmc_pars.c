@@ -1,15 +1,34 @@
 #include "lowmc_pars.h"
+#include "lowmc.h"
+#include "lowmc_impl.h"
 #include "mpc.h"
+#include "mpc_lowmc.h"
 #include "mzd_additional.h"
 #include "randomness.h"
 
+#ifdef WITH_OPT
+#include "simd.h"
+#endif
+
 #include <m4ri/m4ri.h>
+#include <openssl/sha.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 static mask_t* prepare_masks(mask_t* mask, rci_t n, rci_t m) {
+  // The padding words have to be zero, since the SIMD S-box layers write the
+  // masked values with full width into the views.
   mask->x0   = mzd_local_init(1, n);
-  mask->x1   = mzd_local_init_ex(1, n, false);
-  mask->x2   = mzd_local_init_ex(1, n, false);
+  mask->x1   = mzd_local_init(1, n);
+  mask->x2   = mzd_local_init(1, n);
   mask->mask = mzd_local_init(1, n);
 
   const int bound = n - 3 * m;
@@ -25,23 +44,20 @@ static mask_t* prepare_masks(mask_t* mask, rci_t n, rci_t m) {
   return mask;
 }
 
-static mzd_t* mzd_sample_matrix_word(rci_t n, rci_t k, rci_t rank, bool with_xor) {
-  // use mzd_init for A since m4ri will work with it in mzd_echolonize
-  // also, this function cannot be parallelized as mzd_echolonize will call
-  // mzd_init and mzd_free at will causing various crashes.
-  mzd_t* A = mzd_init(n, k);
-  mzd_t* B = mzd_local_init_ex(n, k, false);
+static mzd_t* mzd_sample_matrix_word(rci_t n, rci_t k, rci_t rank, bool with_xor,
+                                     aes_prng_t* aes_prng) {
+  // mzd_local_rank is reentrant, so matrices can be sampled in parallel as long
+  // as every thread uses its own PRNG.
+  mzd_t* A = mzd_local_init_ex(n, k, false);
   do {
-    mzd_randomize_ssl(A);
+    mzd_randomize_aes_prng(A, aes_prng);
     if (with_xor) {
       for (rci_t i = 0; i < n; i++) {
         mzd_xor_bits(A, n - i - 1, (k + i + 1) % k, 1, 1);
       }
     }
-    mzd_local_copy(B, A);
-  } while (mzd_echelonize(A, 0) != rank);
-  mzd_free(A);
-  return B;
+  } while (mzd_local_rank(A) != rank);
+  return A;
 };
 
 /**
@@ -49,170 +65,857 @@ static mzd_t* mzd_sample_matrix_word(rci_t n, rci_t k, rci_t rank, bool with_xor
  *
  * \param n the blocksize
  */
-static mzd_t* mzd_sample_lmatrix(rci_t n) {
-  return mzd_sample_matrix_word(n, n, n, false);
+static mzd_t* mzd_sample_lmatrix(rci_t n, aes_prng_t* aes_prng) {
+  return mzd_sample_matrix_word(n, n, n, false, aes_prng);
 }
 
 /**
  * Samples the K matrix for the LowMC instance
  * \param n the blocksize
  */
-static mzd_t* mzd_sample_kmatrix(rci_t n, rci_t k) {
-  return mzd_sample_matrix_word(n, k, MIN(n, k), true);
+static mzd_t* mzd_sample_kmatrix(rci_t n, rci_t k, aes_prng_t* aes_prng) {
+  return mzd_sample_matrix_word(n, k, MIN(n, k), true, aes_prng);
 }
 
-lowmc_t* lowmc_init(size_t m, size_t n, size_t r, size_t k) {
-  if (n - 3 * m < 2) {
-    printf("Bitsliced implementation requires in->ncols - 3 * m >= 2\n");
-    return NULL;
-  }
+/**
+ * Samples a matrix of full rank from the Grain LFSR in the same order as the
+ * reference implementation. Since the reference multiplies matrices with column
+ * vectors, the sampled n x k matrix is stored transposed.
+ */
+static mzd_t* mzd_sample_matrix_grain(grain_ssg_t* grain, rci_t n, rci_t k) {
+  mzd_t* A = mzd_local_init(k, n);
+  do {
+    for (rci_t i = 0; i < n; ++i) {
+      for (rci_t j = 0; j < k; ++j) {
+        mzd_write_bit(A, j, i, grain_ssg_get_bit(grain));
+      }
+    }
+  } while (mzd_local_rank(A) != MIN(n, k));
+  return A;
+}
 
-  lowmc_t* ret = readFile(m, n, r, k);
-  if (ret) {
-    return ret;
+static mzd_t* mzd_sample_vector_grain(grain_ssg_t* grain, rci_t n) {
+  mzd_t* v = mzd_local_init(1, n);
+  for (rci_t i = 0; i < n; ++i) {
+    mzd_write_bit(v, 0, i, grain_ssg_get_bit(grain));
   }
+  return v;
+}
 
+static lowmc_t* lowmc_alloc(size_t m, size_t n, size_t r, size_t k) {
   lowmc_t* lowmc = calloc(sizeof(lowmc_t), 1);
   lowmc->m       = m;
   lowmc->n       = n;
   lowmc->r       = r;
   lowmc->k       = k;
+  lowmc->rounds  = calloc(sizeof(lowmc_round_t), r);
+  return lowmc;
+}
 
-  lowmc->k0_matrix = mzd_sample_kmatrix(k, n);
+static lowmc_t* lowmc_finalize(lowmc_t* lowmc) {
 #ifdef NOSCR
   lowmc->k0_lookup = mzd_precompute_matrix_lookup(lowmc->k0_matrix);
+#pragma omp parallel for
+  for (unsigned int i = 0; i < lowmc->r; ++i) {
+    lowmc->rounds[i].l_lookup = mzd_precompute_matrix_lookup(lowmc->rounds[i].l_matrix);
+    lowmc->rounds[i].k_lookup = mzd_precompute_matrix_lookup(lowmc->rounds[i].k_matrix);
+  }
 #endif
 
-  lowmc->rounds = calloc(sizeof(lowmc_round_t), r);
+  if (!prepare_masks(&lowmc->mask, lowmc->n, lowmc->m)) {
+    lowmc_free(lowmc);
+    return NULL;
+  }
+
+  return lowmc;
+}
+
+static lowmc_t* lowmc_generate(size_t m, size_t n, size_t r, size_t k) {
+  lowmc_t* lowmc = lowmc_alloc(m, n, r, k);
+
+  // Draw one PRNG key per round from the global (non thread-safe) PRNG, then
+  // sample the rounds in parallel.
+  unsigned char(*keys)[PRNG_KEYSIZE] = malloc((r + 1) * PRNG_KEYSIZE);
+  rand_bytes((unsigned char*)keys, (r + 1) * PRNG_KEYSIZE);
+
+  aes_prng_t aes_prng;
+  aes_prng_init(&aes_prng, keys[r]);
+  lowmc->k0_matrix = mzd_sample_kmatrix(k, n, &aes_prng);
+  aes_prng_clear(&aes_prng);
+
+#pragma omp parallel for private(aes_prng)
   for (unsigned int i = 0; i < r; ++i) {
-    lowmc->rounds[i].l_matrix = mzd_sample_lmatrix(n);
-    lowmc->rounds[i].k_matrix = mzd_sample_kmatrix(k, n);
-    lowmc->rounds[i].constant = mzd_init_random_vector(n);
+    aes_prng_init(&aes_prng, keys[i]);
+    lowmc->rounds[i].l_matrix = mzd_sample_lmatrix(n, &aes_prng);
+    lowmc->rounds[i].k_matrix = mzd_sample_kmatrix(k, n, &aes_prng);
+    lowmc->rounds[i].constant = mzd_init_random_vector_prng(n, &aes_prng);
+    aes_prng_clear(&aes_prng);
+  }
+  free(keys);
+
+  return lowmc_finalize(lowmc);
+}
 
+static lowmc_t* lowmc_derive(size_t m, size_t n, size_t r, size_t k,
+                             const unsigned char seed[LOWMC_SEED_SIZE]) {
+  grain_ssg_t grain;
+  if (!grain_ssg_init(&grain, seed)) {
+    return NULL;
+  }
+
+  lowmc_t* lowmc = lowmc_alloc(m, n, r, k);
+  lowmc->seeded  = true;
+  memcpy(lowmc->seed, seed, LOWMC_SEED_SIZE);
+
+  for (unsigned int i = 0; i < r; ++i) {
+    lowmc->rounds[i].l_matrix = mzd_sample_matrix_grain(&grain, n, n);
+  }
+  for (unsigned int i = 0; i < r; ++i) {
+    lowmc->rounds[i].constant = mzd_sample_vector_grain(&grain, n);
+  }
+  lowmc->k0_matrix = mzd_sample_matrix_grain(&grain, n, k);
+  for (unsigned int i = 0; i < r; ++i) {
+    lowmc->rounds[i].k_matrix = mzd_sample_matrix_grain(&grain, n, k);
+  }
+
+  return lowmc_finalize(lowmc);
+}
+
+// Instance cache
+
+#define LOWMC_CACHE_ENV "FISH_LOWMC_CACHE_DIR"
+// version 2: masks with cleared padding words
+#define LOWMC_FILE_VERSION 2
+
+static const unsigned char lowmc_file_magic[8] = {'F', 'I', 'S', 'H', 'L', 'M', 'C', '\0'};
+
+static char* cache_dir = NULL;
+
+void lowmc_set_cache_dir(const char* dir) {
+  free(cache_dir);
+  cache_dir = dir ? strdup(dir) : NULL;
+}
+
+static const char* get_cache_dir(void) {
+  if (cache_dir) {
+    return cache_dir;
+  }
+
+  const char* dir = getenv(LOWMC_CACHE_ENV);
+  return (dir && *dir) ? dir : ".";
+}
+
+void lowmc_fingerprint(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed,
+                       unsigned char fp[LOWMC_FINGERPRINT_SIZE]) {
+  // everything that changes the content or the in-memory layout of the stored
+  // instance goes into the fingerprint
+  const uint64_t pars[] = {LOWMC_FILE_VERSION, m, n, r, k, sizeof(word),
 #ifdef NOSCR
-    lowmc->rounds[i].l_lookup = mzd_precompute_matrix_lookup(lowmc->rounds[i].l_matrix);
-    lowmc->rounds[i].k_lookup = mzd_precompute_matrix_lookup(lowmc->rounds[i].k_matrix);
+                           1
+#else
+                           0
 #endif
+  };
+
+  unsigned char hash[SHA256_DIGEST_LENGTH];
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  SHA256_Update(&ctx, pars, sizeof(pars));
+  if (seed) {
+    SHA256_Update(&ctx, seed, LOWMC_SEED_SIZE);
   }
+  SHA256_Final(hash, &ctx);
 
-  if (!prepare_masks(&lowmc->mask, n, m)) {
-    lowmc_free(lowmc);
-    return NULL;
+  memcpy(fp, hash, LOWMC_FINGERPRINT_SIZE);
+}
+
+static char* instance_path(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed,
+                           const char* suffix) {
+  unsigned char fp[LOWMC_FINGERPRINT_SIZE];
+  lowmc_fingerprint(m, n, r, k, seed, fp);
+
+  char fp_hex[2 * LOWMC_FINGERPRINT_SIZE + 1];
+  for (unsigned int i = 0; i < LOWMC_FINGERPRINT_SIZE; ++i) {
+    sprintf(fp_hex + 2 * i, "%02x", fp[i]);
   }
 
-  writeFile(lowmc);
+  static const char format[] = "%s/%zu-%zu-%zu-%zu-%s%s";
 
-  return lowmc;
+  const char* dir = get_cache_dir();
+  const int len   = snprintf(NULL, 0, format, dir, m, n, r, k, fp_hex, suffix);
+  char* path      = malloc(len + 1);
+  snprintf(path, len + 1, format, dir, m, n, r, k, fp_hex, suffix);
+  return path;
+}
+
+static int lock_instance(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed,
+                         const char* suffix) {
+  mkdir(get_cache_dir(), 0755);
+
+  char* path = instance_path(m, n, r, k, seed, suffix);
+  int fd     = open(path, O_RDWR | O_CREAT, 0644);
+  free(path);
+  if (fd == -1) {
+    return -1;
+  }
+
+  struct flock fl = {.l_type = F_WRLCK, .l_whence = SEEK_SET};
+  while (fcntl(fd, F_SETLKW, &fl) == -1) {
+    if (errno != EINTR) {
+      close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
+
+static void unlock_instance(int fd) {
+  if (fd != -1) {
+    // closing the descriptor releases the lock
+    close(fd);
+  }
+}
+
+/**
+ * Checksummed stream used to (de)serialize instances.
+ */
+typedef struct {
+  FILE* file;
+  SHA256_CTX ctx;
+  bool ok;
+} instance_stream_t;
+
+static void stream_write(instance_stream_t* stream, void const* data, size_t size) {
+  if (stream->ok) {
+    SHA256_Update(&stream->ctx, data, size);
+    stream->ok = fwrite(data, size, 1, stream->file) == 1;
+  }
 }
 
-lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k) {
+static void stream_read(instance_stream_t* stream, void* data, size_t size) {
+  if (stream->ok) {
+    stream->ok = fread(data, size, 1, stream->file) == 1;
+    if (stream->ok) {
+      SHA256_Update(&stream->ctx, data, size);
+    }
+  }
+}
+
+static void write_mzd(instance_stream_t* stream, mzd_t const* matrix) {
+  stream_write(stream, &matrix->nrows, sizeof(rci_t));
+  stream_write(stream, &matrix->ncols, sizeof(rci_t));
 
-  lowmc_t* lowmc  = NULL;
-  char* file_name = calloc(20, sizeof(char));
-  sprintf(file_name, "%zu-%zu-%zu-%zu", m, n, r, k);
-  FILE* file = fopen(file_name, "r+");
+  for (rci_t i = 0; i < matrix->nrows; ++i) {
+    stream_write(stream, matrix->rows[i], matrix->rowstride * sizeof(word));
+  }
+}
+
+static mzd_t* read_mzd(instance_stream_t* stream, rci_t nrows, rci_t ncols) {
+  rci_t dims[2] = {0, 0};
+  stream_read(stream, &dims[0], sizeof(rci_t));
+  stream_read(stream, &dims[1], sizeof(rci_t));
+  if (!stream->ok || dims[0] != nrows || dims[1] != ncols) {
+    stream->ok = false;
+    return NULL;
+  }
+
+  mzd_t* A = mzd_local_init_ex(nrows, ncols, false);
+  for (rci_t i = 0; i < A->nrows; ++i) {
+    stream_read(stream, A->rows[i], A->rowstride * sizeof(word));
+  }
+  if (!stream->ok) {
+    mzd_local_free(A);
+    return NULL;
+  }
+
+  return A;
+}
+
+lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed) {
+  char* file_name = instance_path(m, n, r, k, seed, "");
+  FILE* file      = fopen(file_name, "rb");
   free(file_name);
-  if (file) {
-    lowmc = calloc(1, sizeof(lowmc_t));
+  if (!file) {
+    return NULL;
+  }
 
-    int ret = 0;
+  instance_stream_t stream = {.file = file, .ok = true};
+  SHA256_Init(&stream.ctx);
 
-    ret = fread(&lowmc->m, sizeof(lowmc->m), 1, file);
-    ret += fread(&lowmc->n, sizeof(lowmc->n), 1, file);
-    ret += fread(&lowmc->r, sizeof(lowmc->r), 1, file);
-    ret += fread(&lowmc->k, sizeof(lowmc->k), 1, file);
+  unsigned char magic[sizeof(lowmc_file_magic)];
+  uint32_t version = 0;
+  unsigned char fp[LOWMC_FINGERPRINT_SIZE], expected_fp[LOWMC_FINGERPRINT_SIZE];
+  stream_read(&stream, magic, sizeof(magic));
+  stream_read(&stream, &version, sizeof(version));
+  stream_read(&stream, fp, sizeof(fp));
 
-    if (lowmc->m != m || lowmc->n != n || lowmc->r != r || lowmc->k != k) {
-      printf("Error when reading file!\n");
-      return NULL;
+  lowmc_fingerprint(m, n, r, k, seed, expected_fp);
+  if (!stream.ok || memcmp(magic, lowmc_file_magic, sizeof(magic)) ||
+      version != LOWMC_FILE_VERSION || memcmp(fp, expected_fp, sizeof(fp))) {
+    fclose(file);
+    return NULL;
+  }
+
+  lowmc_t* lowmc = calloc(1, sizeof(lowmc_t));
+  if (seed) {
+    lowmc->seeded = true;
+    memcpy(lowmc->seed, seed, LOWMC_SEED_SIZE);
+  }
+  stream_read(&stream, &lowmc->m, sizeof(lowmc->m));
+  stream_read(&stream, &lowmc->n, sizeof(lowmc->n));
+  stream_read(&stream, &lowmc->r, sizeof(lowmc->r));
+  stream_read(&stream, &lowmc->k, sizeof(lowmc->k));
+
+  if (!stream.ok || lowmc->m != m || lowmc->n != n || lowmc->r != r || lowmc->k != k) {
+    printf("Error when reading file!\n");
+    fclose(file);
+    free(lowmc);
+    return NULL;
+  }
+
+  lowmc->mask.x0   = read_mzd(&stream, 1, n);
+  lowmc->mask.x1   = read_mzd(&stream, 1, n);
+  lowmc->mask.x2   = read_mzd(&stream, 1, n);
+  lowmc->mask.mask = read_mzd(&stream, 1, n);
+
+  lowmc->k0_matrix = read_mzd(&stream, k, n);
+#ifdef NOSCR
+  lowmc->k0_lookup = read_mzd(&stream, 32 * k, n);
+#endif
+  lowmc->rounds = calloc(r, sizeof(lowmc_round_t));
+  for (size_t i = 0; i < lowmc->r && stream.ok; ++i) {
+    lowmc->rounds[i].k_matrix = read_mzd(&stream, k, n);
+    lowmc->rounds[i].l_matrix = read_mzd(&stream, n, n);
+    lowmc->rounds[i].constant = read_mzd(&stream, 1, n);
+#ifdef NOSCR
+    lowmc->rounds[i].k_lookup = read_mzd(&stream, 32 * k, n);
+    lowmc->rounds[i].l_lookup = read_mzd(&stream, 32 * n, n);
+#endif
+  }
+
+  unsigned char checksum[SHA256_DIGEST_LENGTH], expected_checksum[SHA256_DIGEST_LENGTH];
+  SHA256_Final(expected_checksum, &stream.ctx);
+  const bool ok = stream.ok && fread(checksum, sizeof(checksum), 1, file) == 1 &&
+                  fgetc(file) == EOF && !memcmp(checksum, expected_checksum, sizeof(checksum));
+  fclose(file);
+
+  if (!ok) {
+    printf("Discarding corrupted LowMC instance file.\n");
+    lowmc_free(lowmc);
+    return NULL;
+  }
+
+  return lowmc;
+}
+
+/**
+ * Creates a temporary file next to file_name. Instances are written to a
+ * temporary file first and atomically renamed afterwards, so that readers never
+ * observe partially written instances.
+ */
+static FILE* create_temporary(const char* file_name, char** tmp_name) {
+  mkdir(get_cache_dir(), 0755);
+
+  *tmp_name = malloc(strlen(file_name) + sizeof(".XXXXXX"));
+  sprintf(*tmp_name, "%s.XXXXXX", file_name);
+
+  const int fd = mkstemp(*tmp_name);
+  FILE* file   = fd != -1 ? fdopen(fd, "wb") : NULL;
+  if (!file) {
+    if (fd != -1) {
+      close(fd);
+      unlink(*tmp_name);
     }
+    free(*tmp_name);
+    *tmp_name = NULL;
+  }
+  return file;
+}
+
+/**
+ * Closes the temporary file and renames it to file_name if ok is set.
+ * Otherwise the temporary file is removed.
+ */
+static bool publish_temporary(FILE* file, char* tmp_name, const char* file_name, bool ok) {
+  const int fd = fileno(file);
+  ok           = fflush(file) == 0 && ok;
+  ok           = fchmod(fd, 0644) == 0 && ok;
+  ok           = fsync(fd) == 0 && ok;
+  ok           = fclose(file) == 0 && ok;
+  ok           = ok && rename(tmp_name, file_name) == 0;
+  if (!ok) {
+    unlink(tmp_name);
+  }
+
+  free(tmp_name);
+  return ok;
+}
+
+bool writeFile(lowmc_t* lowmc) {
+  const unsigned char* seed = lowmc->seeded ? lowmc->seed : NULL;
+
+  char* file_name = instance_path(lowmc->m, lowmc->n, lowmc->r, lowmc->k, seed, "");
+  char* tmp_name  = NULL;
+  FILE* file      = create_temporary(file_name, &tmp_name);
+  if (!file) {
+    free(file_name);
+    return false;
+  }
+
+  instance_stream_t stream = {.file = file, .ok = true};
+  SHA256_Init(&stream.ctx);
+
+  unsigned char fp[LOWMC_FINGERPRINT_SIZE];
+  const uint32_t version = LOWMC_FILE_VERSION;
+  lowmc_fingerprint(lowmc->m, lowmc->n, lowmc->r, lowmc->k, seed, fp);
+
+  stream_write(&stream, lowmc_file_magic, sizeof(lowmc_file_magic));
+  stream_write(&stream, &version, sizeof(version));
+  stream_write(&stream, fp, sizeof(fp));
+
+  stream_write(&stream, &lowmc->m, sizeof(lowmc->m));
+  stream_write(&stream, &lowmc->n, sizeof(lowmc->n));
+  stream_write(&stream, &lowmc->r, sizeof(lowmc->r));
+  stream_write(&stream, &lowmc->k, sizeof(lowmc->k));
 
-    lowmc->mask.x0   = readMZD_TStructFromFile(file);
-    lowmc->mask.x1   = readMZD_TStructFromFile(file);
-    lowmc->mask.x2   = readMZD_TStructFromFile(file);
-    lowmc->mask.mask = readMZD_TStructFromFile(file);
+  write_mzd(&stream, lowmc->mask.x0);
+  write_mzd(&stream, lowmc->mask.x1);
+  write_mzd(&stream, lowmc->mask.x2);
+  write_mzd(&stream, lowmc->mask.mask);
 
-    lowmc->k0_matrix = readMZD_TStructFromFile(file);
+  write_mzd(&stream, lowmc->k0_matrix);
 #ifdef NOSCR
-    lowmc->k0_lookup = readMZD_TStructFromFile(file);
+  write_mzd(&stream, lowmc->k0_lookup);
 #endif
-    lowmc->rounds = calloc(r, sizeof(lowmc_round_t));
-    for (size_t i = 0; i < lowmc->r; ++i) {
-      lowmc->rounds[i].k_matrix = readMZD_TStructFromFile(file);
-      lowmc->rounds[i].l_matrix = readMZD_TStructFromFile(file);
-      lowmc->rounds[i].constant = readMZD_TStructFromFile(file);
+  for (size_t i = 0; i < lowmc->r; ++i) {
+    write_mzd(&stream, lowmc->rounds[i].k_matrix);
+    write_mzd(&stream, lowmc->rounds[i].l_matrix);
+    write_mzd(&stream, lowmc->rounds[i].constant);
 #ifdef NOSCR
-      lowmc->rounds[i].k_lookup = readMZD_TStructFromFile(file);
-      lowmc->rounds[i].l_lookup = readMZD_TStructFromFile(file);
+    write_mzd(&stream, lowmc->rounds[i].k_lookup);
+    write_mzd(&stream, lowmc->rounds[i].l_lookup);
 #endif
+  }
+
+  unsigned char checksum[SHA256_DIGEST_LENGTH];
+  SHA256_Final(checksum, &stream.ctx);
+  bool ok = stream.ok && fwrite(checksum, sizeof(checksum), 1, file) == 1;
+  ok      = publish_temporary(file, tmp_name, file_name, ok);
+
+  free(file_name);
+  return ok;
+}
+
+static lowmc_t* lowmc_load_or_create(size_t m, size_t n, size_t r, size_t k,
+                                     const unsigned char* seed) {
+  lowmc_t* lowmc = readFile(m, n, r, k, seed);
+  if (lowmc) {
+    return lowmc;
+  }
+
+  // Only one process generates a missing instance. All others wait for the
+  // lock and then load the instance published by the winner.
+  const int lock = lock_instance(m, n, r, k, seed, ".lock");
+  lowmc          = readFile(m, n, r, k, seed);
+  if (!lowmc) {
+    lowmc = seed ? lowmc_derive(m, n, r, k, seed) : lowmc_generate(m, n, r, k);
+    if (lowmc) {
+      writeFile(lowmc);
     }
-    fclose(file);
   }
+  unlock_instance(lock);
 
   return lowmc;
 }
 
-bool writeFile(lowmc_t* lowmc) {
+// Shared instance images
+//
+// An image contains all matrices of an instance in the layout of
+// mzd_local_init, but without row pointers: every matrix consists of a 64 byte
+// mzd_t header with rows set to NULL, followed by the row data. Since the image
+// is free of pointers, it can be mapped read-only by any number of processes
+// which then share one physical copy of the tables.
+
+#define LOWMC_SHARED_ENV "FISH_LOWMC_SHARED"
+#define LOWMC_IMAGE_VERSION 2
+#define LOWMC_IMAGE_ALIGNMENT 64
+
+static const unsigned char lowmc_image_magic[8] = {'F', 'I', 'S', 'H', 'I', 'M', 'G', '\0'};
+
+typedef struct {
+  unsigned char magic[8];
+  uint32_t version;
+  // guards against images written with a different m4ri version
+  uint32_t mzd_size;
+  unsigned char fp[LOWMC_FINGERPRINT_SIZE];
+  uint64_t m;
+  uint64_t n;
+  uint64_t r;
+  uint64_t k;
+  uint64_t size;
+} image_header_t;
+
+static_assert(sizeof(image_header_t) == LOWMC_IMAGE_ALIGNMENT, "unexpected image header size");
+
+typedef union {
+  mzd_t header;
+  unsigned char padding[LOWMC_IMAGE_ALIGNMENT];
+} image_mzd_t;
+
+static int shared = -1;
+
+void lowmc_set_shared(bool enable) {
+  shared = enable;
+}
+
+static bool use_shared(void) {
+  if (shared != -1) {
+    return shared;
+  }
+
+  const char* value = getenv(LOWMC_SHARED_ENV);
+  return value && *value && strcmp(value, "0");
+}
+
+static size_t image_mzd_size(rci_t nrows, wi_t rowstride) {
+  const size_t size = nrows * rowstride * sizeof(word);
+  return sizeof(image_mzd_t) + ((size + LOWMC_IMAGE_ALIGNMENT - 1) & ~(LOWMC_IMAGE_ALIGNMENT - 1));
+}
+
+static bool image_write_mzd(FILE* file, mzd_t const* A) {
+  static const unsigned char zero[LOWMC_IMAGE_ALIGNMENT] = {0};
+
+  image_mzd_t slot;
+  memset(&slot, 0, sizeof(slot));
+  slot.header        = *A;
+  slot.header.rows   = NULL;
+  slot.header.blocks = NULL;
+
+  bool ok = fwrite(&slot, sizeof(slot), 1, file) == 1;
+  for (rci_t i = 0; i < A->nrows && ok; ++i) {
+    ok = fwrite(A->rows[i], A->rowstride * sizeof(word), 1, file) == 1;
+  }
+
+  const size_t padding = image_mzd_size(A->nrows, A->rowstride) - sizeof(slot) -
+                         A->nrows * A->rowstride * sizeof(word);
+  return ok && (!padding || fwrite(zero, padding, 1, file) == 1);
+}
+
+/**
+ * Returns the matrix at the cursor if it has the expected dimensions and
+ * advances the cursor.
+ */
+static mzd_t* image_read_mzd(unsigned char** cursor, unsigned char const* end, rci_t nrows,
+                             rci_t ncols) {
+  if ((size_t)(end - *cursor) < sizeof(image_mzd_t)) {
+    return NULL;
+  }
+
+  mzd_t* A         = (mzd_t*)*cursor;
+  const wi_t width = (ncols + m4ri_radix - 1) / m4ri_radix;
+  // the SIMD kernels require aligned rows
+  const size_t alignment = width >= 4 ? 32 : 16;
+  if (A->nrows != nrows || A->ncols != ncols || A->width != width || A->rowstride < width ||
+      (A->rowstride * sizeof(word)) % alignment || A->rows || A->blocks) {
+    return NULL;
+  }
+
+  const size_t size = image_mzd_size(nrows, A->rowstride);
+  if ((size_t)(end - *cursor) < size) {
+    return NULL;
+  }
+
+  *cursor += size;
+  return A;
+}
+
+static bool write_image(lowmc_t const* lowmc) {
+  const unsigned char* seed = lowmc->seeded ? lowmc->seed : NULL;
+
+  mzd_t const* matrices[4 + 2 + 5 * lowmc->r];
+  unsigned int count = 0;
+  matrices[count++]  = lowmc->mask.x0;
+  matrices[count++]  = lowmc->mask.x1;
+  matrices[count++]  = lowmc->mask.x2;
+  matrices[count++]  = lowmc->mask.mask;
+  matrices[count++]  = lowmc->k0_matrix;
+#ifdef NOSCR
+  matrices[count++] = lowmc->k0_lookup;
+#endif
+  for (size_t i = 0; i < lowmc->r; ++i) {
+    matrices[count++] = lowmc->rounds[i].k_matrix;
+    matrices[count++] = lowmc->rounds[i].l_matrix;
+    matrices[count++] = lowmc->rounds[i].constant;
+#ifdef NOSCR
+    matrices[count++] = lowmc->rounds[i].k_lookup;
+    matrices[count++] = lowmc->rounds[i].l_lookup;
+#endif
+  }
+
+  image_header_t header = {.version  = LOWMC_IMAGE_VERSION,
+                           .mzd_size = sizeof(mzd_t),
+                           .m        = lowmc->m,
+                           .n        = lowmc->n,
+                           .r        = lowmc->r,
+                           .k        = lowmc->k,
+                           .size     = sizeof(image_header_t)};
+  memcpy(header.magic, lowmc_image_magic, sizeof(header.magic));
+  lowmc_fingerprint(lowmc->m, lowmc->n, lowmc->r, lowmc->k, seed, header.fp);
+  for (unsigned int i = 0; i < count; ++i) {
+    header.size += image_mzd_size(matrices[i]->nrows, matrices[i]->rowstride);
+  }
+
+  char* file_name = instance_path(lowmc->m, lowmc->n, lowmc->r, lowmc->k, seed, ".img");
+  char* tmp_name  = NULL;
+  FILE* file      = create_temporary(file_name, &tmp_name);
+  if (!file) {
+    free(file_name);
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (unsigned int i = 0; i < count && ok; ++i) {
+    ok = image_write_mzd(file, matrices[i]);
+  }
+  ok = publish_temporary(file, tmp_name, file_name, ok);
 
-  char* file_name = calloc(20, sizeof(char));
-  sprintf(file_name, "%zu-%zu-%zu-%zu", lowmc->m, lowmc->n, lowmc->r, lowmc->k);
-  FILE* file = fopen(file_name, "w");
   free(file_name);
-  if (file) {
-    fwrite(&lowmc->m, sizeof(lowmc->m), 1, file);
-    fwrite(&lowmc->n, sizeof(lowmc->n), 1, file);
-    fwrite(&lowmc->r, sizeof(lowmc->r), 1, file);
-    fwrite(&lowmc->k, sizeof(lowmc->k), 1, file);
+  return ok;
+}
+
+static lowmc_t* map_image(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed) {
+  char* file_name = instance_path(m, n, r, k, seed, ".img");
+  const int fd    = open(file_name, O_RDONLY);
+  free(file_name);
+  if (fd == -1) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(image_header_t)) {
+    close(fd);
+    return NULL;
+  }
+
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after closing the descriptor
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return NULL;
+  }
+
+  image_header_t const* header = mapping;
+  unsigned char expected_fp[LOWMC_FINGERPRINT_SIZE];
+  lowmc_fingerprint(m, n, r, k, seed, expected_fp);
+  if (memcmp(header->magic, lowmc_image_magic, sizeof(header->magic)) ||
+      header->version != LOWMC_IMAGE_VERSION || header->mzd_size != sizeof(mzd_t) ||
+      memcmp(header->fp, expected_fp, sizeof(expected_fp)) || header->m != m || header->n != n ||
+      header->r != r || header->k != k || header->size != (uint64_t)st.st_size) {
+    munmap(mapping, st.st_size);
+    return NULL;
+  }
 
-    writeMZD_TStructToFile(lowmc->mask.x0, file);
-    writeMZD_TStructToFile(lowmc->mask.x1, file);
-    writeMZD_TStructToFile(lowmc->mask.x2, file);
-    writeMZD_TStructToFile(lowmc->mask.mask, file);
+  lowmc_t* lowmc      = lowmc_alloc(m, n, r, k);
+  lowmc->storage      = LOWMC_STORAGE_MAPPED;
+  lowmc->mapping      = mapping;
+  lowmc->mapping_size = st.st_size;
+  if (seed) {
+    lowmc->seeded = true;
+    memcpy(lowmc->seed, seed, LOWMC_SEED_SIZE);
+  }
 
-    writeMZD_TStructToFile(lowmc->k0_matrix, file);
+  unsigned char* cursor    = (unsigned char*)mapping + sizeof(image_header_t);
+  unsigned char const* end = (unsigned char const*)mapping + st.st_size;
 
+  bool ok = (lowmc->mask.x0 = image_read_mzd(&cursor, end, 1, n));
+  ok      = ok && (lowmc->mask.x1 = image_read_mzd(&cursor, end, 1, n));
+  ok      = ok && (lowmc->mask.x2 = image_read_mzd(&cursor, end, 1, n));
+  ok      = ok && (lowmc->mask.mask = image_read_mzd(&cursor, end, 1, n));
+  ok      = ok && (lowmc->k0_matrix = image_read_mzd(&cursor, end, k, n));
 #ifdef NOSCR
-    writeMZD_TStructToFile(lowmc->k0_lookup, file);
+  ok = ok && (lowmc->k0_lookup = image_read_mzd(&cursor, end, 32 * k, n));
 #endif
-    for (size_t i = 0; i < lowmc->r; ++i) {
-      writeMZD_TStructToFile(lowmc->rounds[i].k_matrix, file);
-      writeMZD_TStructToFile(lowmc->rounds[i].l_matrix, file);
-      writeMZD_TStructToFile(lowmc->rounds[i].constant, file);
+  for (size_t i = 0; i < r && ok; ++i) {
+    lowmc_round_t* round = &lowmc->rounds[i];
+
+    ok = (round->k_matrix = image_read_mzd(&cursor, end, k, n));
+    ok = ok && (round->l_matrix = image_read_mzd(&cursor, end, n, n));
+    ok = ok && (round->constant = image_read_mzd(&cursor, end, 1, n));
 #ifdef NOSCR
-      writeMZD_TStructToFile(lowmc->rounds[i].k_lookup, file);
-      writeMZD_TStructToFile(lowmc->rounds[i].l_lookup, file);
+    ok = ok && (round->k_lookup = image_read_mzd(&cursor, end, 32 * k, n));
+    ok = ok && (round->l_lookup = image_read_mzd(&cursor, end, 32 * n, n));
 #endif
+  }
+
+  if (!ok || cursor != end) {
+    printf("Discarding corrupted LowMC instance image.\n");
+    lowmc_free(lowmc);
+    return NULL;
+  }
+
+  return lowmc;
+}
+
+static lowmc_t* lowmc_attach_image(size_t m, size_t n, size_t r, size_t k,
+                                   const unsigned char* seed) {
+  lowmc_t* lowmc = map_image(m, n, r, k, seed);
+  if (lowmc) {
+    return lowmc;
+  }
+
+  // As for the instance files, only one process creates a missing image.
+  const int lock = lock_instance(m, n, r, k, seed, ".img.lock");
+  lowmc          = map_image(m, n, r, k, seed);
+  if (!lowmc) {
+    lowmc_t* tmp = lowmc_load_or_create(m, n, r, k, seed);
+    if (tmp && write_image(tmp)) {
+      lowmc = map_image(m, n, r, k, seed);
+    }
+    if (tmp) {
+      lowmc_free(tmp);
     }
-    fclose(file);
   }
+  unlock_instance(lock);
 
-  return false;
+  return lowmc;
 }
 
-void writeMZD_TStructToFile(mzd_t* matrix, FILE* file) {
+static lowmc_t* lowmc_instance(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed) {
+  if (n - 3 * m < 2) {
+    printf("Bitsliced implementation requires in->ncols - 3 * m >= 2\n");
+    return NULL;
+  }
+  if (n > BLOCK_MAX_BITS) {
+    printf("Block sizes larger than %d bits are not supported\n", BLOCK_MAX_BITS);
+    return NULL;
+  }
+
+  if (use_shared()) {
+    lowmc_t* lowmc = lowmc_attach_image(m, n, r, k, seed);
+    if (lowmc) {
+      return lowmc;
+    }
+    // fall back to a private copy of the instance
+  }
+
+  return lowmc_load_or_create(m, n, r, k, seed);
+}
 
-  fwrite(&(matrix->nrows), sizeof(rci_t), 1, file);
-  fwrite(&(matrix->ncols), sizeof(rci_t), 1, file);
+// Kernel selection
 
-  for (int i = 0; i < matrix->nrows; i++) {
-    fwrite((matrix->rows[i]), matrix->rowstride * sizeof(word), 1, file);
+#define LOWMC_KERNELS_ENV "FISH_LOWMC_KERNELS"
+
+static unsigned int cpu_features(void) {
+  unsigned int features = 0;
+#ifdef WITH_OPT
+#ifdef WITH_SSE2
+  if (CPU_SUPPORTS_SSE2) {
+    features |= CPU_FEATURE_SSE2;
+  }
+#endif
+#ifdef WITH_AVX2
+  if (CPU_SUPPORTS_AVX2) {
+    features |= CPU_FEATURE_AVX2;
+  }
+#endif
+#endif
+
+  // the override can only take away features
+  const char* value = getenv(LOWMC_KERNELS_ENV);
+  if (!value || !*value || !strcmp(value, "avx2")) {
+    return features;
+  }
+  if (!strcmp(value, "sse2")) {
+    return features & CPU_FEATURE_SSE2;
   }
+  if (!strcmp(value, "generic")) {
+    return 0;
+  }
+
+  printf("Unknown value of " LOWMC_KERNELS_ENV ": %s\n", value);
+  return features;
 }
 
-mzd_t* readMZD_TStructFromFile(FILE* file) {
+static lowmc_t* lowmc_select_kernels(lowmc_t* lowmc) {
+  if (!lowmc) {
+    return NULL;
+  }
 
-  int ret       = 0;
-  int nrows     = 0;
-  int ncols     = 0;
-  ret += fread(&(nrows), sizeof(rci_t), 1, file);
-  ret += fread(&(ncols), sizeof(rci_t), 1, file);
+  lowmc_kernels_t* kernels = &lowmc->kernels;
+  kernels->features        = cpu_features();
 
-  mzd_t* A = mzd_local_init_ex(nrows, ncols, false);
-  for (int i = 0; i < A->nrows; i++) {
-    ret += fread((A->rows[i]), A->rowstride * sizeof(word), 1, file);
+  // the SIMD matrix kernels require row counts that are multiples of 64
+  const unsigned int mzd_features =
+      (lowmc->n % 64 || lowmc->k % 64) ? 0 : kernels->features;
+  mzd_select_kernels(&kernels->mzd, lowmc->n, mzd_features);
+  lowmc_select_sbox_layer(kernels, lowmc->n, kernels->features);
+  mpc_lowmc_select_sbox_layers(kernels, lowmc->n, kernels->features);
+
+  lowmc->impl = lowmc_find_impl(lowmc->m, lowmc->n, lowmc->r, lowmc->k, kernels->features);
+  return lowmc;
+}
+
+#ifdef WITH_EMBEDDED_INSTANCES
+// NULL terminated list written by lowmc_embed
+extern lowmc_t* const lowmc_embedded_instances[];
+
+static pthread_once_t embedded_once = PTHREAD_ONCE_INIT;
+
+// The embedded instances are shared by all callers, so their kernels are
+// selected exactly once.
+static void embedded_select_kernels(void) {
+  for (lowmc_t* const* lowmc = lowmc_embedded_instances; *lowmc; ++lowmc) {
+    lowmc_select_kernels(*lowmc);
   }
+}
 
-  return A;
+lowmc_t* lowmc_embedded_instance(size_t m, size_t n, size_t r, size_t k) {
+  pthread_once(&embedded_once, embedded_select_kernels);
+
+  for (lowmc_t* const* lowmc = lowmc_embedded_instances; *lowmc; ++lowmc) {
+    if ((*lowmc)->m == m && (*lowmc)->n == n && (*lowmc)->r == r && (*lowmc)->k == k) {
+      return *lowmc;
+    }
+  }
+  return NULL;
+}
+#else
+lowmc_t* lowmc_embedded_instance(size_t m, size_t n, size_t r, size_t k) {
+  (void)m;
+  (void)n;
+  (void)r;
+  (void)k;
+  return NULL;
+}
+#endif
+
+lowmc_t* lowmc_init(size_t m, size_t n, size_t r, size_t k) {
+  lowmc_t* lowmc = lowmc_embedded_instance(m, n, r, k);
+  if (lowmc) {
+    return lowmc;
+  }
+
+  return lowmc_select_kernels(lowmc_instance(m, n, r, k, NULL));
+}
+
+lowmc_t* lowmc_init_from_seed(size_t m, size_t n, size_t r, size_t k,
+                              const unsigned char seed[LOWMC_SEED_SIZE]) {
+  static const unsigned char reference_seed[LOWMC_SEED_SIZE] = {
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+  if (!seed) {
+    seed = reference_seed;
+  }
+
+  bool nonzero = false;
+  for (unsigned int i = 0; i < LOWMC_SEED_SIZE; ++i) {
+    nonzero |= seed[i] != 0;
+  }
+  if (!nonzero) {
+    printf("Grain LFSR requires a non-zero seed\n");
+    return NULL;
+  }
+
+  return lowmc_select_kernels(lowmc_instance(m, n, r, k, seed));
 }
 
 lowmc_key_t* lowmc_keygen(lowmc_t* lowmc) {
@@ -220,6 +923,16 @@ lowmc_key_t* lowmc_keygen(lowmc_t* lowmc) {
 }
 
 void lowmc_free(lowmc_t* lowmc) {
+  if (lowmc->storage == LOWMC_STORAGE_STATIC) {
+    return;
+  }
+  if (lowmc->storage == LOWMC_STORAGE_MAPPED) {
+    munmap(lowmc->mapping, lowmc->mapping_size);
+    free(lowmc->rounds);
+    free(lowmc);
+    return;
+  }
+
   for (unsigned i = 0; i < lowmc->r; ++i) {
 #ifdef NOSCR
     mzd_local_free(lowmc->rounds[i].k_lookup);
@@ -2,10 +2,13 @@
 #define LOWMC_PARS_H
 
 #include "mzd_additional.h"
+#include "randomness.h"
 #include <m4ri/m4ri.h>
 
 typedef mzd_t lowmc_key_t;
 
+#define LOWMC_SEED_SIZE GRAIN_SEED_SIZE
+
 typedef struct {
   mzd_t* x0;
   mzd_t* x1;
@@ -24,6 +27,35 @@ typedef struct {
 #endif
 } lowmc_round_t;
 
+/**
+ * Kernels of a LowMC instance, selected once for its parameters and the
+ * instruction set extensions of the CPU when the instance is created.
+ */
+typedef struct {
+  // instruction set extensions the kernels use (see cpu_feature_t)
+  unsigned int features;
+  mzd_kernels_t mzd;
+
+  void (*sbox_layer)(mzd_t* out, mzd_t const* in, mask_t const* mask);
+  // S-box layers of the MPC prover and verifier
+  void (*mpc_sbox_layer)(mzd_t** out, mzd_t* const* in, word* const* view, mzd_t* const* rvec,
+                         mask_t const* mask);
+  void (*mpc_sbox_layer_verify)(mzd_t** out, mzd_t* const* in, word* const* view,
+                                mzd_t* const* rvec, mask_t const* mask);
+} lowmc_kernels_t;
+
+/**
+ * Describes who owns the memory of a LowMC instance.
+ */
+typedef enum {
+  // matrices are allocated with mzd_local_init and freed by lowmc_free
+  LOWMC_STORAGE_HEAP,
+  // instance is embedded in the binary and must not be freed
+  LOWMC_STORAGE_STATIC,
+  // matrices live in a read-only shared mapping and have no row pointers
+  LOWMC_STORAGE_MAPPED,
+} lowmc_storage_t;
+
 /**
  * Represents the LowMC parameters as in https://bitbucket.org/malb/lowmc-helib/src,
  * with the difference that key in a separate struct
@@ -41,10 +73,27 @@ typedef struct {
   mzd_t* k0_lookup;
 #endif
   lowmc_round_t* rounds;
+
+  lowmc_kernels_t kernels;
+  // specialized implementation for the parameters or NULL (see lowmc_impl.h)
+  struct lowmc_impl_s const* impl;
+
+  // set if the instance was derived from a seed
+  bool seeded;
+  unsigned char seed[LOWMC_SEED_SIZE];
+
+  lowmc_storage_t storage;
+  void* mapping;
+  size_t mapping_size;
 } lowmc_t;
 
 /**
- * Generates a new LowMC instance (also including a key)
+ * Generates a new LowMC instance (also including a key). Instances embedded at
+ * build time are returned directly. All other instances are cached in the
+ * directory set with lowmc_set_cache_dir. The kernels for the parameters and
+ * the CPU, including a specialized implementation if one is available, are
+ * attached to the instance. Setting FISH_LOWMC_KERNELS to generic, sse2 or
+ * avx2 limits the instruction set extensions the kernels may use.
  *
  * \param m the number of sboxes
  * \param n the blocksize
@@ -55,6 +104,34 @@ typedef struct {
  */
 lowmc_t* lowmc_init(size_t m, size_t n, size_t r, size_t k);
 
+/**
+ * Derives a LowMC instance deterministically from a seed. As in the LowMC
+ * reference implementation, the Grain LFSR is used to sample the r linear layer
+ * matrices, the r round constants and the r + 1 key matrices in this order.
+ * Matrices are resampled until they have full rank. Derived instances are
+ * cached like instances created with lowmc_init.
+ *
+ * \param m the number of sboxes
+ * \param n the blocksize
+ * \param r the number of rounds
+ * \param k the keysize
+ * \param seed the initial Grain state, or NULL for the state used by the reference
+ *
+ * \return parameters defining a LowMC instance
+ */
+lowmc_t* lowmc_init_from_seed(size_t m, size_t n, size_t r, size_t k,
+                              const unsigned char seed[LOWMC_SEED_SIZE]);
+
+/**
+ * Looks up an instance embedded at build time (see WITH_EMBEDDED_INSTANCES).
+ * The embedded instances are the ones lowmc_init_from_seed derives from the
+ * reference seed. Their kernels are selected once on the first lookup and
+ * they are shared by all callers; lowmc_free ignores them.
+ *
+ * \return the instance or NULL if no matching instance is embedded
+ */
+lowmc_t* lowmc_embedded_instance(size_t m, size_t n, size_t r, size_t k);
+
 lowmc_key_t* lowmc_keygen(lowmc_t* lowmc);
 
 /**
@@ -80,8 +157,51 @@ void lowmc_key_free(lowmc_key_t* lowmc_key);
  */
 void lowmc_secret_share(lowmc_t* lowmc, lowmc_key_t* lowmc_key);
 
-lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k);
+#define LOWMC_FINGERPRINT_SIZE 8
+
+/**
+ * Sets the directory used to cache generated LowMC instances. If dir is NULL,
+ * the directory given in the FISH_LOWMC_CACHE_DIR environment variable is used,
+ * or the current working directory if that is not set either.
+ *
+ * \param dir the cache directory
+ */
+void lowmc_set_cache_dir(const char* dir);
+
+/**
+ * Lets lowmc_init attach to a shared, read-only image of the instance instead of
+ * loading a private copy. The image is stored next to the cached instances and
+ * created on first use; point the cache directory to /dev/shm to keep it in
+ * shared memory. If not called, sharing is enabled by setting the environment
+ * variable FISH_LOWMC_SHARED to 1.
+ *
+ * Matrices of shared instances have no row pointers and thus can only be used
+ * with the mzd_local_* functions.
+ */
+void lowmc_set_shared(bool enable);
+
+/**
+ * Computes the fingerprint identifying a cached LowMC instance.
+ *
+ * \param seed the seed of derived instances or NULL for sampled instances
+ * \param fp   receives the fingerprint
+ */
+void lowmc_fingerprint(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed,
+                       unsigned char fp[LOWMC_FINGERPRINT_SIZE]);
+
+/**
+ * Loads a LowMC instance from the cache directory. The file is validated
+ * against the fingerprint of the parameters and its checksum.
+ *
+ * \return the instance or NULL if no valid instance is cached
+ */
+lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed);
+
+/**
+ * Stores a LowMC instance in the cache directory. The instance is written to a
+ * temporary file and atomically renamed afterwards.
+ *
+ * \return true on success
+ */
 bool writeFile(lowmc_t* lowmc);
-void writeMZD_TStructToFile(mzd_t* matrix, FILE* file);
-mzd_t* readMZD_TStructFromFile(FILE* file);
 #endif
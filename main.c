@@ -51,9 +51,10 @@ static void print_detailed_timings(timing_and_size_t* timings, unsigned int iter
 
 #endif
 
-static void parse_args(int params[5], int argc, char** argv) {
-  if (argc != 6) {
-    printf("Usage ./mpc_lowmc [Number of SBoxes] [Blocksize] [Rounds] [Keysize] [Numiter]\n");
+static void parse_args(int params[6], int argc, char** argv) {
+  if (argc != 6 && argc != 7) {
+    printf("Usage ./mpc_lowmc [Number of SBoxes] [Blocksize] [Rounds] [Keysize] [Numiter] "
+           "[Repetitions]\n");
     exit(-1);
   }
   params[0] = atoi(argv[1]);
@@ -61,14 +62,20 @@ static void parse_args(int params[5], int argc, char** argv) {
   params[2] = atoi(argv[3]);
   params[3] = atoi(argv[4]);
   params[4] = atoi(argv[5]);
+  // 0 selects the library's default repetition count
+  params[5] = argc == 7 ? atoi(argv[6]) : 0;
 
   if (params[0] * 3 > params[1]) {
     printf("Number of S-boxes * 3 exceeds block size!");
     exit(-1);
   }
+  if (params[5] && params[5] != NUM_ROUNDS_CLASSICAL && params[5] != NUM_ROUNDS_PQ) {
+    printf("Repetition count has to be %d or %d.\n", NUM_ROUNDS_CLASSICAL, NUM_ROUNDS_PQ);
+    exit(-1);
+  }
 }
 
-static void fis_sign_verify(int args[5]) {
+static void fis_sign_verify(int args[6]) {
   static const uint8_t m[] = {1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16,
                               17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32};
 
@@ -81,7 +88,10 @@ static void fis_sign_verify(int args[5]) {
     fis_private_key_t private_key;
     fis_public_key_t public_key;
 
-    if (!create_instance(&pp, args[0], args[1], args[2], args[3])) {
+    const bool created =
+        args[5] ? create_instance_ex(&pp, args[0], args[1], args[2], args[3], args[5])
+                : create_instance(&pp, args[0], args[1], args[2], args[3]);
+    if (!created) {
       printf("Failed to create LowMC instance.\n");
       break;
     }
@@ -94,19 +104,22 @@ static void fis_sign_verify(int args[5]) {
 
     fis_signature_t* sig = fis_sign(&pp, &private_key, m, sizeof(m));
     if (sig) {
-      unsigned len        = 0;
-      unsigned char* data = fis_sig_to_char_array(&pp, sig, &len);
-      timing_and_size->size =
-          fis_compute_sig_size(pp.lowmc->m, pp.lowmc->n, pp.lowmc->r, pp.lowmc->k);
+      const unsigned max_len = fis_sig_max_size(&pp);
+      unsigned char* data    = malloc(max_len);
+      const unsigned len     = fis_sig_serialize(&pp, sig, data, max_len);
+      timing_and_size->size  = len;
       fis_free_signature(&pp, sig);
       sig = fis_sig_from_char_array(&pp, data);
-      free(data);
 
       if (fis_verify(&pp, &public_key, m, sizeof(m), sig)) {
         printf("fis_verify: failed\n");
       }
-
       fis_free_signature(&pp, sig);
+
+      if (fis_verify_bytes(&pp, &public_key, m, sizeof(m), data, len)) {
+        printf("fis_verify_bytes: failed\n");
+      }
+      free(data);
     } else {
       printf("fis_sign: failed\n");
     }
@@ -130,7 +143,7 @@ int main(int argc, char** argv) {
   init_EVP();
   openmp_thread_setup();
 
-  int args[5];
+  int args[6];
   parse_args(args, argc, argv);
 
   fis_sign_verify(args);
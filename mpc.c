@@ -10,37 +10,15 @@ void mpc_clear(mzd_t** res, unsigned sc) {
 }
 #endif
 
-void mpc_shift_right(mzd_t* const* res, mzd_t* const* val, unsigned count, unsigned sc) {
-  for (unsigned i = 0; i < sc; ++i)
-    mzd_shift_right(res[i], val[i], count);
-}
-
-void mpc_shift_left(mzd_t* const* res, mzd_t* const* val, unsigned count, unsigned sc) {
-  for (unsigned i = 0; i < sc; ++i)
-    mzd_shift_left(res[i], val[i], count);
-}
-
-void mpc_and_const(mzd_t* const* res, mzd_t* const* first, mzd_t const* second, unsigned sc) {
-  for (unsigned i = 0; i < sc; i++) {
-    mzd_and(res[i], first[i], second);
-  }
-}
-
-void mpc_xor(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, unsigned sc) {
-  for (unsigned i = 0; i < sc; i++) {
-    mzd_xor(res[i], first[i], second[i]);
-  }
-}
-
 #ifdef WITH_OPT
 #ifdef WITH_SSE2
 __attribute__((target("sse2"))) void mpc_and_sse(__m128i* res, __m128i const* first,
                                                  __m128i const* second, __m128i const* r,
-                                                 view_t const* view, unsigned viewshift) {
+                                                 word* const* view, unsigned viewshift) {
   for (unsigned m = 0; m < SC_PROOF; ++m) {
     const unsigned j = (m + 1) % SC_PROOF;
 
-    __m128i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 16);
+    __m128i* sm = __builtin_assume_aligned(view[m], 16);
 
     __m128i tmp1 = _mm_xor_si128(second[m], second[j]);
     __m128i tmp2 = _mm_and_si128(first[j], second[m]);
@@ -59,11 +37,11 @@ __attribute__((target("sse2"))) void mpc_and_sse(__m128i* res, __m128i const* fi
 #ifdef WITH_AVX2
 __attribute__((target("avx2"))) void mpc_and_avx(__m256i* res, __m256i const* first,
                                                  __m256i const* second, __m256i const* r,
-                                                 view_t const* view, unsigned viewshift) {
+                                                 word* const* view, unsigned viewshift) {
   for (unsigned m = 0; m < SC_PROOF; ++m) {
     const unsigned j = (m + 1) % SC_PROOF;
 
-    __m256i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 32);
+    __m256i* sm = __builtin_assume_aligned(view[m], 32);
 
     __m256i tmp1 = _mm256_xor_si256(second[m], second[j]);
     __m256i tmp2 = _mm256_and_si256(first[j], second[m]);
@@ -80,39 +58,38 @@ __attribute__((target("avx2"))) void mpc_and_avx(__m256i* res, __m256i const* fi
 #endif
 #endif
 
-void mpc_and(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t* const* r,
-             view_t* view, unsigned viewshift, mzd_t* const* buffer) {
-  mzd_t* b = buffer[0];
-
+void mpc_and_block(block_t* res, block_t const* first, block_t const* second, block_t const* r,
+                   word* const* view, unsigned viewshift, unsigned width) {
   for (unsigned m = 0; m < SC_PROOF; ++m) {
     const unsigned j = (m + 1) % SC_PROOF;
 
-    mzd_and(res[m], first[m], second[m]);
-
-    mzd_and(b, first[j], second[m]);
-    mzd_xor(res[m], res[m], b);
+    block_t tmp1, tmp2;
+    block_xor(&tmp1, &second[m], &second[j], width);
+    block_and(&tmp2, &first[j], &second[m], width);
+    block_and(&tmp1, &tmp1, &first[m], width);
+    block_xor(&tmp1, &tmp1, &tmp2, width);
 
-    mzd_and(b, first[m], second[j]);
-    mzd_xor(res[m], res[m], b);
+    block_xor(&tmp2, &r[m], &r[j], width);
+    block_xor(&res[m], &tmp1, &tmp2, width);
 
-    mzd_xor(res[m], res[m], r[m]);
-    mzd_xor(res[m], res[m], r[j]);
+    block_shift_right(&tmp1, &res[m], viewshift, width);
+    word* sm = view[m];
+    for (unsigned int i = 0; i < width; ++i) {
+      sm[i] ^= tmp1.w[i];
+    }
   }
-
-  mpc_shift_right(buffer, res, viewshift, SC_PROOF);
-  mpc_xor(view->s, view->s, buffer, SC_PROOF);
 }
 
 #ifdef WITH_OPT
 #ifdef WITH_SSE2
 __attribute__((target("sse2"))) void mpc_and_verify_sse(__m128i* res, __m128i const* first,
                                                         __m128i const* second, __m128i const* r,
-                                                        view_t const* view, __m128i const mask,
+                                                        word* const* view, __m128i const mask,
                                                         unsigned viewshift) {
   for (unsigned m = 0; m < (SC_VERIFY - 1); ++m) {
     const unsigned j = (m + 1);
 
-    __m128i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 16);
+    __m128i* sm = __builtin_assume_aligned(view[m], 16);
 
     __m128i tmp1 = _mm_xor_si128(second[m], second[j]);
     __m128i tmp2 = _mm_and_si128(first[j], second[m]);
@@ -126,7 +103,7 @@ __attribute__((target("sse2"))) void mpc_and_verify_sse(__m128i* res, __m128i co
     *sm  = _mm_xor_si128(tmp1, *sm);
   }
 
-  __m128i const* s1  = __builtin_assume_aligned(CONST_FIRST_ROW(view->s[SC_VERIFY - 1]), 16);
+  __m128i const* s1  = __builtin_assume_aligned(view[SC_VERIFY - 1], 16);
   __m128i rsc        = mm128_shift_left(*s1, viewshift);
   res[SC_VERIFY - 1] = _mm_and_si128(rsc, mask);
 }
@@ -135,12 +112,12 @@ __attribute__((target("sse2"))) void mpc_and_verify_sse(__m128i* res, __m128i co
 #ifdef WITH_AVX2
 __attribute__((target("avx2"))) void mpc_and_verify_avx(__m256i* res, __m256i const* first,
                                                         __m256i const* second, __m256i const* r,
-                                                        view_t const* view, __m256i const mask,
+                                                        word* const* view, __m256i const mask,
                                                         unsigned viewshift) {
   for (unsigned m = 0; m < (SC_VERIFY - 1); ++m) {
     const unsigned j = (m + 1);
 
-    __m256i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 32);
+    __m256i* sm = __builtin_assume_aligned(view[m], 32);
 
     __m256i tmp1 = _mm256_xor_si256(second[m], second[j]);
     __m256i tmp2 = _mm256_and_si256(first[j], second[m]);
@@ -154,40 +131,39 @@ __attribute__((target("avx2"))) void mpc_and_verify_avx(__m256i* res, __m256i co
     *sm  = _mm256_xor_si256(tmp1, *sm);
   }
 
-  __m256i const* s1  = __builtin_assume_aligned(CONST_FIRST_ROW(view->s[SC_VERIFY - 1]), 32);
+  __m256i const* s1  = __builtin_assume_aligned(view[SC_VERIFY - 1], 32);
   __m256i rsc        = mm256_shift_left(*s1, viewshift);
   res[SC_VERIFY - 1] = _mm256_and_si256(rsc, mask);
 }
 #endif
 #endif
 
-void mpc_and_verify(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t* const* r,
-                    view_t const* view, mzd_t const* mask, unsigned viewshift,
-                    mzd_t* const* buffer) {
-  mzd_t* b = buffer[0];
-
+void mpc_and_verify_block(block_t* res, block_t const* first, block_t const* second,
+                          block_t const* r, word* const* view, block_t const* mask,
+                          unsigned viewshift, unsigned width) {
   for (unsigned m = 0; m < (SC_VERIFY - 1); ++m) {
     const unsigned j = m + 1;
 
-    mzd_and(res[m], first[m], second[m]);
+    block_t tmp1, tmp2;
+    block_xor(&tmp1, &second[m], &second[j], width);
+    block_and(&tmp2, &first[j], &second[m], width);
+    block_and(&tmp1, &tmp1, &first[m], width);
+    block_xor(&tmp1, &tmp1, &tmp2, width);
 
-    mzd_and(b, first[j], second[m]);
-    mzd_xor(res[m], res[m], b);
+    block_xor(&tmp2, &r[m], &r[j], width);
+    block_xor(&res[m], &tmp1, &tmp2, width);
 
-    mzd_and(b, first[m], second[j]);
-    mzd_xor(res[m], res[m], b);
-
-    mzd_xor(res[m], res[m], r[m]);
-    mzd_xor(res[m], res[m], r[j]);
-  }
-
-  for (unsigned m = 0; m < (SC_VERIFY - 1); ++m) {
-    mzd_shift_right(b, res[m], viewshift);
-    mzd_xor(view->s[m], view->s[m], b);
+    block_shift_right(&tmp1, &res[m], viewshift, width);
+    word* sm = view[m];
+    for (unsigned int i = 0; i < width; ++i) {
+      sm[i] ^= tmp1.w[i];
+    }
   }
 
-  mzd_shift_left(res[SC_VERIFY - 1], view->s[SC_VERIFY - 1], viewshift);
-  mzd_and(res[SC_VERIFY - 1], res[SC_VERIFY - 1], mask);
+  block_t rsc;
+  memcpy(rsc.w, view[SC_VERIFY - 1], width * sizeof(word));
+  block_shift_left(&rsc, &rsc, viewshift, width);
+  block_and(&res[SC_VERIFY - 1], &rsc, mask, width);
 }
 
 #if 0
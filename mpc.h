@@ -1,45 +1,44 @@
 #ifndef MPC_H
 #define MPC_H
 
+#include "block.h"
 #include "mpc_lowmc.h"
 #include <m4ri/m4ri.h>
 
-void mpc_shift_right(mzd_t* const* res, mzd_t* const* val, unsigned count, unsigned sc)
-    __attribute__((nonnull));
-
-void mpc_shift_left(mzd_t* const* res, mzd_t* const* val, unsigned count, unsigned sc)
-    __attribute__((nonnull));
-
-void mpc_and_const(mzd_t* const* res, mzd_t* const* first, mzd_t const* second, unsigned sc)
-    __attribute__((nonnull));
-
-void mpc_xor(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, unsigned sc)
-    __attribute__((nonnull));
-
 void mpc_clear(mzd_t** res, unsigned sc) __attribute__((nonnull));
 
-void mpc_and(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t* const* r,
-             view_t* view, unsigned viewshift, mzd_t* const* buffer) __attribute__((nonnull));
-
-void mpc_and_verify(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t* const* r,
-                    view_t const* view, mzd_t const* mask, unsigned viewshift, mzd_t* const* buffer)
+/**
+ * Computes the AND of two secret shared blocks and records the result in the
+ * views at the given shift. view holds the current view row of each party and
+ * width is the number of words used in the blocks.
+ */
+void mpc_and_block(block_t* res, block_t const* first, block_t const* second, block_t const* r,
+                   word* const* view, unsigned viewshift, unsigned width)
     __attribute__((nonnull));
 
+/**
+ * Verification counterpart of mpc_and_block: recomputes the first share and
+ * reads the second one from the view.
+ */
+void mpc_and_verify_block(block_t* res, block_t const* first, block_t const* second,
+                          block_t const* r, word* const* view, block_t const* mask,
+                          unsigned viewshift, unsigned width) __attribute__((nonnull));
+
 #ifdef WITH_OPT
 #include "simd.h"
 
 void mpc_and_sse(__m128i* res, __m128i const* first, __m128i const* second, __m128i const* r,
-                 view_t const* view, unsigned viewshift) __attribute__((nonnull));
+                 word* const* view, unsigned viewshift) __attribute__((nonnull));
 
 void mpc_and_avx(__m256i* res, __m256i const* first, __m256i const* second, __m256i const* r,
-                 view_t const* view, unsigned viewshift) __attribute__((nonnull));
+                 word* const* view, unsigned viewshift) __attribute__((nonnull));
 
 void mpc_and_verify_sse(__m128i* res, __m128i const* first, __m128i const* second, __m128i const* r,
-                        view_t const* view, __m128i const mask, unsigned viewshift)
+                        word* const* view, __m128i const mask, unsigned viewshift)
     __attribute__((nonnull));
 
 void mpc_and_verify_avx(__m256i* res, __m256i const* first, __m256i const* second, __m256i const* r,
-                        view_t const* view, __m256i const mask, unsigned viewshift)
+                        word* const* view, __m256i const mask, unsigned viewshift)
     __attribute__((nonnull));
 #endif
 
@@ -1,6 +1,7 @@
 #include "mpc_lowmc.h"
 #include "hashing_util.h"
 #include "io.h"
+#include "lowmc_impl.h"
 #include "lowmc_pars.h"
 #include "mpc.h"
 #include "mzd_additional.h"
@@ -12,50 +13,77 @@
 #include "simd.h"
 #endif
 
-typedef struct {
-  mzd_t* x0m[SC_PROOF];
-  mzd_t* x1m[SC_PROOF];
-  mzd_t* x2m[SC_PROOF];
-  mzd_t* r0m[SC_PROOF];
-  mzd_t* r1m[SC_PROOF];
-  mzd_t* r2m[SC_PROOF];
-  mzd_t* x0s[SC_PROOF];
-  mzd_t* r0s[SC_PROOF];
-  mzd_t* x1s[SC_PROOF];
-  mzd_t* r1s[SC_PROOF];
-  mzd_t* v[SC_PROOF];
-
-  mzd_t** storage;
-} sbox_vars_t;
-
-static sbox_vars_t* sbox_vars_init(sbox_vars_t* vars, rci_t n, unsigned sc);
-static void sbox_vars_clear(sbox_vars_t* vars);
-
 typedef int (*BIT_and_ptr)(BIT*, BIT*, BIT*, view_t*, int*, unsigned, unsigned);
 typedef int (*and_ptr)(mzd_t**, mzd_t**, mzd_t**, mzd_t**, view_t*, mzd_t*, unsigned, mzd_t**);
 
-unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned* len,
-                                   bool store_ch) {
-  unsigned first_view_bytes = lowmc->k / 8;
-  unsigned full_mzd_size    = lowmc->n / 8;
-  unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
-  unsigned mzd_bytes        = lowmc->r * single_mzd_bytes + first_view_bytes + full_mzd_size;
-  *len =
-      NUM_ROUNDS * (COMMITMENT_LENGTH + 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + mzd_bytes) +
-      (store_ch ? ((NUM_ROUNDS + 3) / 4) : 0);
-  unsigned char* result = (unsigned char*)malloc(*len * sizeof(unsigned char));
+// The output share of the second opened party is not part of the view data,
+// the verifier recomputes it (see mpc_lowmc_verify).
+static unsigned view_size(mpc_lowmc_t const* lowmc) {
+  const unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
+  return lowmc->r * single_mzd_bytes;
+}
+
+static unsigned repetition_size(mpc_lowmc_t const* lowmc) {
+  return COMMITMENT_LENGTH + 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + view_size(lowmc);
+}
+
+unsigned proof_max_size(mpc_lowmc_t const* lowmc, unsigned int num_rounds, bool store_ch) {
+  return num_rounds * (repetition_size(lowmc) + lowmc->k / 8) +
+         (store_ch ? ((num_rounds + 3) / 4) : 0);
+}
 
-  unsigned char* temp = result;
+unsigned proof_size(mpc_lowmc_t const* lowmc, proof_t const* proof, bool store_ch) {
+  const unsigned int num_rounds = proof->num_rounds;
+
+  unsigned size = num_rounds * repetition_size(lowmc) + (store_ch ? ((num_rounds + 3) / 4) : 0);
+  for (unsigned i = 0; i < num_rounds; i++) {
+    if (getChAt(proof->ch, i)) {
+      size += lowmc->k / 8;
+    }
+  }
+  return size;
+}
+
+unsigned views_to_char_array(mpc_lowmc_t const* lowmc, unsigned char* dst, view_t const* view,
+                             unsigned int ch) {
+  const unsigned first_view_bytes = lowmc->k / 8;
+  const unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
+
+  unsigned char* temp = dst;
+  if (ch != 0) {
+    // the key share of the third party is not derived from a seed
+    mzd_row_to_char_array(temp, CONST_FIRST_ROW(view->s[ch % 2]), first_view_bytes, lowmc->k);
+    temp += first_view_bytes;
+  }
+
+  mzd_t const* view1 = view->s[1];
+  for (unsigned j = 1; j < 1 + lowmc->r; j++) {
+    mzd_row_to_char_array(temp, CONST_ROW(view1, j), single_mzd_bytes, lowmc->n);
+    temp += single_mzd_bytes;
+  }
+
+  return temp - dst;
+}
+
+unsigned proof_to_buffer(mpc_lowmc_t const* lowmc, proof_t const* proof, unsigned char* buf,
+                         unsigned buflen, bool store_ch) {
+  const unsigned size = proof_size(lowmc, proof, store_ch);
+  if (buflen < size) {
+    return 0;
+  }
+
+  const unsigned int num_rounds = proof->num_rounds;
+  unsigned char* temp           = buf;
 
   if (store_ch) {
-    memcpy(temp, proof->ch, (NUM_ROUNDS + 3) / 4);
-    temp += (NUM_ROUNDS + 3) / 4;
+    memcpy(temp, proof->ch, (num_rounds + 3) / 4);
+    temp += (num_rounds + 3) / 4;
   }
 
-  memcpy(temp, proof->hashes, NUM_ROUNDS * COMMITMENT_LENGTH * sizeof(unsigned char));
-  temp += NUM_ROUNDS * COMMITMENT_LENGTH;
+  memcpy(temp, proof->hashes, num_rounds * COMMITMENT_LENGTH * sizeof(unsigned char));
+  temp += num_rounds * COMMITMENT_LENGTH;
 
-  for (unsigned i = 0; i < NUM_ROUNDS; i++) {
+  for (unsigned i = 0; i < num_rounds; i++) {
     memcpy(temp, proof->r[i][0], COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
     temp += COMMITMENT_RAND_LENGTH;
     memcpy(temp, proof->r[i][1], COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
@@ -66,59 +94,71 @@ unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned*
     memcpy(temp, proof->keys[i][1], PRNG_KEYSIZE * sizeof(unsigned char));
     temp += PRNG_KEYSIZE;
 
-    unsigned char* v0;
-
-    if (getChAt(proof->ch, i) != 0) {
-      v0 = mzd_to_char_array(proof->views[i][0].s[getChAt(proof->ch, i) % 2], first_view_bytes);
-      memcpy(temp, v0, first_view_bytes);
-      temp += first_view_bytes;
-      free(v0);
-    }
-
-    for (unsigned j = 1; j < 1 + lowmc->r; j++) {
-      v0 = mzd_to_char_array(proof->views[i][j].s[0], single_mzd_bytes);
-
-      memcpy(temp, v0, single_mzd_bytes);
-      temp += single_mzd_bytes;
-
-      free(v0);
-    }
+    temp += views_to_char_array(lowmc, temp, &proof->views[i], getChAt(proof->ch, i));
+  }
 
-    v0 = mzd_to_char_array(proof->views[i][1 + lowmc->r].s[1], full_mzd_size);
+  return size;
+}
 
-    memcpy(temp, v0, full_mzd_size);
-    temp += full_mzd_size;
+unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned* len,
+                                   bool store_ch) {
+  *len                  = proof_max_size(lowmc, proof->num_rounds, store_ch);
+  unsigned char* result = (unsigned char*)malloc(*len * sizeof(unsigned char));
+  if (result) {
+    proof_to_buffer(lowmc, proof, result, *len, store_ch);
+  }
+  return result;
+}
 
-    free(v0);
+unsigned views_from_char_array(mpc_lowmc_t const* lowmc, view_t* view, unsigned char const* data,
+                               const unsigned char keys[SC_VERIFY][PRNG_KEYSIZE],
+                               unsigned int ch) {
+  const unsigned first_view_bytes = lowmc->k / 8;
+  const unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
+
+  unsigned char const* temp = data;
+  mzd_t* view0              = view->s[0];
+  mzd_t* view1              = view->s[1];
+
+  if (ch == 0) {
+    mzd_randomize_row_from_seed(view0, 0, lowmc->k, keys[0]);
+    mzd_randomize_row_from_seed(view1, 0, lowmc->k, keys[1]);
+  } else if (ch == 1) {
+    mzd_randomize_row_from_seed(view0, 0, lowmc->k, keys[0]);
+    mzd_row_from_char_array(FIRST_ROW(view1), temp, first_view_bytes, lowmc->k);
+    temp += first_view_bytes;
+  } else {
+    mzd_row_from_char_array(FIRST_ROW(view0), temp, first_view_bytes, lowmc->k);
+    mzd_randomize_row_from_seed(view1, 0, lowmc->k, keys[1]);
+    temp += first_view_bytes;
+  }
+  for (unsigned j = 1; j < 1 + lowmc->r; j++) {
+    mzd_row_from_char_array(ROW(view1, j), temp, single_mzd_bytes, lowmc->n);
+    temp += single_mzd_bytes;
   }
 
-  return result;
+  return temp - data;
 }
 
-proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned char* data,
+proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, unsigned int num_rounds, unsigned char* data,
                                unsigned* len, bool contains_ch) {
-  if (!proof)
-    proof = calloc(sizeof(proof_t), 1);
-
-  unsigned first_view_bytes = lowmc->k / 8;
-  unsigned full_mzd_size    = lowmc->n / 8;
-  unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
-  unsigned mzd_bytes        = lowmc->r * single_mzd_bytes + first_view_bytes + full_mzd_size;
-  *len =
-      NUM_ROUNDS * (COMMITMENT_LENGTH + 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + mzd_bytes) +
-      (contains_ch ? ((NUM_ROUNDS + 3) / 4) : 0);
+  proof_t* proof = init_proof(lowmc, num_rounds, SC_VERIFY);
+  if (!proof) {
+    return NULL;
+  }
+  *len = proof_max_size(lowmc, num_rounds, contains_ch);
 
   unsigned char* temp = data;
 
   if (contains_ch) {
-    memcpy(proof->ch, temp, (NUM_ROUNDS + 3) / 4);
-    temp += (NUM_ROUNDS + 3) / 4;
+    memcpy(proof->ch, temp, (num_rounds + 3) / 4);
+    temp += (num_rounds + 3) / 4;
   }
 
-  memcpy(proof->hashes, temp, NUM_ROUNDS * COMMITMENT_LENGTH * sizeof(unsigned char));
-  temp += NUM_ROUNDS * COMMITMENT_LENGTH;
+  memcpy(proof->hashes, temp, num_rounds * COMMITMENT_LENGTH * sizeof(unsigned char));
+  temp += num_rounds * COMMITMENT_LENGTH;
 
-  for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
+  for (unsigned int i = 0; i < num_rounds; i++) {
     memcpy(proof->r[i][0], temp, COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
     temp += COMMITMENT_RAND_LENGTH;
     memcpy(proof->r[i][1], temp, COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
@@ -128,50 +168,67 @@ proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned char
     temp += PRNG_KEYSIZE;
     memcpy(proof->keys[i][1], temp, PRNG_KEYSIZE * sizeof(char));
     temp += PRNG_KEYSIZE;
-    proof->views[i] = malloc((2 + lowmc->r) * sizeof(view_t));
-
-    const unsigned char ch = getChAt(proof->ch, i);
-    if (ch == 0) {
-      proof->views[i][0].s[0] = mzd_init_random_vector_from_seed(proof->keys[i][0], lowmc->k);
-      proof->views[i][0].s[1] = mzd_init_random_vector_from_seed(proof->keys[i][1], lowmc->k);
-    } else if (ch == 1) {
-      proof->views[i][0].s[0] = mzd_init_random_vector_from_seed(proof->keys[i][0], lowmc->k);
-      proof->views[i][0].s[1] = mzd_from_char_array(temp, first_view_bytes, lowmc->k);
-      temp += first_view_bytes;
-    } else {
-      proof->views[i][0].s[0] = mzd_from_char_array(temp, first_view_bytes, lowmc->k);
-      proof->views[i][0].s[1] = mzd_init_random_vector_from_seed(proof->keys[i][1], lowmc->k);
-      temp += first_view_bytes;
-    }
-    proof->views[i][0].s[2] = NULL;
-    for (unsigned j = 1; j < 1 + lowmc->r; j++) {
-      proof->views[i][j].s[0] = mzd_local_init(1, lowmc->n);
-      proof->views[i][j].s[1] = mzd_from_char_array(temp, single_mzd_bytes, lowmc->n);
-      temp += single_mzd_bytes;
-      proof->views[i][j].s[2] = NULL;
+
+    temp += views_from_char_array(lowmc, &proof->views[i], temp, proof->keys[i],
+                                  getChAt(proof->ch, i));
+  }
+
+  return proof;
+}
+
+mzd_t* init_views(mpc_lowmc_t const* lowmc, view_t* views, unsigned int count, unsigned int sc) {
+  // the key share in the first row has k bits, all other rows n bits
+  const rci_t ncols = lowmc->k > lowmc->n ? lowmc->k : lowmc->n;
+
+  mzd_t* matrices[count * sc];
+  mzd_local_init_multiple(matrices, count * sc, lowmc->r + 2, ncols);
+
+  for (unsigned int i = 0; i < count; ++i) {
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      views[i].s[m] = m < sc ? matrices[i * sc + m] : NULL;
     }
-    proof->views[i][1 + lowmc->r].s[0] = mzd_local_init(1, lowmc->n);
-    proof->views[i][1 + lowmc->r].s[1] = mzd_from_char_array(temp, full_mzd_size, lowmc->n);
-    temp += full_mzd_size;
-    proof->views[i][1 + lowmc->r].s[2] = NULL;
   }
 
+  return matrices[0];
+}
+
+proof_t* init_proof(mpc_lowmc_t const* lowmc, unsigned int num_rounds, unsigned int sc) {
+  const size_t views_size  = num_rounds * sizeof(view_t);
+  const size_t keys_size   = num_rounds * SC_VERIFY * PRNG_KEYSIZE;
+  const size_t r_size      = num_rounds * SC_VERIFY * COMMITMENT_RAND_LENGTH;
+  const size_t hashes_size = num_rounds * COMMITMENT_LENGTH;
+  const size_t ch_size     = (num_rounds + 3) / 4;
+
+  // the views come first to keep the pointers aligned
+  proof_t* proof =
+      calloc(1, sizeof(proof_t) + views_size + keys_size + r_size + hashes_size + ch_size);
+  if (!proof) {
+    return NULL;
+  }
+
+  unsigned char* temp = (unsigned char*)(proof + 1);
+  proof->num_rounds   = num_rounds;
+  proof->views        = (view_t*)temp;
+  temp += views_size;
+  proof->keys = (unsigned char(*)[SC_VERIFY][PRNG_KEYSIZE])temp;
+  temp += keys_size;
+  proof->r = (unsigned char(*)[SC_VERIFY][COMMITMENT_RAND_LENGTH])temp;
+  temp += r_size;
+  proof->hashes = (unsigned char(*)[COMMITMENT_LENGTH])temp;
+  temp += hashes_size;
+  proof->ch = temp;
+
+  proof->view_storage = init_views(lowmc, proof->views, num_rounds, sc);
   return proof;
 }
 
 proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
-                      unsigned char hashes[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH],
-                      unsigned char ch[NUM_ROUNDS],
-                      unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH],
-                      unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE],
-                      view_t* const views[NUM_ROUNDS]) {
-  if (!proof)
-    proof = calloc(sizeof(proof_t), 1);
-
-  const size_t num_views  = 2 + lowmc->r;
-  const size_t last_round = 1 + lowmc->r;
-
-  for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
+                      unsigned char hashes[][SC_PROOF][COMMITMENT_LENGTH], unsigned char ch[],
+                      unsigned char r[][SC_PROOF][COMMITMENT_RAND_LENGTH],
+                      unsigned char keys[][SC_PROOF][PRNG_KEYSIZE]) {
+  (void)lowmc;
+
+  for (unsigned int i = 0; i < proof->num_rounds; i++) {
     unsigned int a = ch[i];
     unsigned int b = (a + 1) % 3;
     unsigned int c = (a + 2) % 3;
@@ -184,25 +241,13 @@ proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
     memcpy(proof->keys[i][0], keys[i][a], PRNG_KEYSIZE);
     memcpy(proof->keys[i][1], keys[i][b], PRNG_KEYSIZE);
 
-    proof->views[i]         = malloc(num_views * sizeof(view_t));
-    proof->views[i][0].s[0] = views[i][0].s[a];
-    proof->views[i][0].s[1] = views[i][0].s[b];
-    proof->views[i][0].s[2] = NULL;
-    mzd_local_free(views[i][0].s[c]);
-    for (unsigned j = 1; j < last_round; j++) {
-      proof->views[i][j].s[0] = views[i][j].s[b];
-      // we keep the reference to this pointer here and free it later
-      // to circumvent the need for two clear functions. Note that
-      // this reference is not serialized withing proof_to_char_array
-      proof->views[i][j].s[1] = views[i][j].s[a];
-      proof->views[i][j].s[2] = NULL;
-      mzd_local_free(views[i][j].s[c]);
-    }
-    proof->views[i][last_round].s[0] = NULL;
-    proof->views[i][last_round].s[1] = views[i][last_round].s[b];
-    proof->views[i][last_round].s[2] = NULL;
-    mzd_local_free(views[i][last_round].s[a]);
-    mzd_local_free(views[i][last_round].s[c]);
+    // the view of the third party stays unused in the memory block
+    view_t* view = &proof->views[i];
+    mzd_t* va    = view->s[a];
+    mzd_t* vb    = view->s[b];
+    view->s[0]   = va;
+    view->s[1]   = vb;
+    view->s[2]   = NULL;
 
     const unsigned int idx   = i / 4;
     const unsigned int shift = (i % 4) << 1;
@@ -213,60 +258,88 @@ proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
   return proof;
 }
 
-#define bitsliced_step_1(sc)                                                                       \
-  mpc_and_const(out, in, mask->mask, sc);                                                          \
+#define bitsliced_block_step_1(sc)                                                                 \
+  block_t r0m[sc];                                                                                 \
+  block_t r0s[sc];                                                                                 \
+  block_t r1m[sc];                                                                                 \
+  block_t r1s[sc];                                                                                 \
+  block_t r2m[sc];                                                                                 \
+  block_t x0s[sc];                                                                                 \
+  block_t x1s[sc];                                                                                 \
+  block_t x2m[sc];                                                                                 \
+  block_t mx0, mx1, mx2;                                                                           \
+  const unsigned int width = mask->x0->width;                                                      \
+  block_load(&mx0, mask->x0);                                                                      \
+  block_load(&mx1, mask->x1);                                                                      \
+  block_load(&mx2, mask->x2);                                                                      \
+                                                                                                   \
+  for (unsigned int m = 0; m < (sc); ++m) {                                                        \
+    block_t inm, rvecm, tmp1, tmp2;                                                                \
+    block_load(&inm, in[m]);                                                                       \
+    block_load(&rvecm, rvec[m]);                                                                   \
                                                                                                    \
-  mpc_and_const(vars->x0m, in, mask->x0, sc);                                                      \
-  mpc_and_const(vars->x1m, in, mask->x1, sc);                                                      \
-  mpc_and_const(vars->x2m, in, mask->x2, sc);                                                      \
-  mpc_and_const(vars->r0m, rvec, mask->x0, sc);                                                    \
-  mpc_and_const(vars->r1m, rvec, mask->x1, sc);                                                    \
-  mpc_and_const(vars->r2m, rvec, mask->x2, sc);                                                    \
+    block_and(&tmp1, &inm, &mx0, width);                                                           \
+    block_and(&tmp2, &inm, &mx1, width);                                                           \
+    block_and(&x2m[m], &inm, &mx2, width);                                                         \
                                                                                                    \
-  mpc_shift_left(vars->x0s, vars->x0m, 2, sc);                                                     \
-  mpc_shift_left(vars->r0s, vars->r0m, 2, sc);                                                     \
+    block_shift_left(&x0s[m], &tmp1, 2, width);                                                    \
+    block_shift_left(&x1s[m], &tmp2, 1, width);                                                    \
                                                                                                    \
-  mpc_shift_left(vars->x1s, vars->x1m, 1, sc);                                                     \
-  mpc_shift_left(vars->r1s, vars->r1m, 1, sc)
+    block_and(&r0m[m], &rvecm, &mx0, width);                                                       \
+    block_and(&r1m[m], &rvecm, &mx1, width);                                                       \
+    block_and(&r2m[m], &rvecm, &mx2, width);                                                       \
+                                                                                                   \
+    block_shift_left(&r0s[m], &r0m[m], 2, width);                                                  \
+    block_shift_left(&r1s[m], &r1m[m], 1, width);                                                  \
+  }
 
-#define bitsliced_step_2(sc)                                                                       \
-  mpc_xor(vars->r2m, vars->r2m, vars->x0s, sc);                                                    \
+#define bitsliced_block_step_2(sc)                                                                 \
+  do {                                                                                             \
+    block_t maskm;                                                                                 \
+    block_load(&maskm, mask->mask);                                                                \
+    for (unsigned int m = 0; m < (sc); ++m) {                                                      \
+      block_t inm, mout, tmp1, tmp2, tmp3, tmp4;                                                   \
+      block_load(&inm, in[m]);                                                                     \
                                                                                                    \
-  mpc_xor(vars->x0s, vars->x0s, vars->x1s, sc);                                                    \
-  mpc_xor(vars->r1m, vars->r1m, vars->x0s, sc);                                                    \
+      block_xor(&tmp1, &r2m[m], &x0s[m], width);                                                   \
+      block_xor(&tmp2, &x0s[m], &x1s[m], width);                                                   \
+      block_xor(&tmp3, &tmp2, &r1m[m], width);                                                     \
                                                                                                    \
-  mpc_xor(vars->r0m, vars->r0m, vars->x0s, sc);                                                    \
-  mpc_xor(vars->r0m, vars->r0m, vars->x2m, sc);                                                    \
+      block_and(&mout, &maskm, &inm, width);                                                       \
                                                                                                    \
-  mpc_shift_right(vars->x0s, vars->r2m, 2, sc);                                                    \
-  mpc_shift_right(vars->x1s, vars->r1m, 1, sc);                                                    \
+      block_xor(&tmp4, &tmp2, &r0m[m], width);                                                     \
+      block_xor(&tmp4, &tmp4, &x2m[m], width);                                                     \
+      block_xor(&mout, &mout, &tmp4, width);                                                       \
                                                                                                    \
-  mpc_xor(out, out, vars->r0m, sc);                                                                \
-  mpc_xor(out, out, vars->x0s, sc);                                                                \
-  mpc_xor(out, out, vars->x1s, sc)
+      block_shift_right(&tmp2, &tmp1, 2, width);                                                   \
+      block_xor(&mout, &mout, &tmp2, width);                                                       \
+                                                                                                   \
+      block_shift_right(&tmp1, &tmp3, 1, width);                                                   \
+      block_xor(&mout, &mout, &tmp1, width);                                                       \
+      block_store(out[m], &mout);                                                                  \
+    }                                                                                              \
+  } while (0)
 
-static void _mpc_sbox_layer_bitsliced(mzd_t** out, mzd_t* const* in, view_t* view,
-                                      mzd_t* const* rvec, mask_t const* mask,
-                                      sbox_vars_t const* vars) {
-  bitsliced_step_1(SC_PROOF);
+static void _mpc_sbox_layer_bitsliced(mzd_t** out, mzd_t* const* in, word* const* view,
+                                      mzd_t* const* rvec, mask_t const* mask) {
+  bitsliced_block_step_1(SC_PROOF);
 
-  mpc_and(vars->r0m, vars->x0s, vars->x1s, vars->r2m, view, 0, vars->v);
-  mpc_and(vars->r2m, vars->x1s, vars->x2m, vars->r0s, view, 2, vars->v);
-  mpc_and(vars->r1m, vars->x0s, vars->x2m, vars->r1s, view, 1, vars->v);
+  mpc_and_block(r0m, x0s, x1s, r2m, view, 0, width);
+  mpc_and_block(r2m, x1s, x2m, r0s, view, 2, width);
+  mpc_and_block(r1m, x0s, x2m, r1s, view, 1, width);
 
-  bitsliced_step_2(SC_PROOF);
+  bitsliced_block_step_2(SC_PROOF);
 }
 
-static void _mpc_sbox_layer_bitsliced_verify(mzd_t** out, mzd_t* const* in, view_t const* view,
-                                             mzd_t* const* rvec, mask_t const* mask,
-                                             sbox_vars_t const* vars) {
-  bitsliced_step_1(SC_VERIFY);
+static void _mpc_sbox_layer_bitsliced_verify(mzd_t** out, mzd_t* const* in, word* const* view,
+                                             mzd_t* const* rvec, mask_t const* mask) {
+  bitsliced_block_step_1(SC_VERIFY);
 
-  mpc_and_verify(vars->r0m, vars->x0s, vars->x1s, vars->r2m, view, mask->x2, 0, vars->v);
-  mpc_and_verify(vars->r2m, vars->x1s, vars->x2m, vars->r0s, view, mask->x2, 2, vars->v);
-  mpc_and_verify(vars->r1m, vars->x0s, vars->x2m, vars->r1s, view, mask->x2, 1, vars->v);
+  mpc_and_verify_block(r0m, x0s, x1s, r2m, view, &mx2, 0, width);
+  mpc_and_verify_block(r2m, x1s, x2m, r0s, view, &mx2, 2, width);
+  mpc_and_verify_block(r1m, x0s, x2m, r1s, view, &mx2, 1, width);
 
-  bitsliced_step_2(SC_VERIFY);
+  bitsliced_block_step_2(SC_VERIFY);
 }
 
 #ifdef WITH_OPT
@@ -338,7 +411,7 @@ static void _mpc_sbox_layer_bitsliced_verify(mzd_t** out, mzd_t* const* in, view
 
 #ifdef WITH_SSE2
 __attribute__((target("sse2"))) static void
-_mpc_sbox_layer_bitsliced_sse(mzd_t** out, mzd_t* const* in, view_t const* view, mzd_t* const* rvec,
+_mpc_sbox_layer_bitsliced_sse(mzd_t** out, mzd_t* const* in, word* const* view, mzd_t* const* rvec,
                               mask_t const* mask) {
   bitsliced_mm_step_1(SC_PROOF, __m128i, _mm_and_si128, mm128_shift_left);
 
@@ -350,8 +423,8 @@ _mpc_sbox_layer_bitsliced_sse(mzd_t** out, mzd_t* const* in, view_t const* view,
 }
 
 __attribute__((target("sse2"))) static void
-_mpc_sbox_layer_bitsliced_sse_verify(mzd_t** out, mzd_t* const* in, view_t const* view,
-                                     mzd_t** rvec, mask_t const* mask) {
+_mpc_sbox_layer_bitsliced_sse_verify(mzd_t** out, mzd_t* const* in, word* const* view,
+                                     mzd_t* const* rvec, mask_t const* mask) {
   bitsliced_mm_step_1(SC_VERIFY, __m128i, _mm_and_si128, mm128_shift_left);
 
   mpc_and_verify_sse(r0m, x0s, x1s, r2m, view, mx2, 0);
@@ -364,7 +437,7 @@ _mpc_sbox_layer_bitsliced_sse_verify(mzd_t** out, mzd_t* const* in, view_t const
 
 #ifdef WITH_AVX2
 __attribute__((target("avx2"))) static void
-_mpc_sbox_layer_bitsliced_avx(mzd_t** out, mzd_t* const* in, view_t const* view, mzd_t* const* rvec,
+_mpc_sbox_layer_bitsliced_avx(mzd_t** out, mzd_t* const* in, word* const* view, mzd_t* const* rvec,
                               mask_t const* mask) {
   bitsliced_mm_step_1(SC_PROOF, __m256i, _mm256_and_si256, mm256_shift_left);
 
@@ -376,7 +449,7 @@ _mpc_sbox_layer_bitsliced_avx(mzd_t** out, mzd_t* const* in, view_t const* view,
 }
 
 __attribute__((target("avx2"))) static void
-_mpc_sbox_layer_bitsliced_avx_verify(mzd_t** out, mzd_t** in, view_t const* view,
+_mpc_sbox_layer_bitsliced_avx_verify(mzd_t** out, mzd_t* const* in, word* const* view,
                                      mzd_t* const* rvec, mask_t const* mask) {
   bitsliced_mm_step_1(SC_VERIFY, __m256i, _mm256_and_si256, mm256_shift_left);
 
@@ -489,232 +562,234 @@ static mzd_t** _mpc_lowmc_call(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_
 }
 #endif
 
-static mzd_t** _mpc_lowmc_call_bitsliced(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
-                                         mzd_t const* p, view_t* views, mzd_t*** rvec,
-                                         unsigned ch) {
-  mpc_copy(views->s, lowmc_key->shared, SC_PROOF);
-  ++views;
+// mpc_const_mat_mul and mpc_const_add with the kernels of the instance
+
+static inline void mpc_kernel_mul(mzd_t** res, mzd_t const* A, mzd_t* const* v, mzd_mul_fn mul,
+                                  unsigned int sc) {
+  for (unsigned int m = 0; m < sc; ++m) {
+    mul(res[m], v[m], A);
+  }
+}
 
-  sbox_vars_t vars = {{NULL}};
-  sbox_vars_init(&vars, lowmc->n, SC_PROOF);
+static inline void mpc_kernel_const_add(mzd_t** res, mzd_t const* c, mzd_xor_fn xor,
+                                        unsigned int sc, unsigned int ch) {
+  if (ch == 0) {
+    xor(res[0], res[0], c);
+  } else if (ch == sc) {
+    xor(res[sc - 1], res[sc - 1], c);
+  }
+}
+
+// Adds the round key terms t of the first two shares and derives the one of
+// the last share from the expanded key rk, i.e. K * s_2 = rk + t_0 + t_1.
+static inline void mpc_kernel_derived_add(mzd_t** res, mzd_t* const* t, mzd_t const* rk,
+                                          mzd_xor_fn xor) {
+  xor(res[0], res[0], t[0]);
+  xor(res[1], res[1], t[1]);
+  xor(res[2], res[2], rk);
+  xor(res[2], res[2], t[0]);
+  xor(res[2], res[2], t[1]);
+}
+
+static mzd_t** _mpc_lowmc_call_bitsliced(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
+                                         mzd_t const* p, view_t* view, mzd_t*** rvec,
+                                         mzd_t* const* round_keys) {
+  lowmc_kernels_t const* kernels = &lowmc->kernels;
+  // the constants are added by the first share
+  const unsigned int ch = 0;
+  // number of shares whose round keys are computed from the key share
+  const unsigned int sc = round_keys ? SC_PROOF - 1 : SC_PROOF;
+
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    mzd_local_copy_to_row(view->s[m], 0, lowmc_key->shared[m]);
+  }
 
   mzd_t** x = mpc_init_empty_share_vector(lowmc->n, SC_PROOF);
   mzd_t* y[SC_PROOF];
   mzd_local_init_multiple_ex(y, SC_PROOF, 1, lowmc->n, false);
+  mzd_t* t[SC_PROOF - 1] = {NULL};
+  if (round_keys) {
+    mzd_local_init_multiple_ex(t, SC_PROOF - 1, 1, lowmc->n, false);
+  }
 
 #ifdef NOSCR
-  mpc_const_mat_mul_l(x, lowmc->k0_lookup, lowmc_key->shared, SC_PROOF);
+  mpc_kernel_mul(x, lowmc->k0_lookup, lowmc_key->shared, kernels->mzd.mul_vl, sc);
 #else
-  mpc_const_mat_mul(x, lowmc->k0_matrix, lowmc_key->shared, SC_PROOF);
+  mpc_kernel_mul(x, lowmc->k0_matrix, lowmc_key->shared, kernels->mzd.mul_v, sc);
 #endif
-  mpc_const_add(x, x, p, SC_PROOF, ch);
+  if (round_keys) {
+    kernels->mzd.xor(x[2], x[0], x[1]);
+    kernels->mzd.xor(x[2], x[2], round_keys[0]);
+  }
+  mpc_kernel_const_add(x, p, kernels->mzd.xor, SC_PROOF, ch);
 
   lowmc_round_t const* round = lowmc->rounds;
-  for (unsigned i = 0; i < lowmc->r; ++i, ++views, ++round) {
+  for (unsigned i = 0; i < lowmc->r; ++i, ++round) {
     // TODO: fix for SC_PROOF != 3
     mzd_t* r[SC_PROOF] = {rvec[0][i], rvec[1][i], rvec[2][i]};
+    word* v[SC_PROOF]  = {ROW(view->s[0], i + 1), ROW(view->s[1], i + 1),
+                         ROW(view->s[2], i + 1)};
 
-#ifdef WITH_OPT
-#ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2 && lowmc->n <= 128) {
-      _mpc_sbox_layer_bitsliced_sse(y, x, views, r, &lowmc->mask);
-    } else
-#endif
-#ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2 && lowmc->n <= 256) {
-      _mpc_sbox_layer_bitsliced_avx(y, x, views, r, &lowmc->mask);
-    } else
-#endif
-#endif
-    {
-      _mpc_sbox_layer_bitsliced(y, x, views, r, &lowmc->mask, &vars);
-    }
+    kernels->mpc_sbox_layer(y, x, v, r, &lowmc->mask);
 
 #ifdef NOSCR
-    mpc_const_mat_mul_l(x, round->l_lookup, y, SC_PROOF);
+    mpc_kernel_mul(x, round->l_lookup, y, kernels->mzd.mul_vl, SC_PROOF);
 #else
-    mpc_const_mat_mul(x, round->l_matrix, y, SC_PROOF);
+    mpc_kernel_mul(x, round->l_matrix, y, kernels->mzd.mul_v, SC_PROOF);
 #endif
-    mpc_const_add(x, x, round->constant, SC_PROOF, ch);
+    if (round_keys) {
+      // the expanded key includes the constant
 #ifdef NOSCR
-    mpc_const_addmat_mul_l(x, round->k_lookup, lowmc_key->shared, SC_PROOF);
+      mpc_kernel_mul(t, round->k_lookup, lowmc_key->shared, kernels->mzd.mul_vl, sc);
 #else
-    mpc_const_mat_mul(y, round->k_matrix, lowmc_key->shared, SC_PROOF);
-    mpc_add(x, x, y, SC_PROOF);
+      mpc_kernel_mul(t, round->k_matrix, lowmc_key->shared, kernels->mzd.mul_v, sc);
 #endif
+      mpc_kernel_const_add(t, round->constant, kernels->mzd.xor, sc, ch);
+      mpc_kernel_derived_add(x, t, round_keys[i + 1], kernels->mzd.xor);
+    } else {
+      mpc_kernel_const_add(x, round->constant, kernels->mzd.xor, SC_PROOF, ch);
+#ifdef NOSCR
+      mpc_kernel_mul(x, round->k_lookup, lowmc_key->shared, kernels->mzd.addmul_vl, SC_PROOF);
+#else
+      mpc_kernel_mul(x, round->k_matrix, lowmc_key->shared, kernels->mzd.addmul_v, SC_PROOF);
+#endif
+    }
   }
 
-  mpc_copy(views->s, x, SC_PROOF);
-  sbox_vars_clear(&vars);
-
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    mzd_local_copy_to_row(view->s[m], lowmc->r + 1, x[m]);
+  }
+  if (round_keys) {
+    mzd_local_free_multiple(t);
+  }
   mzd_local_free_multiple(y);
   return x;
 }
 
 static mzd_t** _mpc_lowmc_call_bitsliced_verify(mpc_lowmc_t const* lowmc,
                                                 mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
-                                                view_t const* views, mzd_t*** rvec,
+                                                view_t const* view, mzd_t*** rvec,
                                                 unsigned ch, int* status) {
-  ++views;
-
-  sbox_vars_t vars = {{NULL}};
-  sbox_vars_init(&vars, lowmc->n, SC_VERIFY);
+  lowmc_kernels_t const* kernels = &lowmc->kernels;
 
   mzd_t** x           = mpc_init_empty_share_vector(lowmc->n, SC_VERIFY);
   mzd_t* y[SC_VERIFY] = {NULL};
   mzd_local_init_multiple_ex(y, SC_VERIFY, 1, lowmc->n, false);
 
 #ifdef NOSCR
-  mpc_const_mat_mul_l(x, lowmc->k0_lookup, lowmc_key->shared, SC_VERIFY);
+  mpc_kernel_mul(x, lowmc->k0_lookup, lowmc_key->shared, kernels->mzd.mul_vl, SC_VERIFY);
 #else
-  mpc_const_mat_mul(x, lowmc->k0_matrix, lowmc_key->shared, SC_VERIFY);
+  mpc_kernel_mul(x, lowmc->k0_matrix, lowmc_key->shared, kernels->mzd.mul_v, SC_VERIFY);
 #endif
-  mpc_const_add(x, x, p, SC_VERIFY, ch);
+  mpc_kernel_const_add(x, p, kernels->mzd.xor, SC_VERIFY, ch);
 
   lowmc_round_t const* round = lowmc->rounds;
-  for (unsigned i = 0; i < lowmc->r; ++i, ++views, ++round) {
+  for (unsigned i = 0; i < lowmc->r; ++i, ++round) {
     // TODO: fix for SC_VERIFY != 2
     mzd_t* r[SC_VERIFY] = {rvec[0][i], rvec[1][i]};
+    word* v[SC_VERIFY]  = {ROW(view->s[0], i + 1), ROW(view->s[1], i + 1)};
 
-#ifdef WITH_OPT
-#ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2 && lowmc->n <= 128) {
-      _mpc_sbox_layer_bitsliced_sse_verify(y, x, views, r, &lowmc->mask);
-    } else
-#endif
-#ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2 && lowmc->n <= 256) {
-      _mpc_sbox_layer_bitsliced_avx_verify(y, x, views, r, &lowmc->mask);
-    } else
-#endif
-#endif
-    {
-      _mpc_sbox_layer_bitsliced_verify(y, x, views, r, &lowmc->mask, &vars);
-    }
+    kernels->mpc_sbox_layer_verify(y, x, v, r, &lowmc->mask);
 
 #ifdef NOSCR
-    mpc_const_mat_mul_l(x, round->l_lookup, y, SC_VERIFY);
+    mpc_kernel_mul(x, round->l_lookup, y, kernels->mzd.mul_vl, SC_VERIFY);
 #else
-    mpc_const_mat_mul(x, round->l_matrix, y, SC_VERIFY);
+    mpc_kernel_mul(x, round->l_matrix, y, kernels->mzd.mul_v, SC_VERIFY);
 #endif
-    mpc_const_add(x, x, round->constant, SC_VERIFY, ch);
+    mpc_kernel_const_add(x, round->constant, kernels->mzd.xor, SC_VERIFY, ch);
 #ifdef NOSCR
-    mpc_const_addmat_mul_l(x, round->k_lookup, lowmc_key->shared, SC_VERIFY);
+    mpc_kernel_mul(x, round->k_lookup, lowmc_key->shared, kernels->mzd.addmul_vl, SC_VERIFY);
 #else
-    mpc_const_mat_mul(y, round->k_matrix, lowmc_key->shared, SC_VERIFY);
-    mpc_add(x, x, y, SC_VERIFY);
+    mpc_kernel_mul(x, round->k_matrix, lowmc_key->shared, kernels->mzd.addmul_v, SC_VERIFY);
 #endif
   }
 
-  mzd_copy(views->s[0], x[0]);
+  for (unsigned int m = 0; m < SC_VERIFY; ++m) {
+    mzd_local_copy_to_row(view->s[m], lowmc->r + 1, x[m]);
+  }
 
-  sbox_vars_clear(&vars);
   mzd_local_free_multiple(y);
   return x;
 }
 
 mzd_t** mpc_lowmc_call(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
-                       view_t* views, mzd_t*** rvec) {
-  return _mpc_lowmc_call_bitsliced(lowmc, lowmc_key, p, views, rvec, 0);
+                       view_t* view, mzd_t*** rvec, mzd_t* const* round_keys) {
+  if (lowmc->impl) {
+    return lowmc->impl->mpc_lowmc_call(lowmc, lowmc_key, p, view, rvec, round_keys);
+  }
+  return _mpc_lowmc_call_bitsliced(lowmc, lowmc_key, p, view, rvec, round_keys);
 }
 
 static int _mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
-                             view_t const* views, mzd_t*** rvec, int c) {
+                             view_t const* view, mzd_t*** rvec, int c) {
   int status = 0;
-  mzd_t** v = _mpc_lowmc_call_bitsliced_verify(lowmc, lowmc_key, p, views, rvec, c, &status);
+  mzd_t** v  = lowmc->impl
+                  ? lowmc->impl->mpc_lowmc_verify(lowmc, lowmc_key, p, view, rvec, c)
+                  : _mpc_lowmc_call_bitsliced_verify(lowmc, lowmc_key, p, view, rvec, c, &status);
   mpc_free(v, SC_VERIFY);
-#if 0
-  if (v) {
-    for (unsigned int i = 0; i < SC_VERIFY; ++i) {
-      if (!mzd_local_equal(views[lowmc->r + 1].s[i], v[i])) {
-        status = 1;
-        break;
-      }
-    }
-    mpc_free(v, SC_VERIFY);
-  }
-#endif
   mzd_shared_clear(lowmc_key);
   return status;
 }
 
-int mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* views,
-                     mzd_t*** rvec, int c) {
+static void key_from_view(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
+                          view_t const* view) {
+  lowmc_key->share_count = SC_VERIFY;
+  mzd_local_init_multiple_ex(lowmc_key->shared, 3, 1, lowmc->k, false);
+  for (unsigned int m = 0; m < SC_VERIFY; ++m) {
+    mzd_local_copy_from_row(lowmc_key->shared[m], view->s[m], 0);
+  }
+}
+
+int mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* view, mzd_t*** rvec,
+                     int c) {
   mpc_lowmc_key_t lowmc_key;
-  mzd_shared_from_shares(&lowmc_key, views[0].s, SC_VERIFY);
-  lowmc_key.share_count = 2;
+  key_from_view(lowmc, &lowmc_key, view);
 
-  return _mpc_lowmc_verify(lowmc, &lowmc_key, p, views, rvec, c);
+  return _mpc_lowmc_verify(lowmc, &lowmc_key, p, view, rvec, c);
 }
 
-int mpc_lowmc_verify_keys(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* views,
+int mpc_lowmc_verify_keys(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* view,
                           mzd_t*** rvec, int c, const unsigned char keys[2][16]) {
+  (void)keys;
+
   mpc_lowmc_key_t lowmc_key;
-  mzd_shared_from_shares(&lowmc_key, views[0].s, SC_VERIFY);
-  lowmc_key.share_count = 2;
+  key_from_view(lowmc, &lowmc_key, view);
 
-  return _mpc_lowmc_verify(lowmc, &lowmc_key, p, views, rvec, c);
+  return _mpc_lowmc_verify(lowmc, &lowmc_key, p, view, rvec, c);
 }
 
-void sbox_vars_clear(sbox_vars_t* vars) {
-  if (vars->storage) {
-    mzd_local_free_multiple(vars->storage);
-    free(vars->storage);
-    memset(vars, 0, sizeof(*vars));
-  }
+void clear_proof(mpc_lowmc_t const* lowmc, proof_t* proof) {
+  (void)lowmc;
+
+  mzd_local_free_multiple(&proof->view_storage);
+  proof->view_storage = NULL;
+  memset(proof->views, 0, proof->num_rounds * sizeof(view_t));
 }
 
-sbox_vars_t* sbox_vars_init(sbox_vars_t* vars, rci_t n, unsigned sc) {
+void free_proof(mpc_lowmc_t const* mpc_lowmc, proof_t* proof) {
+  clear_proof(mpc_lowmc, proof);
+  free(proof);
+}
+
+void mpc_lowmc_select_sbox_layers(lowmc_kernels_t* kernels, size_t n, unsigned int features) {
+  kernels->mpc_sbox_layer        = _mpc_sbox_layer_bitsliced;
+  kernels->mpc_sbox_layer_verify = _mpc_sbox_layer_bitsliced_verify;
 #ifdef WITH_OPT
-#ifdef WITH_AVX2
-  if (CPU_SUPPORTS_AVX2 && n <= 256) {
-    vars->storage = NULL;
-    return vars;
+#ifdef WITH_SSE2
+  if ((features & CPU_FEATURE_SSE2) && n <= 128) {
+    kernels->mpc_sbox_layer        = _mpc_sbox_layer_bitsliced_sse;
+    kernels->mpc_sbox_layer_verify = _mpc_sbox_layer_bitsliced_sse_verify;
   }
 #endif
-#ifdef WITH_SSE2
-  if (CPU_SUPPORTS_SSE2 && n <= 128) {
-    vars->storage = NULL;
-    return vars;
+#ifdef WITH_AVX2
+  // view rows are only padded to 32 bytes for more than 128 bits
+  if ((features & CPU_FEATURE_AVX2) && n > 128 && n <= 256) {
+    kernels->mpc_sbox_layer        = _mpc_sbox_layer_bitsliced_avx;
+    kernels->mpc_sbox_layer_verify = _mpc_sbox_layer_bitsliced_avx_verify;
   }
 #endif
+#else
+  (void)n;
+  (void)features;
 #endif
-
-  vars->storage = calloc(11 * sc, sizeof(mzd_t*));
-  mzd_local_init_multiple_ex(vars->storage, 11 * sc, 1, n, false);
-
-  for (unsigned int i = 0; i < sc; ++i) {
-    vars->x0m[i] = vars->storage[11 * i + 0];
-    vars->x1m[i] = vars->storage[11 * i + 1];
-    vars->x2m[i] = vars->storage[11 * i + 2];
-    vars->r0m[i] = vars->storage[11 * i + 3];
-    vars->r1m[i] = vars->storage[11 * i + 4];
-    vars->r2m[i] = vars->storage[11 * i + 5];
-    vars->x0s[i] = vars->storage[11 * i + 6];
-    vars->x1s[i] = vars->storage[11 * i + 7];
-    vars->r0s[i] = vars->storage[11 * i + 8];
-    vars->r1s[i] = vars->storage[11 * i + 9];
-    vars->v[i]   = vars->storage[11 * i + 10];
-  }
-
-  return vars;
-}
-
-void clear_proof(mpc_lowmc_t const* lowmc, proof_t const* proof) {
-  const size_t numrounds = lowmc->r + 2;
-
-  for (unsigned int i = 0; i < NUM_ROUNDS; ++i) {
-    for (unsigned int j = 0; j < numrounds; ++j) {
-      for (unsigned int k = 0; k < SC_PROOF; ++k) {
-        mzd_local_free(proof->views[i][j].s[k]);
-        proof->views[i][j].s[k] = NULL;
-      }
-    }
-    free(proof->views[i]);
-  }
-}
-
-void free_proof(mpc_lowmc_t const* mpc_lowmc, proof_t* proof) {
-  clear_proof(mpc_lowmc, proof);
-  free(proof);
 }
@@ -12,68 +12,147 @@ typedef mzd_shared_t mpc_lowmc_key_t;
 
 typedef lowmc_t mpc_lowmc_t;
 
+/**
+ * Views of the parties in one repetition. s[m] is the view of party m as one
+ * matrix with r + 2 rows: the key share, the outputs of the AND gates of each
+ * round and the output share.
+ */
 typedef struct { mzd_t* s[SC_PROOF]; } view_t;
 
+/**
+ * A proof consisting of num_rounds repetitions. The arrays are stored in the
+ * same allocation as the proof itself.
+ */
 typedef struct {
-  view_t* views[NUM_ROUNDS];
-  unsigned char keys[NUM_ROUNDS][SC_VERIFY][PRNG_KEYSIZE];
-  unsigned char r[NUM_ROUNDS][SC_VERIFY][COMMITMENT_RAND_LENGTH];
-  unsigned char hashes[NUM_ROUNDS][COMMITMENT_LENGTH];
-  unsigned char ch[(NUM_ROUNDS + 3) / 4];
+  unsigned int num_rounds;
+  view_t* views;
+  // the views of all repetitions share the memory block of this matrix
+  mzd_t* view_storage;
+  unsigned char (*keys)[SC_VERIFY][PRNG_KEYSIZE];
+  unsigned char (*r)[SC_VERIFY][COMMITMENT_RAND_LENGTH];
+  unsigned char (*hashes)[COMMITMENT_LENGTH];
+  unsigned char* ch;
 } proof_t;
 
-proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned char* data,
+proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, unsigned int num_rounds, unsigned char* data,
                                unsigned* len, bool contains_ch);
 
 unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned* len,
                                    bool store_ch);
 
+/**
+ * Upper bound of the size of any serialized proof.
+ */
+unsigned proof_max_size(mpc_lowmc_t const* lowmc, unsigned int num_rounds, bool store_ch);
+
+/**
+ * Size of the serialization of the given proof.
+ */
+unsigned proof_size(mpc_lowmc_t const* lowmc, proof_t const* proof, bool store_ch);
+
+/**
+ * Serializes a proof into buf without any intermediate allocations.
+ *
+ * \return the number of bytes written or 0 if buflen is too small
+ */
+unsigned proof_to_buffer(mpc_lowmc_t const* lowmc, proof_t const* proof, unsigned char* buf,
+                         unsigned buflen, bool store_ch);
+
+/**
+ * Serializes the views of the two opened parties of one repetition, i.e. s[0]
+ * and s[1] after create_proof, as stored after the seeds. As in ZKB++, only
+ * the data the verifier cannot recompute is stored: the key share of the third
+ * party if it is opened and the outputs of the AND gates of s[1], but no output
+ * shares.
+ *
+ * \return the number of bytes written
+ */
+unsigned views_to_char_array(mpc_lowmc_t const* lowmc, unsigned char* dst, view_t const* view,
+                             unsigned int ch);
+
+/**
+ * Parses the views of the two opened parties of one repetition. data points to
+ * the view data following the seeds, views derived from seeds are recomputed
+ * from keys. The views have to be allocated with init_views(.., SC_VERIFY).
+ * The output shares are only available after mpc_lowmc_verify.
+ *
+ * \return the number of bytes read
+ */
+unsigned views_from_char_array(mpc_lowmc_t const* lowmc, view_t* view, unsigned char const* data,
+                               const unsigned char keys[SC_VERIFY][PRNG_KEYSIZE],
+                               unsigned int ch);
+
+/**
+ * Allocates the views of sc parties for count repetitions in one memory block.
+ * The returned matrix has to be freed with mzd_local_free_multiple.
+ */
+mzd_t* init_views(mpc_lowmc_t const* lowmc, view_t* views, unsigned int count, unsigned int sc);
+
+/**
+ * Allocates a proof with num_rounds repetitions and the views of sc parties
+ * for all of them in one memory block.
+ */
+proof_t* init_proof(mpc_lowmc_t const* lowmc, unsigned int num_rounds, unsigned int sc);
+
+/**
+ * Completes a proof whose views were produced with init_proof(.., SC_PROOF).
+ * The views of the opened parties are moved to s[0] and s[1].
+ */
 proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
-                      unsigned char hashes[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH],
-                      unsigned char ch[NUM_ROUNDS],
-                      unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH],
-                      unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE],
-                      view_t* const views[NUM_ROUNDS]);
+                      unsigned char hashes[][SC_PROOF][COMMITMENT_LENGTH], unsigned char ch[],
+                      unsigned char r[][SC_PROOF][COMMITMENT_RAND_LENGTH],
+                      unsigned char keys[][SC_PROOF][PRNG_KEYSIZE]);
 
-void clear_proof(mpc_lowmc_t const* lowmc, proof_t const* proof);
+void clear_proof(mpc_lowmc_t const* lowmc, proof_t* proof);
 void free_proof(mpc_lowmc_t const* lowmc, proof_t* proof);
 
 /**
  * Implements MPC LowMC encryption according to
  * https://eprint.iacr.org/2016/163.pdf
  *
- * \param  lowmc     the lowmc parameters
- * \param  lowmc_key the lowmc key
- * \param  p         the plaintext
- * \param  views     the views
- * \param  rvec      the randomness vector
- * \return           the ciphertext
+ * \param  lowmc      the lowmc parameters
+ * \param  lowmc_key  the lowmc key
+ * \param  p          the plaintext
+ * \param  view       the view of the repetition
+ * \param  rvec       the randomness vector
+ * \param  round_keys the expanded key (see lowmc_expand_key) if the key was
+ *                    shared with mzd_shared_share_from_keys, or NULL. It saves
+ *                    the key schedule of the last share, which is derived from
+ *                    the other shares.
+ * \return            the ciphertext
  */
 mzd_t** mpc_lowmc_call(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
-                       view_t* views, mzd_t*** rvec);
+                       view_t* view, mzd_t*** rvec, mzd_t* const* round_keys);
 
 /**
- * Verifies a ZKBoo execution of a LowMC encryption
+ * Verifies a ZKBoo execution of a LowMC encryption. The view of the first
+ * party is recomputed and the output shares of both parties are written to
+ * the last rows of their views.
  *
  * \param  lowmc     the lowmc parameters
  * \param  p         the plaintext
- * \param  views     the views
+ * \param  view      the view of the repetition
  * \param  rvec      the randomness vector
  * \return           0 on success and a value != 0 otherwise
  */
-int mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* views,
-                     mzd_t*** rvec, int c);
+int mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* view, mzd_t*** rvec,
+                     int c);
 
 /**
  * Verifies a ZKBoo execution of a LowMC encryption
  *
  * \param  lowmc     the lowmc parameters
  * \param  p         the plaintext
- * \param  views     the views
+ * \param  view      the view of the repetition
  * \param  rvec      the randomness vector
  * \return           0 on success and a value != 0 otherwise
  */
-int mpc_lowmc_verify_keys(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* views,
+int mpc_lowmc_verify_keys(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* view,
                           mzd_t*** rvec, int c, const unsigned char keys[2][16]);
 
+/**
+ * Selects the S-box layers of the MPC prover and verifier for block size n.
+ */
+void mpc_lowmc_select_sbox_layers(lowmc_kernels_t* kernels, size_t n, unsigned int features);
+
 #endif
@@ -0,0 +1,421 @@
+#include "mpc_lowmc_kkw.h"
+#include "block.h"
+#include "randomness.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+kkw_transcript_t* kkw_transcript_init(lowmc_t const* lowmc, unsigned int num_parties) {
+  kkw_transcript_t* transcript = calloc(1, sizeof(kkw_transcript_t));
+  if (!transcript) {
+    return NULL;
+  }
+
+  transcript->num_parties = num_parties;
+  transcript->aux         = mzd_local_init(lowmc->r, lowmc->n);
+  transcript->masked_key  = mzd_local_init(1, lowmc->k);
+  mzd_local_init_multiple(transcript->msgs, num_parties, lowmc->r + 1, lowmc->n);
+  return transcript;
+}
+
+void kkw_transcript_free(kkw_transcript_t* transcript) {
+  if (transcript) {
+    mzd_local_free_multiple(transcript->msgs);
+    mzd_local_free(transcript->masked_key);
+    mzd_local_free(transcript->aux);
+    free(transcript);
+  }
+}
+
+typedef struct {
+  block_t x0;
+  block_t x1;
+  block_t x2;
+  block_t mask;
+  // the bits of the S-boxes, i.e. the bits of the packed AND gates
+  block_t sbox;
+} kkw_masks_t;
+
+static void kkw_load_masks(kkw_masks_t* masks, mask_t const* mask, unsigned int width) {
+  memset(masks, 0, sizeof(*masks));
+  block_load(&masks->x0, mask->x0);
+  block_load(&masks->x1, mask->x1);
+  block_load(&masks->x2, mask->x2);
+  block_load(&masks->mask, mask->mask);
+  block_xor(&masks->sbox, &masks->x0, &masks->x1, width);
+  block_xor(&masks->sbox, &masks->sbox, &masks->x2, width);
+}
+
+static inline void kkw_load_row(block_t* res, mzd_t const* A, unsigned int i, unsigned int width) {
+  memcpy(res->w, CONST_ROW(A, i), width * sizeof(word));
+}
+
+static inline void kkw_store_row(mzd_t* A, unsigned int i, block_t const* val, unsigned int width) {
+  memcpy(ROW(A, i), val->w, width * sizeof(word));
+}
+
+// Splits the inputs of the S-boxes into a, b and c aligned to the bits of c
+// (see sbox_layer_bitsliced).
+static inline void kkw_split(block_t abc[3], block_t const* in, kkw_masks_t const* masks,
+                             unsigned int width) {
+  block_and(&abc[0], in, &masks->x0, width);
+  block_shift_left(&abc[0], &abc[0], 2, width);
+  block_and(&abc[1], in, &masks->x1, width);
+  block_shift_left(&abc[1], &abc[1], 1, width);
+  block_and(&abc[2], in, &masks->x2, width);
+}
+
+// Adds the packed AND gates x_a * y_b, x_b * y_c and x_a * y_c to res. They
+// are packed like the views, i.e. shifted by 0, 2 and 1 bits.
+static inline void kkw_addand(block_t* res, block_t const x[3], block_t const y[3],
+                              unsigned int width) {
+  block_t t;
+  block_and(&t, &x[0], &y[1], width);
+  block_xor(res, res, &t, width);
+  block_and(&t, &x[1], &y[2], width);
+  block_shift_right(&t, &t, 2, width);
+  block_xor(res, res, &t, width);
+  block_and(&t, &x[0], &y[2], width);
+  block_shift_right(&t, &t, 1, width);
+  block_xor(res, res, &t, width);
+}
+
+// The S-box layer with the AND gates replaced by the packed values z. It maps
+// masked inputs to masked outputs and masks to masks.
+static inline void kkw_sbox(block_t* out, block_t const* in, block_t const abc[3],
+                            block_t const* z, kkw_masks_t const* masks, unsigned int width) {
+  block_t t, u;
+  block_and(out, in, &masks->mask, width);
+  block_xor(out, out, z, width);
+
+  block_shift_right(&u, &abc[0], 2, width);
+  block_xor(out, out, &u, width);
+  block_xor(&t, &abc[0], &abc[1], width);
+  block_shift_right(&u, &t, 1, width);
+  block_xor(out, out, &u, width);
+  block_xor(&t, &t, &abc[2], width);
+  block_xor(out, out, &t, width);
+}
+
+static void kkw_mul_k0(lowmc_t const* lowmc, mzd_t* res, mzd_t const* key) {
+#ifdef NOSCR
+  lowmc->kernels.mzd.mul_vl(res, key, lowmc->k0_lookup);
+#else
+  lowmc->kernels.mzd.mul_v(res, key, lowmc->k0_matrix);
+#endif
+}
+
+// Computes the linear layer and adds the round key for count parties. With
+// lookup tables, each table is traversed once for all parties.
+static void kkw_linear(lowmc_t const* lowmc, lowmc_round_t const* round, mzd_t** res,
+                       mzd_t const* const* y, mzd_t const* const* key, unsigned int count) {
+#ifdef NOSCR
+  lowmc->kernels.mzd.mul_vlm(res, y, round->l_lookup, count);
+  lowmc->kernels.mzd.addmul_vlm(res, key, round->k_lookup, count);
+#else
+  for (unsigned int q = 0; q < count; ++q) {
+    lowmc->kernels.mzd.mul_v(res[q], y[q], round->l_matrix);
+    lowmc->kernels.mzd.addmul_v(res[q], key[q], round->k_matrix);
+  }
+#endif
+}
+
+// Mask shares of count parties. Without the online phase, the masks are only
+// needed in sum and one slot holds the sum of all parties.
+typedef struct {
+  unsigned int count;
+  unsigned int rounds;
+  mzd_t* key[KKW_MAX_PARTIES];
+  mzd_t* state[KKW_MAX_PARTIES];
+  mzd_t* y[KKW_MAX_PARTIES];
+  mzd_t* tmp_key;
+  // the tapes: shares of the AND gates' output masks and of the products of
+  // their input masks, one block per party and round
+  block_t* z;
+  block_t* ab;
+} kkw_parties_t;
+
+static bool kkw_parties_init(kkw_parties_t* parties, lowmc_t const* lowmc, unsigned int count) {
+  parties->count  = count;
+  parties->rounds = lowmc->r;
+  mzd_local_init_multiple(parties->key, count, 1, lowmc->k);
+  mzd_local_init_multiple(parties->state, count, 1, lowmc->n);
+  mzd_local_init_multiple(parties->y, count, 1, lowmc->n);
+  parties->tmp_key = mzd_local_init_ex(1, lowmc->k, false);
+
+  const size_t size = 2 * count * lowmc->r * sizeof(block_t);
+  parties->z        = aligned_alloc(alignof(block_t), size);
+  parties->ab       = parties->z ? parties->z + count * lowmc->r : NULL;
+  if (!parties->z) {
+    return false;
+  }
+  memset(parties->z, 0, size);
+  return true;
+}
+
+static void kkw_parties_clear(kkw_parties_t* parties) {
+  free(parties->z);
+  mzd_local_free(parties->tmp_key);
+  mzd_local_free_multiple(parties->y);
+  mzd_local_free_multiple(parties->state);
+  mzd_local_free_multiple(parties->key);
+}
+
+static inline block_t* kkw_z(kkw_parties_t const* parties, unsigned int slot, unsigned int i) {
+  return &parties->z[slot * parties->rounds + i];
+}
+
+static inline block_t* kkw_ab(kkw_parties_t const* parties, unsigned int slot, unsigned int i) {
+  return &parties->ab[slot * parties->rounds + i];
+}
+
+// Expands the seed of a party to its tape and adds it to the given slot. If
+// ab_sum is set, the shares of the products are also added there.
+static void kkw_add_tape(lowmc_t const* lowmc, kkw_parties_t* parties, unsigned int slot,
+                         const unsigned char seed[KKW_SEED_SIZE], kkw_masks_t const* masks,
+                         block_t* ab_sum, unsigned int width) {
+  aes_prng_t aes_prng;
+  aes_prng_init(&aes_prng, seed);
+
+  mzd_randomize_aes_prng(parties->tmp_key, &aes_prng);
+  mzd_xor(parties->key[slot], parties->key[slot], parties->tmp_key);
+
+  for (unsigned int i = 0; i < lowmc->r; ++i) {
+    block_t t;
+    aes_prng_get_randomness(&aes_prng, (unsigned char*)t.w, width * sizeof(word));
+    block_and(&t, &t, &masks->sbox, width);
+    block_xor(kkw_z(parties, slot, i), kkw_z(parties, slot, i), &t, width);
+
+    aes_prng_get_randomness(&aes_prng, (unsigned char*)t.w, width * sizeof(word));
+    block_and(&t, &t, &masks->sbox, width);
+    block_xor(kkw_ab(parties, slot, i), kkw_ab(parties, slot, i), &t, width);
+    if (ab_sum) {
+      block_xor(&ab_sum[i], &ab_sum[i], &t, width);
+    }
+  }
+
+  aes_prng_clear(&aes_prng);
+}
+
+// Computes the message of a party for the AND gates of a round. s holds the
+// masked inputs of the S-boxes and x the party's shares of their masks.
+static inline void kkw_message(block_t* msg, block_t const s[3], block_t const x[3],
+                               block_t const* ab, block_t const* z, unsigned int width) {
+  block_xor(msg, ab, z, width);
+  kkw_addand(msg, s, x, width);
+  kkw_addand(msg, x, s, width);
+}
+
+void mpc_lowmc_kkw_prove(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p,
+                         const unsigned char seeds[][KKW_SEED_SIZE],
+                         kkw_transcript_t* transcript) {
+  const unsigned int num_parties = transcript->num_parties;
+  const unsigned int last        = num_parties - 1;
+  const unsigned int width       = (lowmc->n + 63) / 64;
+  const unsigned int count       = lowmc_key ? num_parties : 1;
+
+  kkw_masks_t masks;
+  kkw_load_masks(&masks, &lowmc->mask, width);
+
+  kkw_parties_t parties;
+  block_t* ab_sum = aligned_alloc(alignof(block_t), lowmc->r * sizeof(block_t));
+  if (!kkw_parties_init(&parties, lowmc, count) || !ab_sum) {
+    free(ab_sum);
+    kkw_parties_clear(&parties);
+    return;
+  }
+  memset(ab_sum, 0, lowmc->r * sizeof(block_t));
+
+  // the product shares of the last party are replaced by the aux
+  for (unsigned int q = 0; q < num_parties; ++q) {
+    kkw_add_tape(lowmc, &parties, count == 1 ? 0 : q, seeds[q], &masks,
+                 q == last ? NULL : ab_sum, width);
+  }
+  for (unsigned int q = 0; q < count; ++q) {
+    kkw_mul_k0(lowmc, parties.state[q], parties.key[q]);
+  }
+
+  mzd_t* s = NULL;
+  mzd_t* y = NULL;
+  if (lowmc_key) {
+    s = mzd_local_init_ex(1, lowmc->n, false);
+    y = mzd_local_init_ex(1, lowmc->n, false);
+    mzd_local_copy(transcript->masked_key, lowmc_key);
+    for (unsigned int q = 0; q < count; ++q) {
+      mzd_xor(transcript->masked_key, transcript->masked_key, parties.key[q]);
+    }
+    kkw_mul_k0(lowmc, s, transcript->masked_key);
+    mzd_xor(s, s, p);
+  }
+
+  // the linear layers of the parties and of the masked state are computed
+  // together, the masked state comes last
+  mzd_t* states[KKW_MAX_PARTIES + 1];
+  mzd_t const* ys[KKW_MAX_PARTIES + 1];
+  mzd_t const* keys[KKW_MAX_PARTIES + 1];
+  for (unsigned int q = 0; q < count; ++q) {
+    states[q] = parties.state[q];
+    ys[q]     = parties.y[q];
+    keys[q]   = parties.key[q];
+  }
+  states[count] = s;
+  ys[count]     = y;
+  keys[count]   = transcript->masked_key;
+
+  lowmc_round_t const* round = lowmc->rounds;
+  for (unsigned int i = 0; i < lowmc->r; ++i, ++round) {
+    block_t t, lambda, aux, abc[3];
+    memset(&lambda, 0, sizeof(lambda));
+    for (unsigned int q = 0; q < count; ++q) {
+      block_load(&t, parties.state[q]);
+      block_xor(&lambda, &lambda, &t, width);
+    }
+
+    kkw_split(abc, &lambda, &masks, width);
+    aux = ab_sum[i];
+    kkw_addand(&aux, abc, abc, width);
+    kkw_store_row(transcript->aux, i, &aux, width);
+
+    if (!lowmc_key) {
+      block_t out;
+      kkw_sbox(&out, &lambda, abc, kkw_z(&parties, 0, i), &masks, width);
+      block_store(parties.y[0], &out);
+      kkw_linear(lowmc, round, states, ys, keys, 1);
+      continue;
+    }
+
+    // initialized since gcc cannot tell that kkw_split only reads written words
+    block_t in, sabc[3] = {{{0}}}, z;
+    block_load(&in, s);
+    kkw_split(sabc, &in, &masks, width);
+    memset(&z, 0, sizeof(z));
+    kkw_addand(&z, sabc, sabc, width);
+
+    for (unsigned int q = 0; q < count; ++q) {
+      block_t x, xabc[3] = {{{0}}}, msg, out;
+      block_load(&x, parties.state[q]);
+      kkw_split(xabc, &x, &masks, width);
+
+      kkw_message(&msg, sabc, xabc, q == last ? &aux : kkw_ab(&parties, q, i),
+                  kkw_z(&parties, q, i), width);
+      kkw_store_row(transcript->msgs[q], i, &msg, width);
+      block_xor(&z, &z, &msg, width);
+
+      kkw_sbox(&out, &x, xabc, kkw_z(&parties, q, i), &masks, width);
+      block_store(parties.y[q], &out);
+    }
+
+    block_t out;
+    kkw_sbox(&out, &in, sabc, &z, &masks, width);
+    block_store(y, &out);
+    kkw_linear(lowmc, round, states, ys, keys, count + 1);
+    mzd_xor(s, s, round->constant);
+  }
+
+  if (lowmc_key) {
+    for (unsigned int q = 0; q < count; ++q) {
+      mzd_local_copy_to_row(transcript->msgs[q], lowmc->r, parties.state[q]);
+    }
+    mzd_local_free(y);
+    mzd_local_free(s);
+  }
+
+  free(ab_sum);
+  kkw_parties_clear(&parties);
+}
+
+int mpc_lowmc_kkw_verify(lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
+                         const unsigned char seeds[][KKW_SEED_SIZE], unsigned int hidden,
+                         kkw_transcript_t* transcript) {
+  const unsigned int num_parties = transcript->num_parties;
+  const unsigned int last        = num_parties - 1;
+  const unsigned int width       = (lowmc->n + 63) / 64;
+
+  kkw_masks_t masks;
+  kkw_load_masks(&masks, &lowmc->mask, width);
+
+  kkw_parties_t parties;
+  if (!kkw_parties_init(&parties, lowmc, num_parties)) {
+    kkw_parties_clear(&parties);
+    return -1;
+  }
+
+  for (unsigned int q = 0; q < num_parties; ++q) {
+    if (q != hidden) {
+      kkw_add_tape(lowmc, &parties, q, seeds[q], &masks, NULL, width);
+      kkw_mul_k0(lowmc, parties.state[q], parties.key[q]);
+    }
+  }
+
+  mzd_t* s = mzd_local_init_ex(1, lowmc->n, false);
+  mzd_t* y = mzd_local_init_ex(1, lowmc->n, false);
+  kkw_mul_k0(lowmc, s, transcript->masked_key);
+  mzd_xor(s, s, p);
+
+  // as in mpc_lowmc_kkw_prove, without the hidden party
+  mzd_t* states[KKW_MAX_PARTIES];
+  mzd_t const* ys[KKW_MAX_PARTIES];
+  mzd_t const* keys[KKW_MAX_PARTIES];
+  unsigned int active = 0;
+  for (unsigned int q = 0; q < num_parties; ++q) {
+    if (q != hidden) {
+      states[active] = parties.state[q];
+      ys[active]     = parties.y[q];
+      keys[active]   = parties.key[q];
+      ++active;
+    }
+  }
+  states[active] = s;
+  ys[active]     = y;
+  keys[active]   = transcript->masked_key;
+
+  lowmc_round_t const* round = lowmc->rounds;
+  for (unsigned int i = 0; i < lowmc->r; ++i, ++round) {
+    // initialized since gcc cannot tell that kkw_split only reads written words
+    block_t in, sabc[3] = {{{0}}}, z, aux;
+    block_load(&in, s);
+    kkw_split(sabc, &in, &masks, width);
+    kkw_load_row(&z, transcript->msgs[hidden], i, width);
+    kkw_addand(&z, sabc, sabc, width);
+    kkw_load_row(&aux, transcript->aux, i, width);
+
+    for (unsigned int q = 0; q < num_parties; ++q) {
+      if (q == hidden) {
+        continue;
+      }
+
+      block_t x, xabc[3] = {{{0}}}, msg, out;
+      block_load(&x, parties.state[q]);
+      kkw_split(xabc, &x, &masks, width);
+
+      kkw_message(&msg, sabc, xabc, q == last ? &aux : kkw_ab(&parties, q, i),
+                  kkw_z(&parties, q, i), width);
+      kkw_store_row(transcript->msgs[q], i, &msg, width);
+      block_xor(&z, &z, &msg, width);
+
+      kkw_sbox(&out, &x, xabc, kkw_z(&parties, q, i), &masks, width);
+      block_store(parties.y[q], &out);
+    }
+
+    block_t out;
+    kkw_sbox(&out, &in, sabc, &z, &masks, width);
+    block_store(y, &out);
+    kkw_linear(lowmc, round, states, ys, keys, active + 1);
+    mzd_xor(s, s, round->constant);
+  }
+
+  // the output mask shares add up to the masked output plus the ciphertext
+  mzd_xor(s, s, c);
+  for (unsigned int q = 0; q < num_parties; ++q) {
+    if (q != hidden) {
+      mzd_local_copy_to_row(transcript->msgs[q], lowmc->r, parties.state[q]);
+      mzd_xor(s, s, parties.state[q]);
+    }
+  }
+  mzd_local_copy_to_row(transcript->msgs[hidden], lowmc->r, s);
+
+  mzd_local_free(y);
+  mzd_local_free(s);
+  kkw_parties_clear(&parties);
+  return 0;
+}
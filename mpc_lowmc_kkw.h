@@ -0,0 +1,56 @@
+#ifndef MPC_LOWMC_KKW_H
+#define MPC_LOWMC_KKW_H
+
+#include "lowmc_pars.h"
+#include "parameters.h"
+
+/**
+ * N-party MPC of LowMC with preprocessing according to
+ * https://eprint.iacr.org/2018/475.pdf
+ *
+ * Every wire carries a public masked value, the masks are secret shared among
+ * the parties. The preprocessing derives each party's shares of the masks from
+ * its seed. Only the shares of the products of the AND gates' input masks need
+ * a correction (aux), which is folded into the share of the last party. In the
+ * online phase the parties broadcast one message per AND gate. As in the views
+ * of mpc_lowmc_call, the three AND gates of the S-boxes of a round are packed
+ * into one vector, so the parties process all S-boxes at once.
+ */
+typedef struct {
+  unsigned int num_parties;
+  // correction of the last party, one row per round
+  mzd_t* aux;
+  // the key masked with the parties' key masks
+  mzd_t* masked_key;
+  // the messages of each party, one row per round, and its share of the
+  // output mask in row r
+  mzd_t* msgs[KKW_MAX_PARTIES];
+} kkw_transcript_t;
+
+kkw_transcript_t* kkw_transcript_init(lowmc_t const* lowmc, unsigned int num_parties);
+void kkw_transcript_free(kkw_transcript_t* transcript);
+
+/**
+ * Runs the preprocessing and, if lowmc_key is set, the online phase of an
+ * encryption of p for all parties.
+ *
+ * \param seeds the seeds of the parties
+ */
+void mpc_lowmc_kkw_prove(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p,
+                         const unsigned char seeds[][KKW_SEED_SIZE],
+                         kkw_transcript_t* transcript);
+
+/**
+ * Recomputes the online phase of an encryption of p to c from the seeds of all
+ * parties but the hidden one. The aux (unless the last party is hidden), the
+ * masked key and the messages of the hidden party are read from the
+ * transcript. The messages of all other parties and the output mask share of
+ * the hidden party are written to it.
+ *
+ * \return 0 on success and -1 if the memory could not be allocated
+ */
+int mpc_lowmc_kkw_verify(lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
+                         const unsigned char seeds[][KKW_SEED_SIZE], unsigned int hidden,
+                         kkw_transcript_t* transcript);
+
+#endif
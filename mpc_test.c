@@ -6,9 +6,26 @@
 
 #include "mpc_test.h"
 
+#include "lowmc.h"
+#include "lowmc_impl.h"
+#include "lowmc_pars.h"
 #include "mpc.h"
-#include "mzd_additional.h"
+#include "mpc_lowmc.h"
+#include "mpc_lowmc_kkw.h"
 #include "multithreading.h"
+#include "mzd_additional.h"
+#include "mzd_pool.h"
+#include "randomness.h"
+#include "signature_fis.h"
+#include "signature_kkw.h"
+#include "tree.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 static void test_mpc_share(void) {
   mzd_t* t1    = mzd_init_random_vector(10);
@@ -100,6 +117,90 @@ static void test_mzd_mul(void) {
   }
 }
 
+// Compares the kernels selected for all instruction sets with the generic ones.
+static void test_mzd_kernels(void) {
+  static const unsigned int sizes[] = {128, 192, 256, 512};
+  for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    const unsigned int n = sizes[i];
+
+    mzd_kernels_t generic, simd;
+    mzd_select_kernels(&generic, n, 0);
+    mzd_select_kernels(&simd, n, CPU_FEATURE_SSE2 | CPU_FEATURE_AVX2);
+
+    mzd_t* A  = mzd_local_init(n, n);
+    mzd_t* v  = mzd_local_init(1, n);
+    mzd_t* c0 = mzd_local_init(1, n);
+    mzd_t* c1 = mzd_local_init(1, n);
+    mzd_randomize_ssl(A);
+    mzd_randomize_ssl(v);
+    mzd_t* Al = mzd_precompute_matrix_lookup(A);
+
+    mzd_mul_fn const muls[][2] = {{generic.mul_v, simd.mul_v},
+                                  {generic.addmul_v, simd.addmul_v},
+                                  {generic.mul_vl, simd.mul_vl},
+                                  {generic.addmul_vl, simd.addmul_vl}};
+    for (unsigned int j = 0; j < 4; ++j) {
+      mzd_randomize_ssl(c0);
+      mzd_local_copy(c1, c0);
+      muls[j][0](c0, v, j < 2 ? A : Al);
+      muls[j][1](c1, v, j < 2 ? A : Al);
+      if (!mzd_local_equal(c0, c1)) {
+        printf("mzd kernels: mul fail [%u, %u]\n", n, j);
+      }
+    }
+
+    // 5 vectors cover a full group of the SIMD kernels and a partial one
+    mzd_t* vs[5];
+    mzd_t* cs[3][5];
+    for (unsigned int k = 0; k < 5; ++k) {
+      vs[k] = mzd_init_random_vector(n);
+      for (unsigned int l = 0; l < 3; ++l) {
+        cs[l][k] = mzd_local_init(1, n);
+      }
+    }
+
+    mzd_mulm_fn const mulms[][2] = {{generic.mul_vlm, simd.mul_vlm},
+                                    {generic.addmul_vlm, simd.addmul_vlm}};
+    mzd_mul_fn const mulvs[]     = {generic.mul_vl, generic.addmul_vl};
+    for (unsigned int j = 0; j < 2; ++j) {
+      for (unsigned int sc = 1; sc <= 5; ++sc) {
+        for (unsigned int k = 0; k < sc; ++k) {
+          mzd_randomize_ssl(cs[0][k]);
+          mzd_local_copy(cs[1][k], cs[0][k]);
+          mzd_local_copy(cs[2][k], cs[0][k]);
+          mulvs[j](cs[2][k], vs[k], Al);
+        }
+        mulms[j][0](cs[0], (mzd_t const* const*)vs, Al, sc);
+        mulms[j][1](cs[1], (mzd_t const* const*)vs, Al, sc);
+        for (unsigned int k = 0; k < sc; ++k) {
+          if (!mzd_local_equal(cs[0][k], cs[2][k]) || !mzd_local_equal(cs[1][k], cs[2][k])) {
+            printf("mzd kernels: mulm fail [%u, %u, %u, %u]\n", n, j, sc, k);
+          }
+        }
+      }
+    }
+
+    for (unsigned int k = 0; k < 5; ++k) {
+      for (unsigned int l = 0; l < 3; ++l) {
+        mzd_local_free(cs[l][k]);
+      }
+      mzd_local_free(vs[k]);
+    }
+
+    generic.xor(c0, c0, v);
+    simd.xor(c1, c1, v);
+    if (!mzd_local_equal(c0, c1)) {
+      printf("mzd kernels: xor fail [%u]\n", n);
+    }
+
+    mzd_local_free(Al);
+    mzd_local_free(c1);
+    mzd_local_free(c0);
+    mzd_local_free(v);
+    mzd_local_free(A);
+  }
+}
+
 #ifdef WITH_OPT
 #include "simd.h"
 #endif
@@ -201,12 +302,1332 @@ static void test_mzd_shift(void) {
 #endif
 }
 
+static uint64_t grain_ssg_get_word(grain_ssg_t* grain) {
+  uint64_t word = 0;
+  for (unsigned int i = 0; i < 64; ++i) {
+    word |= (uint64_t)grain_ssg_get_bit(grain) << i;
+  }
+  return word;
+}
+
+static void test_grain_ssg(void) {
+  static const unsigned char ones[GRAIN_SEED_SIZE] = {0xff, 0xff, 0xff, 0xff, 0xff,
+                                                      0xff, 0xff, 0xff, 0xff, 0xff};
+  static const unsigned char seed[GRAIN_SEED_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  static const unsigned char zero[GRAIN_SEED_SIZE] = {0};
+
+  grain_ssg_t grain;
+  grain_ssg_init(&grain, ones);
+  if (grain_ssg_get_word(&grain) != UINT64_C(0x1b75cb8d6c48838c) ||
+      grain_ssg_get_word(&grain) != UINT64_C(0xd4c06740e4be895f)) {
+    printf("grain ssg: reference state fail\n");
+  }
+
+  grain_ssg_init(&grain, seed);
+  if (grain_ssg_get_word(&grain) != UINT64_C(0xc1f70bfc39401cbc)) {
+    printf("grain ssg: seeded state fail\n");
+  }
+
+  if (grain_ssg_init(&grain, zero)) {
+    printf("grain ssg: zero state accepted\n");
+  }
+}
+
+typedef struct {
+  unsigned char first[32];
+  unsigned char after[32];
+  int ok;
+} rand_thread_t;
+
+// Draws from a fresh generator up to and across RAND_RESEED_INTERVAL.
+static void* rand_thread(void* arg) {
+  rand_thread_t* t    = arg;
+  const size_t before = 16;
+  const size_t skip   = RAND_RESEED_INTERVAL - sizeof(t->first) - before;
+
+  unsigned char* buffer = malloc(skip);
+  unsigned char across[16 + sizeof(t->after)];
+  memset(across, 0, sizeof(across));
+  t->ok = buffer && rand_bytes(t->first, sizeof(t->first)) && rand_bytes(buffer, skip) &&
+          rand_bytes(across, sizeof(across));
+  memcpy(t->after, across + before, sizeof(t->after));
+  free(buffer);
+  return NULL;
+}
+
+static void test_rand_bytes_threads(void) {
+  static const unsigned char zero[32] = {0};
+
+  rand_thread_t t[2];
+  pthread_t threads[2];
+  bool started[2];
+  for (unsigned int i = 0; i < 2; ++i) {
+    started[i] = !pthread_create(&threads[i], NULL, rand_thread, &t[i]);
+  }
+  for (unsigned int i = 0; i < 2; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+  if (!started[0] || !started[1]) {
+    printf("rand_bytes: thread fail\n");
+    return;
+  }
+
+  if (!t[0].ok || !t[1].ok) {
+    printf("rand_bytes: draw fail\n");
+  }
+  if (!memcmp(t[0].first, t[1].first, sizeof(t[0].first))) {
+    printf("rand_bytes: threads share a stream\n");
+  }
+  for (unsigned int i = 0; i < 2; ++i) {
+    if (!memcmp(t[i].after, zero, sizeof(zero)) ||
+        !memcmp(t[i].after, t[i].first, sizeof(t[i].first))) {
+      printf("rand_bytes: reseed fail [%u]\n", i);
+    }
+  }
+}
+
+// A forked child must not repeat the output of the parent. The child is
+// forked, so this has to run before OpenMP starts its threads.
+static void test_rand_bytes_fork(void) {
+  unsigned char seeded[16];
+  int fds[2];
+  if (!rand_bytes(seeded, sizeof(seeded)) || pipe(fds)) {
+    printf("rand_bytes fork: init fail\n");
+    return;
+  }
+
+  const pid_t pid = fork();
+  if (!pid) {
+    unsigned char child[32];
+    _exit(rand_bytes(child, sizeof(child)) && write(fds[1], child, sizeof(child)) == sizeof(child)
+              ? 0
+              : 1);
+  }
+
+  unsigned char parent[32], child[32];
+  const int ok = rand_bytes(parent, sizeof(parent));
+  int status   = 1;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid || status ||
+      read(fds[0], child, sizeof(child)) != sizeof(child) || !ok) {
+    printf("rand_bytes fork: child fail\n");
+  } else if (!memcmp(parent, child, sizeof(parent))) {
+    printf("rand_bytes fork: child repeats the parent\n");
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+static bool lowmc_instances_equal(lowmc_t const* a, lowmc_t const* b) {
+  if (a->m != b->m || a->n != b->n || a->r != b->r || a->k != b->k) {
+    return false;
+  }
+
+  bool equal = mzd_local_equal(a->k0_matrix, b->k0_matrix);
+  for (size_t i = 0; i < a->r && equal; ++i) {
+    equal = mzd_local_equal(a->rounds[i].k_matrix, b->rounds[i].k_matrix) &&
+            mzd_local_equal(a->rounds[i].l_matrix, b->rounds[i].l_matrix) &&
+            mzd_local_equal(a->rounds[i].constant, b->rounds[i].constant);
+  }
+  return equal;
+}
+
+// Points the instance cache to a fresh temporary directory.
+static char* cache_dir_init(void) {
+  char dir[] = "/tmp/fish-lowmc-XXXXXX";
+  if (!mkdtemp(dir)) {
+    return NULL;
+  }
+
+  lowmc_set_cache_dir(dir);
+  return strdup(dir);
+}
+
+static void cache_dir_free(char* dir) {
+  DIR* d = opendir(dir);
+  for (struct dirent* entry = d ? readdir(d) : NULL; entry; entry = readdir(d)) {
+    if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+      char path[512];
+      snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+      remove(path);
+    }
+  }
+  if (d) {
+    closedir(d);
+  }
+  rmdir(dir);
+  free(dir);
+  lowmc_set_cache_dir(NULL);
+}
+
+static char* cache_file_path(char const* dir, size_t m, size_t n, size_t r, size_t k,
+                             const unsigned char* seed, const char* suffix) {
+  unsigned char fp[LOWMC_FINGERPRINT_SIZE];
+  lowmc_fingerprint(m, n, r, k, seed, fp);
+
+  char* path = malloc(512);
+  int len    = snprintf(path, 512, "%s/%zu-%zu-%zu-%zu-", dir, m, n, r, k);
+  for (unsigned int i = 0; i < LOWMC_FINGERPRINT_SIZE; ++i) {
+    len += snprintf(path + len, 512 - len, "%02x", fp[i]);
+  }
+  snprintf(path + len, 512 - len, "%s", suffix);
+  return path;
+}
+
+static void test_lowmc_cache(void) {
+  char* dir = cache_dir_init();
+  if (!dir) {
+    printf("lowmc cache: mkdtemp fail\n");
+    return;
+  }
+
+  // parameters without an embedded instance
+  static const size_t m = 10, n = 128, r = 11, k = 128;
+  lowmc_t* generated    = lowmc_init(m, n, r, k);
+  lowmc_t* cached       = readFile(m, n, r, k, NULL);
+  if (!generated || !cached || !lowmc_instances_equal(generated, cached)) {
+    printf("lowmc cache: reload fail\n");
+  }
+  if (cached) {
+    lowmc_free(cached);
+  }
+
+  char* path = cache_file_path(dir, m, n, r, k, NULL, "");
+  FILE* file = fopen(path, "r+b");
+  if (!file || fseek(file, 0, SEEK_END)) {
+    printf("lowmc cache: file fail\n");
+  } else {
+    const long size = ftell(file);
+
+    // a flipped bit in the matrices is caught by the checksum
+    fseek(file, size / 2, SEEK_SET);
+    const int c = fgetc(file);
+    fseek(file, size / 2, SEEK_SET);
+    fputc(c ^ 1, file);
+    fclose(file);
+    if (readFile(m, n, r, k, NULL)) {
+      printf("lowmc cache: corrupted file accepted\n");
+    }
+
+    // a corrupted file is replaced by a freshly generated instance
+    lowmc_t* regenerated = lowmc_init(m, n, r, k);
+    cached               = readFile(m, n, r, k, NULL);
+    if (!regenerated || !cached || !lowmc_instances_equal(regenerated, cached)) {
+      printf("lowmc cache: regenerate fail\n");
+    }
+    if (cached) {
+      lowmc_free(cached);
+    }
+    if (regenerated) {
+      lowmc_free(regenerated);
+    }
+
+    if (truncate(path, size / 2) || readFile(m, n, r, k, NULL)) {
+      printf("lowmc cache: truncated file accepted\n");
+    }
+
+    // the file of other parameters does not match their fingerprint
+    char* other = cache_file_path(dir, m, n, r + 1, k, NULL, "");
+    regenerated = lowmc_init(m, n, r, k);
+    if (!regenerated || rename(path, other) || readFile(m, n, r + 1, k, NULL)) {
+      printf("lowmc cache: fingerprint mismatch accepted\n");
+    }
+    if (regenerated) {
+      lowmc_free(regenerated);
+    }
+    free(other);
+  }
+
+  if (generated) {
+    lowmc_free(generated);
+  }
+  free(path);
+  cache_dir_free(dir);
+}
+
+static void test_lowmc_derive(void) {
+  static const unsigned char seed[LOWMC_SEED_SIZE]  = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  static const unsigned char other[LOWMC_SEED_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 11};
+
+  // every instance is derived in its own cache directory to bypass the cache
+  lowmc_t* instances[3];
+  const unsigned char* seeds[3] = {seed, seed, other};
+  for (unsigned int i = 0; i < 3; ++i) {
+    char* dir    = cache_dir_init();
+    instances[i] = dir ? lowmc_init_from_seed(10, 128, 20, 128, seeds[i]) : NULL;
+    if (dir) {
+      cache_dir_free(dir);
+    }
+  }
+
+  if (!instances[0] || !instances[1] || !instances[2]) {
+    printf("lowmc derive: init fail\n");
+  } else if (!lowmc_instances_equal(instances[0], instances[1]) || !instances[0]->seeded ||
+             memcmp(instances[0]->seed, seed, sizeof(seed))) {
+    printf("lowmc derive: instances of same seed differ\n");
+  } else if (lowmc_instances_equal(instances[0], instances[2])) {
+    printf("lowmc derive: instances of different seeds equal\n");
+  }
+
+  for (unsigned int i = 0; i < 3; ++i) {
+    if (instances[i]) {
+      lowmc_free(instances[i]);
+    }
+  }
+}
+
+// Embedded instances (see WITH_EMBEDDED_INSTANCES) are the reference instances.
+static void test_lowmc_embedded(void) {
+  static const size_t pars[][4] = {{10, 128, 20, 128}, {10, 192, 30, 192}, {10, 256, 38, 256}};
+  for (unsigned int i = 0; i < sizeof(pars) / sizeof(pars[0]); ++i) {
+    const size_t m = pars[i][0], n = pars[i][1], r = pars[i][2], k = pars[i][3];
+
+    lowmc_t* embedded = lowmc_embedded_instance(m, n, r, k);
+    if (!embedded) {
+      continue;
+    }
+
+    lowmc_t* lowmc   = lowmc_init(m, n, r, k);
+    lowmc_t* derived = lowmc_init_from_seed(m, n, r, k, NULL);
+    if (lowmc != embedded || embedded->storage != LOWMC_STORAGE_STATIC ||
+        !embedded->kernels.sbox_layer) {
+      printf("lowmc embedded: lookup fail [%zu]\n", n);
+    }
+    if (!derived || !lowmc_instances_equal(embedded, derived) || !embedded->seeded ||
+        memcmp(embedded->seed, derived->seed, LOWMC_SEED_SIZE)) {
+      printf("lowmc embedded: reference instance fail [%zu]\n", n);
+    }
+
+    lowmc_free(lowmc);
+    if (derived) {
+      lowmc_free(derived);
+    }
+  }
+}
+
+// Instances attached to a shared image encrypt like private copies.
+static void test_lowmc_shared(void) {
+  static const unsigned char seed[LOWMC_SEED_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+  char* dir = cache_dir_init();
+  if (!dir) {
+    printf("lowmc shared: mkdtemp fail\n");
+    return;
+  }
+
+  lowmc_set_shared(false);
+  lowmc_t* heap = lowmc_init_from_seed(10, 128, 20, 128, seed);
+  lowmc_set_shared(true);
+  lowmc_t* attached = lowmc_init_from_seed(10, 128, 20, 128, seed);
+  lowmc_t* again    = lowmc_init_from_seed(10, 128, 20, 128, seed);
+  lowmc_set_shared(false);
+
+  if (!heap || !attached || !again || heap->storage != LOWMC_STORAGE_HEAP ||
+      attached->storage != LOWMC_STORAGE_MAPPED || again->storage != LOWMC_STORAGE_MAPPED) {
+    printf("lowmc shared: init fail\n");
+  } else {
+    if (!lowmc_instances_equal(heap, attached)) {
+      printf("lowmc shared: matrices fail\n");
+    }
+
+    lowmc_key_t* key = lowmc_keygen(heap);
+    mzd_t* p         = mzd_local_init(1, heap->n);
+    for (unsigned int i = 0; i < 10; ++i) {
+      mzd_randomize_ssl(p);
+      mzd_t* c0 = lowmc_call(heap, key, p);
+      mzd_t* c1 = lowmc_call(attached, key, p);
+      mzd_t* c2 = lowmc_call(again, key, p);
+      if (!mzd_local_equal(c0, c1) || !mzd_local_equal(c0, c2)) {
+        printf("lowmc shared: encrypt fail [%u]\n", i);
+      }
+      mzd_local_free(c2);
+      mzd_local_free(c1);
+      mzd_local_free(c0);
+    }
+    mzd_local_free(p);
+    lowmc_key_free(key);
+  }
+
+  if (again) {
+    lowmc_free(again);
+  }
+  if (attached) {
+    lowmc_free(attached);
+  }
+  if (heap) {
+    lowmc_free(heap);
+  }
+  cache_dir_free(dir);
+}
+
+// Processes racing for a missing instance agree on the published one. The
+// children are forked, so this has to run before OpenMP starts its threads.
+static void test_lowmc_cache_race(void) {
+  char* dir = cache_dir_init();
+  int fds[2];
+  if (!dir || pipe(fds)) {
+    printf("lowmc cache race: init fail\n");
+    free(dir);
+    return;
+  }
+
+  for (unsigned int i = 0; i < 2; ++i) {
+    if (!fork()) {
+      lowmc_t* lowmc = lowmc_init(10, 128, 11, 128);
+      const word w   = lowmc ? CONST_FIRST_ROW(lowmc->k0_matrix)[0] : 0;
+      _exit(write(fds[1], &w, sizeof(w)) == sizeof(w) ? 0 : 1);
+    }
+  }
+  while (wait(NULL) > 0) {
+  }
+
+  word w[2] = {0, 1};
+  if (read(fds[0], &w[0], sizeof(w[0])) != sizeof(w[0]) ||
+      read(fds[0], &w[1], sizeof(w[1])) != sizeof(w[1]) || w[0] != w[1]) {
+    printf("lowmc cache race: instances differ\n");
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+  cache_dir_free(dir);
+}
+
+static void test_mzd_local_rank(void) {
+  for (unsigned int i = 0; i < 10; ++i) {
+    mzd_t* A = mzd_local_init(192, 128 + 64 * (i % 3));
+    mzd_randomize_ssl(A);
+    // force some dependent rows
+    for (unsigned int j = 0; j < i; ++j) {
+      memcpy(A->rows[2 * j], A->rows[2 * j + 1], A->width * sizeof(word));
+    }
+
+    mzd_t* B = mzd_copy(NULL, A);
+    const rci_t expected = mzd_echelonize(B, 0);
+    if (mzd_local_rank(A) != expected) {
+      printf("mzd_local_rank fail\n");
+    }
+
+    mzd_free(B);
+    mzd_local_free(A);
+  }
+}
+
+static void test_block_shift(void) {
+  static const unsigned int sizes[] = {128, 192, 256, 512};
+  for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    mzd_t* v = mzd_local_init(1, sizes[i]);
+    mzd_t* r = mzd_local_init(1, sizes[i]);
+    mzd_t* w = mzd_local_init(1, sizes[i]);
+
+    for (unsigned int count = 0; count < 32; ++count) {
+      block_t b;
+      mzd_randomize_ssl(v);
+      block_load(&b, v);
+
+      mzd_shift_left(r, v, count);
+      block_shift_left(&b, &b, count, v->width);
+      block_store(w, &b);
+      if (mzd_cmp(r, w) != 0) {
+        printf("block lshift fail [%u, %u]\n", sizes[i], count);
+      }
+
+      block_load(&b, v);
+      mzd_shift_right(r, v, count);
+      block_shift_right(&b, &b, count, v->width);
+      block_store(w, &b);
+      if (mzd_cmp(r, w) != 0) {
+        printf("block rshift fail [%u, %u]\n", sizes[i], count);
+      }
+    }
+
+    mzd_local_free(w);
+    mzd_local_free(r);
+    mzd_local_free(v);
+  }
+}
+
+static void test_mzd_pool(void) {
+  mzd_t* v[64];
+  for (unsigned int i = 0; i < 64; ++i) {
+    v[i] = mzd_local_init(1, 64 * (1 + i % 8));
+    if ((uintptr_t)FIRST_ROW(v[i]) & 31) {
+      printf("mzd pool: misaligned vector\n");
+    }
+  }
+
+  for (unsigned int i = 0; i < 64; ++i) {
+    mzd_local_free(v[i]);
+  }
+
+  // use a size class of its own, so that chunks still held by other tests do
+  // not keep the slab alive
+  for (unsigned int i = 0; i < 16; ++i) {
+    v[i] = mzd_local_init(5, 320);
+  }
+  mzd_t* first = v[0];
+  for (unsigned int i = 0; i < 16; ++i) {
+    mzd_local_free(v[i]);
+  }
+  mzd_pool_reset();
+
+  // after a reset, empty slabs are handed out from the start again
+  mzd_pool_stats_t stats;
+  v[0] = mzd_local_init(5, 320);
+  mzd_pool_get_stats(&stats);
+  if (stats.allocations && v[0] != first) {
+    printf("mzd pool: reset fail\n");
+  }
+  mzd_local_free(v[0]);
+
+  mzd_pool_get_stats(&stats);
+  if (stats.bytes_in_use > stats.peak_bytes_in_use ||
+      stats.bytes_in_use > stats.bytes_reserved) {
+    printf("mzd pool: inconsistent stats\n");
+  }
+}
+
+// Compares the specialized implementations against the generic code, with and
+// without the expanded key.
+static void test_lowmc_impl(void) {
+  static const unsigned int pars[][4] = {
+      {10, 128, 20, 128}, {10, 256, 38, 256}, {10, 128, 12, 192}, {20, 256, 16, 128}};
+  for (unsigned int i = 0; i < sizeof(pars) / sizeof(pars[0]); ++i) {
+    lowmc_t* lowmc = lowmc_init(pars[i][0], pars[i][1], pars[i][2], pars[i][3]);
+    if (!lowmc) {
+      printf("lowmc impl: init fail [%u]\n", pars[i][1]);
+      continue;
+    }
+    lowmc_impl_t const* impl = lowmc->impl;
+    if (!impl) {
+      lowmc_free(lowmc);
+      continue;
+    }
+
+    lowmc_key_t* key = lowmc_keygen(lowmc);
+    mzd_t* p         = mzd_init_random_vector(lowmc->n);
+
+    mzd_t* c0   = lowmc_call(lowmc, key, p);
+    lowmc->impl = NULL;
+    mzd_t* c1   = lowmc_call(lowmc, key, p);
+    if (!mzd_local_equal(c0, c1)) {
+      printf("lowmc impl: lowmc_call fail [%zu]\n", lowmc->n);
+    }
+
+    mzd_t** rvec[SC_PROOF];
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      rvec[m] = mpc_init_random_vector(lowmc->n, lowmc->r);
+    }
+
+    unsigned char share_keys[2][16];
+    rand_bytes((unsigned char*)share_keys, sizeof(share_keys));
+    mzd_shared_t shared = MZD_SHARED_EMPTY;
+    mzd_shared_init(&shared, key);
+    mzd_shared_share_from_keys(&shared, share_keys);
+
+    mzd_t** round_keys = lowmc_expand_key(lowmc, key);
+
+    view_t views[4];
+    mzd_t* storage = init_views(lowmc, views, 4, SC_PROOF);
+    mzd_t** res[4];
+    for (unsigned int j = 0; j < 4; ++j) {
+      mzd_shared_t s = MZD_SHARED_EMPTY;
+      mzd_shared_copy(&s, &shared);
+      lowmc->impl = j & 1 ? NULL : impl;
+      res[j]      = mpc_lowmc_call(lowmc, &s, p, &views[j], rvec, j & 2 ? round_keys : NULL);
+      mzd_shared_clear(&s);
+    }
+    mzd_t* o = mpc_reconstruct_from_share(NULL, res[0]);
+    if (!mzd_local_equal(o, c0)) {
+      printf("lowmc impl: mpc_lowmc_call fail [%zu]\n", lowmc->n);
+    }
+    for (unsigned int j = 1; j < 4; ++j) {
+      for (unsigned int m = 0; m < SC_PROOF; ++m) {
+        if (!mzd_local_equal(res[0][m], res[j][m]) ||
+            !mzd_local_equal(views[0].s[m], views[j].s[m])) {
+          printf("lowmc impl: mpc_lowmc_call view fail [%zu, %u, %u]\n", lowmc->n, j, m);
+        }
+      }
+    }
+
+    // the verifier recomputes the view of the first opened party from its key
+    // share, which is then compared with the prover's
+    for (unsigned int j = 0; j < 2; ++j) {
+      lowmc->impl = j ? NULL : impl;
+      for (unsigned int ch = 0; ch < SC_PROOF; ++ch) {
+        const unsigned int ch1 = (ch + 1) % SC_PROOF;
+
+        view_t v;
+        mzd_t* vstorage = init_views(lowmc, &v, 1, SC_VERIFY);
+        mzd_local_copy_to_row(v.s[0], 0, shared.shared[ch]);
+        mzd_local_copy(v.s[1], views[0].s[ch1]);
+        // the output share of the second party is recomputed as well
+        memset(ROW(v.s[1], lowmc->r + 1), 0, v.s[1]->rowstride * sizeof(word));
+
+        mzd_t** rv[SC_VERIFY] = {rvec[ch], rvec[ch1]};
+        if (mpc_lowmc_verify(lowmc, p, &v, rv, ch) ||
+            !mzd_local_equal(v.s[0], views[0].s[ch]) ||
+            !mzd_local_equal(v.s[1], views[0].s[ch1])) {
+          printf("lowmc impl: mpc_lowmc_verify fail [%zu, %u, %u]\n", lowmc->n, j, ch);
+        }
+        mzd_local_free_multiple(&vstorage);
+      }
+    }
+    lowmc->impl = impl;
+
+    mzd_local_free(o);
+    for (unsigned int j = 0; j < 4; ++j) {
+      mpc_free(res[j], SC_PROOF);
+    }
+    mzd_local_free_multiple(&storage);
+    lowmc_round_keys_free(round_keys);
+    mzd_shared_clear(&shared);
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      mpc_free(rvec[m], lowmc->r);
+    }
+    mzd_local_free(c1);
+    mzd_local_free(c0);
+    mzd_local_free(p);
+    lowmc_key_free(key);
+    lowmc_free(lowmc);
+  }
+}
+
+static void test_lowmc_batch(void) {
+  static const unsigned int pars[][4] = {
+      {10, 128, 20, 128}, {10, 256, 38, 256}, {10, 128, 12, 192}, {20, 256, 16, 128}};
+  static const unsigned int count = 6;
+  for (unsigned int i = 0; i < sizeof(pars) / sizeof(pars[0]); ++i) {
+    lowmc_t* lowmc = lowmc_init(pars[i][0], pars[i][1], pars[i][2], pars[i][3]);
+    if (!lowmc) {
+      printf("lowmc batch: init fail [%u]\n", pars[i][1]);
+      continue;
+    }
+    lowmc_impl_t const* impl = lowmc->impl;
+
+    lowmc_key_t* keys[count];
+    mzd_t* p[count];
+    mzd_t* c[count];
+    for (unsigned int j = 0; j < count; ++j) {
+      keys[j] = lowmc_keygen(lowmc);
+      p[j]    = mzd_init_random_vector(lowmc->n);
+      c[j]    = mzd_local_init(1, lowmc->n);
+    }
+
+    for (unsigned int j = 0; j < 2; ++j) {
+      lowmc->impl = j ? NULL : impl;
+      // fewer blocks than a full group as well
+      for (unsigned int n = 1; n <= count; n += count - 1) {
+        lowmc_encrypt_batch(lowmc, keys[0], c, (mzd_t const* const*)p, n);
+        for (unsigned int b = 0; b < n; ++b) {
+          mzd_t* e = lowmc_call(lowmc, keys[0], p[b]);
+          if (!mzd_local_equal(e, c[b])) {
+            printf("lowmc batch: encrypt fail [%zu, %u, %u]\n", lowmc->n, j, b);
+          }
+          mzd_local_free(e);
+        }
+      }
+
+      lowmc_encrypt_batch_keys(lowmc, (lowmc_key_t const* const*)keys, c, (mzd_t const* const*)p,
+                               count);
+      for (unsigned int b = 0; b < count; ++b) {
+        mzd_t* e = lowmc_call(lowmc, keys[b], p[b]);
+        if (!mzd_local_equal(e, c[b])) {
+          printf("lowmc batch: multi-key fail [%zu, %u, %u]\n", lowmc->n, j, b);
+        }
+        mzd_local_free(e);
+      }
+
+      lowmc_encrypt_ctr(lowmc, keys[0], p[0], c, count);
+      for (unsigned int b = 0; b < count; ++b) {
+        mzd_local_copy(p[1], p[0]);
+        FIRST_ROW(p[1])[0] += b;
+        mzd_t* e = lowmc_call(lowmc, keys[0], p[1]);
+        if (!mzd_local_equal(e, c[b])) {
+          printf("lowmc batch: ctr fail [%zu, %u, %u]\n", lowmc->n, j, b);
+        }
+        mzd_local_free(e);
+      }
+    }
+    lowmc->impl = impl;
+
+    for (unsigned int j = 0; j < count; ++j) {
+      mzd_local_free(c[j]);
+      mzd_local_free(p[j]);
+      lowmc_key_free(keys[j]);
+    }
+    lowmc_free(lowmc);
+  }
+}
+
+static void test_tree(void) {
+  static const unsigned int num_leaves[] = {1, 5, 16, 343};
+  unsigned char salt[KKW_SALT_SIZE], root[KKW_SEED_SIZE];
+  rand_bytes(salt, sizeof(salt));
+  rand_bytes(root, sizeof(root));
+
+  for (unsigned int i = 0; i < sizeof(num_leaves) / sizeof(num_leaves[0]); ++i) {
+    const unsigned int n = num_leaves[i];
+    bool hidden[n];
+    for (unsigned int j = 0; j < n; ++j) {
+      hidden[j] = j % 3 == 1;
+    }
+
+    tree_t* seeds = tree_init(n, KKW_SEED_SIZE);
+    tree_t* other = tree_init(n, KKW_SEED_SIZE);
+    seed_tree_expand(seeds, root, salt, 0);
+
+    unsigned char buffer[n * KKW_SEED_SIZE + KKW_SEED_SIZE];
+    const size_t size = seed_tree_reveal(seeds, hidden, buffer);
+    if (size != tree_cover_size(seeds, hidden) * KKW_SEED_SIZE ||
+        size > tree_max_cover_size(n, (n + 1) / 3) * KKW_SEED_SIZE ||
+        seed_tree_reconstruct(other, hidden, buffer, salt, 0) != size) {
+      printf("tree: seed reveal size fail [%u]\n", n);
+    }
+    for (unsigned int j = 0; j < n; ++j) {
+      if (!hidden[j] && memcmp(tree_leaf(seeds, j), tree_leaf(other, j), KKW_SEED_SIZE)) {
+        printf("tree: seed reconstruct fail [%u, %u]\n", n, j);
+      }
+    }
+
+    // the seeds serve as the leaves of the Merkle trees
+    tree_t* merkle = tree_init(n, SHA256_DIGEST_LENGTH);
+    tree_t* check  = tree_init(n, SHA256_DIGEST_LENGTH);
+    for (unsigned int l = 0; l < n; ++l) {
+      memset(tree_leaf(merkle, l), 0, SHA256_DIGEST_LENGTH);
+      memcpy(tree_leaf(merkle, l), tree_leaf(seeds, l), KKW_SEED_SIZE);
+    }
+    merkle_tree_build(merkle, salt);
+
+    unsigned char opening[n * SHA256_DIGEST_LENGTH + SHA256_DIGEST_LENGTH];
+    const size_t opening_size = merkle_tree_open(merkle, hidden, opening);
+    for (unsigned int j = 0; j < 2; ++j) {
+      for (unsigned int l = 0; l < n; ++l) {
+        memcpy(tree_leaf(check, l), tree_leaf(merkle, l), SHA256_DIGEST_LENGTH);
+      }
+      // the second run opens a modified leaf
+      const bool modified = j && n > 1;
+      if (modified) {
+        tree_leaf(check, 1)[0] ^= 1;
+      }
+      if (merkle_tree_verify(check, hidden, opening, salt) != opening_size ||
+          !memcmp(tree_root(check), tree_root(merkle), SHA256_DIGEST_LENGTH) == modified) {
+        printf("tree: merkle verify fail [%u, %u]\n", n, j);
+      }
+    }
+
+    // single leaves are opened without the cover
+    for (unsigned int l = 0; l < n; ++l) {
+      bool single[n];
+      memset(single, 0, sizeof(single));
+      single[l] = true;
+
+      unsigned char path[n * SHA256_DIGEST_LENGTH + SHA256_DIGEST_LENGTH];
+      unsigned char root_hash[SHA256_DIGEST_LENGTH];
+      const size_t path_size = merkle_tree_open_leaf(merkle, l, path);
+      if (path_size != merkle_tree_open(merkle, single, opening) ||
+          memcmp(path, opening, path_size) ||
+          merkle_tree_verify_leaf(n, l, tree_leaf(merkle, l), path, salt, root_hash) !=
+              path_size ||
+          memcmp(root_hash, tree_root(merkle), SHA256_DIGEST_LENGTH)) {
+        printf("tree: merkle leaf fail [%u, %u]\n", n, l);
+      }
+    }
+
+    tree_free(check);
+    tree_free(merkle);
+    tree_free(other);
+    tree_free(seeds);
+  }
+}
+
+static void test_mpc_lowmc_kkw(void) {
+  static const unsigned int pars[][4] = {
+      {10, 128, 20, 128}, {10, 192, 30, 192}, {20, 256, 16, 128}};
+  static const unsigned int num_parties = 16;
+  for (unsigned int i = 0; i < sizeof(pars) / sizeof(pars[0]); ++i) {
+    lowmc_t* lowmc = lowmc_init(pars[i][0], pars[i][1], pars[i][2], pars[i][3]);
+    if (!lowmc) {
+      printf("kkw: init fail [%u]\n", pars[i][1]);
+      continue;
+    }
+
+    lowmc_key_t* key = lowmc_keygen(lowmc);
+    mzd_t* p         = mzd_init_random_vector(lowmc->n);
+    mzd_t* c         = lowmc_call(lowmc, key, p);
+
+    unsigned char seeds[num_parties][KKW_SEED_SIZE];
+    rand_bytes((unsigned char*)seeds, sizeof(seeds));
+
+    kkw_transcript_t* prover       = kkw_transcript_init(lowmc, num_parties);
+    kkw_transcript_t* preprocessed = kkw_transcript_init(lowmc, num_parties);
+    mpc_lowmc_kkw_prove(lowmc, key, p, seeds, prover);
+    mpc_lowmc_kkw_prove(lowmc, NULL, p, seeds, preprocessed);
+    if (!mzd_local_equal(prover->aux, preprocessed->aux)) {
+      printf("kkw: preprocessing fail [%zu]\n", lowmc->n);
+    }
+
+    // each party is hidden once, the verifier recomputes the transcript
+    for (unsigned int hidden = 0; hidden < num_parties; ++hidden) {
+      kkw_transcript_t* verifier = kkw_transcript_init(lowmc, num_parties);
+      mzd_local_copy(verifier->aux, prover->aux);
+      mzd_local_copy(verifier->masked_key, prover->masked_key);
+      mzd_local_copy(verifier->msgs[hidden], prover->msgs[hidden]);
+      memset(ROW(verifier->msgs[hidden], lowmc->r), 0, lowmc->n / 8);
+
+      if (mpc_lowmc_kkw_verify(lowmc, p, c, seeds, hidden, verifier)) {
+        printf("kkw: verify fail [%zu, %u]\n", lowmc->n, hidden);
+      }
+      for (unsigned int q = 0; q < num_parties; ++q) {
+        if (!mzd_local_equal(verifier->msgs[q], prover->msgs[q])) {
+          printf("kkw: transcript fail [%zu, %u, %u]\n", lowmc->n, hidden, q);
+        }
+      }
+      kkw_transcript_free(verifier);
+    }
+
+    kkw_transcript_free(preprocessed);
+    kkw_transcript_free(prover);
+    mzd_local_free(c);
+    mzd_local_free(p);
+    lowmc_key_free(key);
+    lowmc_free(lowmc);
+  }
+}
+
+static void test_kkw_sign(void) {
+  public_parameters_t pp;
+  if (!create_instance(&pp, 10, 128, 20, 128)) {
+    printf("kkw sign: init fail\n");
+    return;
+  }
+
+  kkw_parameters_t kp;
+  kkw_default_parameters(&pp, &kp);
+
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+  fis_create_key(&pp, &private_key, &public_key);
+
+  const uint8_t msg[] = "test message";
+  const unsigned max_size = kkw_sig_max_size(&pp, &kp);
+  unsigned char* sig      = malloc(max_size);
+  const unsigned size = kkw_sign(&pp, &kp, &private_key, msg, sizeof(msg), sig, max_size);
+  if (!size || kkw_verify(&pp, &kp, &public_key, msg, sizeof(msg), sig, size)) {
+    printf("kkw sign: sign/verify fail\n");
+  }
+  if (!kkw_verify(&pp, &kp, &public_key, msg, sizeof(msg) - 1, sig, size) ||
+      !kkw_verify(&pp, &kp, &public_key, msg, sizeof(msg), sig, size - 1)) {
+    printf("kkw sign: verify of wrong message or size fail\n");
+  }
+  // flip bits in the salt, the opened seeds and the last commitment
+  static const unsigned int offsets[] = {40, 100, 1};
+  for (unsigned int i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i) {
+    const unsigned int offset = i == 2 ? size - offsets[i] : offsets[i];
+    sig[offset] ^= 1;
+    if (!kkw_verify(&pp, &kp, &public_key, msg, sizeof(msg), sig, size)) {
+      printf("kkw sign: verify of modified signature fail [%u]\n", offset);
+    }
+    sig[offset] ^= 1;
+  }
+
+  free(sig);
+  fis_destroy_key(&private_key, &public_key);
+  destroy_instance(&pp);
+}
+
+static void test_fis_batch(void) {
+  public_parameters_t pp;
+  if (!create_instance(&pp, 10, 128, 20, 128)) {
+    printf("fis batch: init fail\n");
+    return;
+  }
+
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+  fis_create_key(&pp, &private_key, &public_key);
+
+  static const unsigned int num_messages = 5;
+  uint8_t data[num_messages][8];
+  const uint8_t* msgs[num_messages];
+  size_t msglens[num_messages];
+  for (unsigned int i = 0; i < num_messages; ++i) {
+    memset(data[i], i, sizeof(data[i]));
+    msgs[i]    = data[i];
+    msglens[i] = sizeof(data[i]);
+  }
+
+  fis_batch_t* batch    = fis_sign_batch(&pp, &private_key, msgs, msglens, num_messages);
+  const unsigned max    = fis_sig_max_size(&pp);
+  unsigned char* sig    = malloc(max);
+  const unsigned siglen = fis_sig_serialize(&pp, fis_batch_signature(batch), sig, max);
+
+  fis_batch_cache_t cache = {.valid = false};
+  unsigned char path[fis_batch_path_max_size(num_messages)];
+  for (unsigned int i = 0; i < num_messages; ++i) {
+    const unsigned pathlen = fis_batch_path(batch, i, path);
+    if (fis_verify_batch_member(&pp, &public_key, msgs[i], msglens[i], i, num_messages, path,
+                                pathlen, sig, siglen, i & 1 ? &cache : NULL)) {
+      printf("fis batch: verify fail [%u]\n", i);
+    }
+    if (!fis_verify_batch_member(&pp, &public_key, msgs[(i + 1) % num_messages], msglens[i], i,
+                                 num_messages, path, pathlen, sig, siglen, &cache) ||
+        !fis_verify_batch_member(&pp, &public_key, msgs[i], msglens[i], (i + 1) % num_messages,
+                                 num_messages, path, pathlen, sig, siglen, &cache)) {
+      printf("fis batch: verify of wrong member fail [%u]\n", i);
+    }
+    if (pathlen > KKW_SALT_SIZE &&
+        !fis_verify_batch_member(&pp, &public_key, msgs[i], msglens[i], i, num_messages, path,
+                                 pathlen - SHA256_DIGEST_LENGTH, sig, siglen, &cache)) {
+      printf("fis batch: verify of short path fail [%u]\n", i);
+    }
+  }
+
+  // the cache holds the signature verified under public_key
+  fis_private_key_t other_private_key;
+  fis_public_key_t other_public_key;
+  fis_create_key(&pp, &other_private_key, &other_public_key);
+  const unsigned pathlen = fis_batch_path(batch, 1, path);
+  if (!fis_verify_batch_member(&pp, &other_public_key, msgs[1], msglens[1], 1, num_messages, path,
+                               pathlen, sig, siglen, &cache)) {
+    printf("fis batch: verify with cached signature of other key fail\n");
+  }
+
+  free(sig);
+  fis_free_batch(&pp, batch);
+  fis_destroy_key(&other_private_key, &other_public_key);
+  fis_destroy_key(&private_key, &public_key);
+  destroy_instance(&pp);
+}
+
+static void test_fis_stream(void) {
+  public_parameters_t pp;
+  if (!create_instance(&pp, 10, 128, 20, 128)) {
+    printf("fis stream: init fail\n");
+    return;
+  }
+
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+  fis_create_key(&pp, &private_key, &public_key);
+
+  uint8_t msg[1000];
+  for (unsigned int i = 0; i < sizeof(msg); ++i) {
+    msg[i] = i;
+  }
+
+  fis_signer_t* signer = fis_sign_init(&pp, &private_key);
+  for (unsigned int i = 0; i < sizeof(msg); i += 300) {
+    fis_sign_update(signer, msg + i, sizeof(msg) - i < 300 ? sizeof(msg) - i : 300);
+  }
+  fis_signature_t* fsig = fis_sign_final(signer);
+  if (fis_verify(&pp, &public_key, msg, sizeof(msg), fsig)) {
+    printf("fis stream: verify fail\n");
+  }
+
+  const unsigned max    = fis_sig_max_size(&pp);
+  unsigned char* sig    = malloc(max);
+  const unsigned siglen = fis_sig_serialize(&pp, fsig, sig, max);
+  // chunks of odd sizes split the header and the repetitions
+  static const unsigned int steps[] = {1, 7, 1000, 4096};
+  for (unsigned int i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i) {
+    fis_verifier_t* verifier = fis_verifier_init(&pp, &public_key);
+    for (unsigned int j = 0; j < siglen; j += steps[i]) {
+      fis_verifier_update(verifier, sig + j, siglen - j < steps[i] ? siglen - j : steps[i]);
+    }
+    if (fis_verifier_final(verifier, msg, sizeof(msg))) {
+      printf("fis stream: chunked verifier fail [%u]\n", steps[i]);
+    }
+  }
+
+  // a byte is flipped inside a repetition, the header is far smaller than half
+  // of the signature
+  const unsigned int tampered[] = {siglen / 2, siglen - 1};
+  for (unsigned int i = 0; i < sizeof(tampered) / sizeof(tampered[0]); ++i) {
+    sig[tampered[i]] ^= 1;
+    fis_verifier_t* verifier = fis_verifier_init(&pp, &public_key);
+    for (unsigned int j = 0; j < siglen; j += 7) {
+      fis_verifier_update(verifier, sig + j, siglen - j < 7 ? siglen - j : 7);
+    }
+    if (!fis_verifier_final(verifier, msg, sizeof(msg))) {
+      printf("fis stream: verifier of tampered signature fail [%u]\n", tampered[i]);
+    }
+    sig[tampered[i]] ^= 1;
+  }
+
+  for (unsigned int modify = 0; modify < 2; ++modify) {
+    fis_verifier_t* verifier = fis_verifier_init(&pp, &public_key);
+    fis_verifier_update(verifier, sig, siglen);
+    fis_verifier_update_message(verifier, msg, 500);
+    msg[sizeof(msg) - 1] ^= modify;
+    if (!fis_verifier_final(verifier, msg + 500, sizeof(msg) - 500) != !modify) {
+      printf("fis stream: verifier fail [%u]\n", modify);
+    }
+  }
+
+  // the message comes after the signature
+  fis_verifier_t* verifier = fis_verifier_init(&pp, &public_key);
+  if (!fis_verifier_update_message(verifier, msg, sizeof(msg))) {
+    printf("fis stream: early message fail\n");
+  }
+  fis_verifier_final(verifier, NULL, 0);
+
+  free(sig);
+  fis_free_signature(&pp, fsig);
+  fis_destroy_key(&private_key, &public_key);
+  destroy_instance(&pp);
+}
+
+// Collects the output of the write callbacks of the fis signers and hands it
+// out again to the read callback of fis_verify_read.
+typedef struct {
+  unsigned char* data;
+  unsigned len;
+  unsigned max;
+  // read position and the largest chunk handed out per read
+  unsigned pos;
+  unsigned step;
+} test_buffer_t;
+
+static int test_buffer_write(void* opaque, const unsigned char* data, size_t len) {
+  test_buffer_t* buffer = opaque;
+  if (len > buffer->max - buffer->len) {
+    return -1;
+  }
+  memcpy(buffer->data + buffer->len, data, len);
+  buffer->len += len;
+  return 0;
+}
+
+static size_t test_buffer_read(void* opaque, unsigned char* buf, size_t len) {
+  test_buffer_t* buffer = opaque;
+  size_t available      = buffer->len - buffer->pos;
+  if (available > len) {
+    available = len;
+  }
+  if (available > buffer->step) {
+    available = buffer->step;
+  }
+  memcpy(buf, buffer->data + buffer->pos, available);
+  buffer->pos += available;
+  return available;
+}
+
+static void test_fis_write_read(void) {
+  public_parameters_t pp;
+  if (!create_instance(&pp, 10, 128, 20, 128)) {
+    printf("fis write read: init fail\n");
+    return;
+  }
+
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+  fis_create_key(&pp, &private_key, &public_key);
+
+  static const uint8_t msg[] = "write read";
+  test_buffer_t buffer       = {.max = fis_sig_max_size(&pp)};
+  buffer.data                = malloc(buffer.max);
+  if (fis_sign_write(&pp, &private_key, msg, sizeof(msg), test_buffer_write, &buffer) ||
+      fis_verify_bytes(&pp, &public_key, msg, sizeof(msg), buffer.data, buffer.len)) {
+    printf("fis write read: write fail\n");
+  }
+
+  // odd chunk sizes split the header and the repetitions
+  static const unsigned int steps[] = {1, 7, 777, 4096};
+  for (unsigned int i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i) {
+    buffer.pos  = 0;
+    buffer.step = steps[i];
+    if (fis_verify_read(&pp, &public_key, msg, sizeof(msg), test_buffer_read, &buffer)) {
+      printf("fis write read: read fail [%u]\n", steps[i]);
+    }
+  }
+
+  // a truncated signature and another message are rejected
+  buffer.pos  = 0;
+  buffer.step = 4096;
+  --buffer.len;
+  if (!fis_verify_read(&pp, &public_key, msg, sizeof(msg), test_buffer_read, &buffer)) {
+    printf("fis write read: read of truncated signature fail\n");
+  }
+  ++buffer.len;
+  buffer.pos = 0;
+  if (!fis_verify_read(&pp, &public_key, msg, sizeof(msg) - 1, test_buffer_read, &buffer)) {
+    printf("fis write read: read of other message fail\n");
+  }
+
+  // the callbacks fail once the buffer is full
+  for (unsigned int max = 0; max < 2; ++max) {
+    test_buffer_t small = {.data = buffer.data, .max = max ? buffer.len / 2 : 0};
+    if (!fis_sign_write(&pp, &private_key, msg, sizeof(msg), test_buffer_write, &small)) {
+      printf("fis write read: failing write fail [%u]\n", small.max);
+    }
+    small.len = 0;
+    if (!fis_sign_write_low_memory(&pp, &private_key, msg, sizeof(msg), test_buffer_write,
+                                   &small)) {
+      printf("fis write read: failing low memory write fail [%u]\n", small.max);
+    }
+  }
+
+  free(buffer.data);
+  fis_destroy_key(&private_key, &public_key);
+  destroy_instance(&pp);
+}
+
+static void test_fis_low_memory(void) {
+  static const unsigned int num_rounds[] = {NUM_ROUNDS_CLASSICAL, NUM_ROUNDS_PQ};
+  static const uint8_t msg[]             = "low memory";
+
+  for (unsigned int i = 0; i < sizeof(num_rounds) / sizeof(num_rounds[0]); ++i) {
+    public_parameters_t pp;
+    if (!create_instance_ex(&pp, 10, 128, 20, 128, num_rounds[i])) {
+      printf("fis low memory: init fail [%u]\n", num_rounds[i]);
+      continue;
+    }
+
+    fis_private_key_t private_key;
+    fis_public_key_t public_key;
+    fis_create_key(&pp, &private_key, &public_key);
+
+    fis_signature_t* fsig = fis_sign_low_memory(&pp, &private_key, msg, sizeof(msg));
+    if (!fsig || fis_verify(&pp, &public_key, msg, sizeof(msg), fsig)) {
+      printf("fis low memory: verify fail [%u]\n", num_rounds[i]);
+    }
+    if (fsig && !fis_verify(&pp, &public_key, msg, sizeof(msg) - 1, fsig)) {
+      printf("fis low memory: verify of other message fail [%u]\n", num_rounds[i]);
+    }
+
+    test_buffer_t buffer = {.max = fis_sig_max_size(&pp)};
+    buffer.data          = malloc(buffer.max);
+    if (fis_sign_write_low_memory(&pp, &private_key, msg, sizeof(msg), test_buffer_write,
+                                  &buffer) ||
+        fis_verify_bytes(&pp, &public_key, msg, sizeof(msg), buffer.data, buffer.len)) {
+      printf("fis low memory: write fail [%u]\n", num_rounds[i]);
+    }
+
+    free(buffer.data);
+    if (fsig) {
+      fis_free_signature(&pp, fsig);
+    }
+    fis_destroy_key(&private_key, &public_key);
+    destroy_instance(&pp);
+  }
+}
+
+static void test_fis_prehash(void) {
+  public_parameters_t pp;
+  if (!create_instance(&pp, 10, 128, 20, 128)) {
+    printf("fis prehash: init fail\n");
+    return;
+  }
+
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+  fis_create_key(&pp, &private_key, &public_key);
+
+  uint8_t msg[1000];
+  for (unsigned int i = 0; i < sizeof(msg); ++i) {
+    msg[i] = i;
+  }
+
+  fis_signer_t* signer = fis_sign_init_prehash(&pp, &private_key);
+  for (unsigned int i = 0; i < sizeof(msg); i += 300) {
+    fis_sign_update(signer, msg + i, sizeof(msg) - i < 300 ? sizeof(msg) - i : 300);
+  }
+  fis_signature_t* fsig = fis_sign_final(signer);
+  if (!fsig || fis_verify_prehash(&pp, &public_key, msg, sizeof(msg), fsig)) {
+    printf("fis prehash: verify fail\n");
+  }
+  // the digest is signed, not the message
+  if (fsig && (!fis_verify(&pp, &public_key, msg, sizeof(msg), fsig) ||
+               !fis_verify_prehash(&pp, &public_key, msg, sizeof(msg) - 1, fsig))) {
+    printf("fis prehash: verify of other message fail\n");
+  }
+
+  unsigned char digest[FIS_PREHASH_SIZE];
+  fis_prehash(msg, sizeof(msg), digest);
+  const unsigned max = fis_sig_max_size(&pp);
+  unsigned char* sig = malloc(max);
+  if (fsig) {
+    const unsigned siglen = fis_sig_serialize(&pp, fsig, sig, max);
+    if (fis_verify_bytes(&pp, &public_key, digest, sizeof(digest), sig, siglen)) {
+      printf("fis prehash: verify bytes fail\n");
+    }
+    fis_free_signature(&pp, fsig);
+  }
+
+  // signers can be dropped before they are finished
+  fis_signer_free(fis_sign_init(&pp, &private_key));
+  signer = fis_sign_init_prehash(&pp, &private_key);
+  fis_sign_update(signer, msg, sizeof(msg));
+  fis_signer_free(signer);
+
+  free(sig);
+  fis_destroy_key(&private_key, &public_key);
+  destroy_instance(&pp);
+}
+
+static void test_fis_verify_bytes(void) {
+  public_parameters_t pp;
+  if (!create_instance(&pp, 10, 128, 20, 128)) {
+    printf("fis verify bytes: init fail\n");
+    return;
+  }
+
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+  fis_create_key(&pp, &private_key, &public_key);
+
+  static const uint8_t msg[] = "verify bytes";
+  fis_signature_t* fsig      = fis_sign(&pp, &private_key, msg, sizeof(msg));
+  // one spare byte for the signature that is too long
+  const unsigned max    = fis_sig_max_size(&pp) + 1;
+  unsigned char* sig    = calloc(1, max);
+  const unsigned siglen = fis_sig_serialize(&pp, fsig, sig, max);
+  if (fis_verify_bytes(&pp, &public_key, msg, sizeof(msg), sig, siglen)) {
+    printf("fis verify bytes: verify fail\n");
+  }
+  const unsigned size =
+      fis_compute_sig_size(pp.lowmc->m, pp.lowmc->n, pp.lowmc->r, pp.lowmc->k, pp.num_rounds);
+  if (size != max - 1 || siglen > size) {
+    printf("fis verify bytes: size fail\n");
+  }
+
+  if (!fis_verify_bytes(&pp, &public_key, msg, sizeof(msg), sig, siglen - 1) ||
+      !fis_verify_bytes(&pp, &public_key, msg, sizeof(msg), sig, siglen + 1)) {
+    printf("fis verify bytes: verify with wrong length fail\n");
+  }
+
+  // a byte of the challenge, a byte of the commitments in the header and a
+  // byte of a repetition
+  const unsigned int tampered[] = {0, (pp.num_rounds + 3) / 4, siglen / 2, siglen - 1};
+  for (unsigned int i = 0; i < sizeof(tampered) / sizeof(tampered[0]); ++i) {
+    sig[tampered[i]] ^= 1;
+    if (!fis_verify_bytes(&pp, &public_key, msg, sizeof(msg), sig, siglen)) {
+      printf("fis verify bytes: verify of tampered signature fail [%u]\n", tampered[i]);
+    }
+    sig[tampered[i]] ^= 1;
+  }
+
+  // the challenge of the first repetition is set to the invalid value 3
+  const unsigned char ch = sig[0];
+  sig[0] |= 3;
+  if (!fis_verify_bytes(&pp, &public_key, msg, sizeof(msg), sig, siglen)) {
+    printf("fis verify bytes: verify of invalid challenge fail\n");
+  }
+  sig[0] = ch;
+
+  free(sig);
+  fis_free_signature(&pp, fsig);
+  fis_destroy_key(&private_key, &public_key);
+  destroy_instance(&pp);
+}
+
+static void test_fis_key_store(void) {
+  public_parameters_t pp;
+  if (!create_instance(&pp, 10, 128, 20, 128)) {
+    printf("fis key store: init fail\n");
+    return;
+  }
+
+  static const unsigned int num_keys = 9;
+  fis_key_store_t* store             = fis_create_keys_batch(&pp, num_keys);
+  mzd_t* zero                        = mzd_local_init(1, pp.lowmc->n);
+  for (unsigned int i = 0; i < num_keys; ++i) {
+    mzd_t* pk = lowmc_call(pp.lowmc, store->private_keys[i].k, zero);
+    if (!mzd_local_equal(pk, store->public_keys[i].pk)) {
+      printf("fis key store: public key fail [%u]\n", i);
+    }
+    mzd_local_free(pk);
+  }
+
+  const unsigned len  = fis_key_store_size(&pp, num_keys);
+  unsigned char* data = malloc(len);
+  if (fis_key_store_serialize(&pp, store, data, len) != len ||
+      fis_key_store_deserialize(&pp, data, len - 1)) {
+    printf("fis key store: serialize fail\n");
+  }
+  // the count is stored big-endian
+  if (data[0] || data[1] || data[2] || data[3] != num_keys) {
+    printf("fis key store: count fail\n");
+  }
+  fis_key_store_t* copy = fis_key_store_deserialize(&pp, data, len);
+  for (unsigned int i = 0; copy && i < num_keys; ++i) {
+    if (!mzd_local_equal(copy->private_keys[i].k, store->private_keys[i].k) ||
+        !mzd_local_equal(copy->public_keys[i].pk, store->public_keys[i].pk)) {
+      printf("fis key store: deserialize fail [%u]\n", i);
+    }
+  }
+
+  // keys of a deserialized store sign, single keys round trip as well
+  const uint8_t msg[] = "key store";
+  fis_signature_t* sig = copy ? fis_sign(&pp, &copy->private_keys[1], msg, sizeof(msg)) : NULL;
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+  unsigned char buf[64];
+  unsigned klen = fis_private_key_serialize(&pp, &store->private_keys[1], buf, sizeof(buf));
+  fis_private_key_deserialize(&pp, &private_key, buf, klen);
+  klen = fis_public_key_serialize(&pp, &store->public_keys[1], buf, sizeof(buf));
+  fis_public_key_deserialize(&pp, &public_key, buf, klen);
+  if (!copy || !sig || fis_verify(&pp, &public_key, msg, sizeof(msg), sig) ||
+      !mzd_local_equal(private_key.k, store->private_keys[1].k)) {
+    printf("fis key store: sign fail\n");
+  }
+
+  if (sig) {
+    fis_free_signature(&pp, sig);
+  }
+  fis_destroy_key(&private_key, &public_key);
+
+  // keys are only serialized in whole bytes
+  lowmc_t odd_lowmc              = *pp.lowmc;
+  odd_lowmc.k                    = 124;
+  public_parameters_t odd_pp     = {.lowmc = &odd_lowmc, .num_rounds = pp.num_rounds};
+  unsigned char odd[4 + 15 + 16] = {0, 0, 0, 1};
+  if (fis_create_keys_batch(&odd_pp, 1) ||
+      fis_key_store_deserialize(&odd_pp, odd, sizeof(odd)) ||
+      fis_private_key_deserialize(&odd_pp, &private_key, odd, fis_private_key_size(&odd_pp)) ||
+      fis_key_store_serialize(&odd_pp, store, data, len)) {
+    printf("fis key store: unaligned key size fail\n");
+  }
+
+  fis_free_key_store(copy);
+  free(data);
+  mzd_local_free(zero);
+  fis_free_key_store(store);
+  destroy_instance(&pp);
+}
+
 void run_tests(void) {
+  test_lowmc_cache_race();
+  test_rand_bytes_fork();
   test_mpc_share();
   test_mpc_add();
   test_mzd_local_equal();
   test_mzd_mul();
+  test_mzd_kernels();
   test_mzd_shift();
+  test_grain_ssg();
+  test_rand_bytes_threads();
+  test_lowmc_cache();
+  test_lowmc_derive();
+  test_lowmc_embedded();
+  test_lowmc_shared();
+  test_mzd_local_rank();
+  test_block_shift();
+  test_mzd_pool();
+  test_lowmc_impl();
+  test_lowmc_batch();
+  test_tree();
+  test_mpc_lowmc_kkw();
+  test_kkw_sign();
+  test_fis_batch();
+  test_fis_stream();
+  test_fis_prehash();
+  test_fis_verify_bytes();
+  test_fis_low_memory();
+  test_fis_write_read();
+  test_fis_key_store();
 }
 
 int main() {
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 
 #include "mzd_additional.h"
+#include "mzd_pool.h"
 #include "randomness.h"
 
 // sizeof(mzd_t) == 64 is only ensured after
@@ -44,6 +45,9 @@ static rci_t calculate_rowstride(rci_t width) {
 //
 // In mzd_local_init_multiple we do the same, but store n mzd_t instances in one
 // memory block.
+//
+// The memory blocks are obtained from mzd_pool_alloc, so vectors and small
+// groups of vectors are served from thread-local slabs instead of malloc.
 
 mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) {
   const rci_t width       = (c + m4ri_radix - 1) / m4ri_radix;
@@ -55,7 +59,10 @@ mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) {
   const size_t buffer_size   = r * rowstride * sizeof(word);
   const size_t rows_size     = r * sizeof(word*);
 
-  unsigned char* buffer = aligned_alloc(32, (mzd_t_size + buffer_size + rows_size + 31) & ~31);
+  unsigned char* buffer = mzd_pool_alloc((mzd_t_size + buffer_size + rows_size + 31) & ~31);
+  if (!buffer) {
+    return NULL;
+  }
 
   mzd_t* A = (mzd_t*)buffer;
   buffer += mzd_t_size;
@@ -96,10 +103,10 @@ mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) {
 
 void mzd_local_free(mzd_t* v) {
   // assert(!v || (v->flags & mzd_flag_custom_layout));
-  free(v);
+  mzd_pool_free(v);
 }
 
-void mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear) {
+bool mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear) {
   const rci_t width       = (c + m4ri_radix - 1) / m4ri_radix;
   const rci_t rowstride   = calculate_rowstride(width);
   const word high_bitmask = __M4RI_LEFT_BITMASK(c % m4ri_radix);
@@ -110,7 +117,13 @@ void mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool cl
   const size_t rows_size     = r * sizeof(word*);
   const size_t size_per_elem = (mzd_t_size + buffer_size + rows_size + 31) & ~31;
 
-  unsigned char* full_buffer = aligned_alloc(32, size_per_elem * n);
+  unsigned char* full_buffer = mzd_pool_alloc(size_per_elem * n);
+  if (!full_buffer) {
+    for (size_t s = 0; s < n; ++s) {
+      dst[s] = NULL;
+    }
+    return false;
+  }
 
   for (size_t s = 0; s < n; ++s, full_buffer += size_per_elem) {
     unsigned char* buffer = full_buffer;
@@ -150,12 +163,13 @@ void mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool cl
     }
 #endif
   }
+  return true;
 }
 
 void mzd_local_free_multiple(mzd_t** vs) {
   if (vs) {
     // assert(!vs[0] || (vs[0]->flags & mzd_flag_custom_layout));
-    free(vs[0]);
+    mzd_pool_free(vs[0]);
   }
 }
 
@@ -173,7 +187,7 @@ mzd_t* mzd_local_copy(mzd_t* dst, mzd_t const* src) {
     if (src->flags & mzd_flag_custom_layout) {
       memcpy(__builtin_assume_aligned(FIRST_ROW(dst), 32),
              __builtin_assume_aligned(CONST_FIRST_ROW(src), 32),
-             src->nrows * sizeof(word) * src->width);
+             src->nrows * sizeof(word) * src->rowstride);
     } else {
       // src can be a mzd_t* from mzd_init, so we can only copy row wise
       for (rci_t i = 0; i < src->nrows; ++i) {
@@ -197,6 +211,14 @@ void mzd_local_clear(mzd_t* c) {
   }
 }
 
+void mzd_local_copy_to_row(mzd_t* A, rci_t i, mzd_t const* v) {
+  memcpy(ROW(A, i), CONST_FIRST_ROW(v), v->width * sizeof(word));
+}
+
+void mzd_local_copy_from_row(mzd_t* v, mzd_t const* A, rci_t i) {
+  memcpy(FIRST_ROW(v), CONST_ROW(A, i), v->width * sizeof(word));
+}
+
 void mzd_randomize_ssl(mzd_t* val) {
   // similar to mzd_randomize but using RAND_Bytes instead
   const word mask_end = val->high_bitmask;
@@ -208,11 +230,17 @@ void mzd_randomize_ssl(mzd_t* val) {
   }
 }
 
-static void mzd_randomize_aes_prng(mzd_t* v, aes_prng_t* aes_prng) {
+void mzd_randomize_aes_prng(mzd_t* v, aes_prng_t* aes_prng) {
   // similar to mzd_randomize but using aes_prng_t instead
   const word mask_end = v->high_bitmask;
-  aes_prng_get_randomness(aes_prng, (unsigned char*)FIRST_ROW(v),
-                          v->width * sizeof(word) * v->nrows);
+  if (v->nrows == 1 || v->width == v->rowstride) {
+    aes_prng_get_randomness(aes_prng, (unsigned char*)FIRST_ROW(v),
+                            v->width * sizeof(word) * v->nrows);
+  } else {
+    for (rci_t i = 0; i < v->nrows; ++i) {
+      aes_prng_get_randomness(aes_prng, (unsigned char*)v->rows[i], v->width * sizeof(word));
+    }
+  }
   if (mask_end != m4ri_ffff) {
     const size_t len1 = v->width - 1;
     for (rci_t i = 0; i < v->nrows; ++i) {
@@ -247,6 +275,18 @@ mzd_t* mzd_init_random_vector_from_seed(const unsigned char key[16], rci_t n) {
   return vector;
 }
 
+void mzd_randomize_row_from_seed(mzd_t* A, rci_t i, rci_t ncols, const unsigned char key[16]) {
+  const wi_t width = (ncols + m4ri_radix - 1) / m4ri_radix;
+  word* row        = ROW(A, i);
+
+  aes_prng_t aes_prng;
+  aes_prng_init(&aes_prng, key);
+  aes_prng_get_randomness(&aes_prng, (unsigned char*)row, width * sizeof(word));
+  aes_prng_clear(&aes_prng);
+
+  row[width - 1] &= __M4RI_LEFT_BITMASK(ncols % m4ri_radix);
+}
+
 void mzd_randomize_multiple_from_seed(mzd_t** vectors, unsigned int count,
                                       const unsigned char key[16]) {
   aes_prng_t aes_prng;
@@ -461,6 +501,21 @@ __attribute__((target("avx2"))) static inline mzd_t* mzd_xor_avx(mzd_t* res, mzd
 #endif
 #endif
 
+static mzd_t* mzd_xor_uint64(mzd_t* res, mzd_t const* first, mzd_t const* second) {
+  unsigned int width    = first->width;
+  const word mask       = first->high_bitmask;
+  word* resptr          = FIRST_ROW(res);
+  word const* firstptr  = CONST_FIRST_ROW(first);
+  word const* secondptr = CONST_FIRST_ROW(second);
+
+  while (width--) {
+    *resptr++ = *firstptr++ ^ *secondptr++;
+  }
+  *(resptr - 1) &= mask;
+
+  return res;
+}
+
 mzd_t* mzd_xor(mzd_t* res, mzd_t const* first, mzd_t const* second) {
 #ifdef WITH_OPT
 #ifdef WITH_AVX2
@@ -475,18 +530,7 @@ mzd_t* mzd_xor(mzd_t* res, mzd_t const* first, mzd_t const* second) {
 #endif
 #endif
 
-  unsigned int width    = first->width;
-  const word mask       = first->high_bitmask;
-  word* resptr          = FIRST_ROW(res);
-  word const* firstptr  = CONST_FIRST_ROW(first);
-  word const* secondptr = CONST_FIRST_ROW(second);
-
-  while (width--) {
-    *resptr++ = *firstptr++ ^ *secondptr++;
-  }
-  *(resptr - 1) &= mask;
-
-  return res;
+  return mzd_xor_uint64(res, first, second);
 }
 
 mzd_t* mzd_mul_v(mzd_t* c, mzd_t const* v, mzd_t const* At) {
@@ -514,7 +558,7 @@ __attribute__((target("sse2"))) static inline mzd_t* mzd_addmul_v_sse(mzd_t* c,
 
   for (unsigned int w = 0; w < width; ++w, ++vptr) {
     word idx             = *vptr;
-    word const* Aptr     = A->rows[w * sizeof(word) * 8];
+    word const* Aptr     = CONST_ROW(A, w * sizeof(word) * 8);
     __m128i const* mAptr = __builtin_assume_aligned(Aptr, 16);
 
     while (idx) {
@@ -623,7 +667,7 @@ __attribute__((target("avx2"))) static inline mzd_t* mzd_addmul_v_avx(mzd_t* c,
 
   for (unsigned int w = 0; w < width; ++w, ++vptr) {
     word idx             = *vptr;
-    word const* Aptr     = A->rows[w * sizeof(word) * 8];
+    word const* Aptr     = CONST_ROW(A, w * sizeof(word) * 8);
     __m256i const* mAptr = __builtin_assume_aligned(Aptr, 32);
 
     while (idx) {
@@ -719,27 +763,7 @@ __attribute__((target("avx2"))) static inline mzd_t* mzd_addmul_v_avx(mzd_t* c,
 #endif
 #endif
 
-mzd_t* mzd_addmul_v(mzd_t* c, mzd_t const* v, mzd_t const* A) {
-  if (A->ncols != c->ncols || A->nrows != v->ncols) {
-    // number of columns does not match
-    return NULL;
-  }
-
-#ifdef WITH_OPT
-  if (A->nrows % (sizeof(word) * 8) == 0) {
-#ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2 && (A->ncols & 0xff) == 0) {
-      return mzd_addmul_v_avx(c, v, A);
-    }
-#endif
-#ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2 && (A->ncols & 0x7f) == 0) {
-      return mzd_addmul_v_sse(c, v, A);
-    }
-#endif
-  }
-#endif
-
+static mzd_t* mzd_addmul_v_uint64(mzd_t* c, mzd_t const* v, mzd_t const* A) {
   const unsigned int len       = A->width;
   const word mask              = A->high_bitmask;
   const unsigned int rowstride = A->rowstride;
@@ -750,7 +774,7 @@ mzd_t* mzd_addmul_v(mzd_t* c, mzd_t const* v, mzd_t const* A) {
   for (unsigned int w = 0; w < width; ++w, ++vptr) {
     word idx = *vptr;
 
-    word const* Aptr = A->rows[w * sizeof(word) * 8];
+    word const* Aptr = CONST_ROW(A, w * sizeof(word) * 8);
     while (idx) {
       if (idx & 0x1) {
         for (unsigned int i = 0; i < len - 1; ++i) {
@@ -767,6 +791,30 @@ mzd_t* mzd_addmul_v(mzd_t* c, mzd_t const* v, mzd_t const* A) {
   return c;
 }
 
+mzd_t* mzd_addmul_v(mzd_t* c, mzd_t const* v, mzd_t const* A) {
+  if (A->ncols != c->ncols || A->nrows != v->ncols) {
+    // number of columns does not match
+    return NULL;
+  }
+
+#ifdef WITH_OPT
+  if (A->nrows % (sizeof(word) * 8) == 0) {
+#ifdef WITH_AVX2
+    if (CPU_SUPPORTS_AVX2 && (A->ncols & 0xff) == 0) {
+      return mzd_addmul_v_avx(c, v, A);
+    }
+#endif
+#ifdef WITH_SSE2
+    if (CPU_SUPPORTS_SSE2 && (A->ncols & 0x7f) == 0) {
+      return mzd_addmul_v_sse(c, v, A);
+    }
+#endif
+  }
+#endif
+
+  return mzd_addmul_v_uint64(c, v, A);
+}
+
 #ifdef WITH_OPT
 #ifdef WITH_SSE2
 __attribute__((target("sse2"))) static inline bool mzd_equal_sse(mzd_t const* restrict first,
@@ -906,6 +954,91 @@ bool mzd_local_equal(mzd_t const* first, mzd_t const* second) {
   return mzd_cmp(first, second) == 0;
 }
 
+#ifdef WITH_OPT
+#ifdef WITH_SSE2
+__attribute__((target("sse2"))) static void mzd_row_xor_sse(word* dst, word const* src,
+                                                             unsigned int len) {
+  mm128_xor_region(__builtin_assume_aligned(dst, 16), __builtin_assume_aligned(src, 16),
+                   len * sizeof(word) / sizeof(__m128i));
+}
+#endif
+
+#ifdef WITH_AVX2
+__attribute__((target("avx2"))) static void mzd_row_xor_avx(word* dst, word const* src,
+                                                            unsigned int len) {
+  mm256_xor_region(__builtin_assume_aligned(dst, 32), __builtin_assume_aligned(src, 32),
+                   len * sizeof(word) / sizeof(__m256i));
+}
+#endif
+#endif
+
+static void mzd_row_xor(word* dst, word const* src, unsigned int len) {
+  while (len--) {
+    *dst++ ^= *src++;
+  }
+}
+
+rci_t mzd_local_rank(mzd_t const* A) {
+  const rci_t nrows    = A->nrows;
+  const wi_t rowstride = A->rowstride;
+
+  mzd_t* B    = mzd_local_copy(NULL, A);
+  word** rows = malloc(nrows * sizeof(word*));
+  for (rci_t i = 0; i < nrows; ++i) {
+    rows[i] = B->rows[i];
+  }
+
+  // Rows of local matrices are aligned and padded to the SIMD width, so whole
+  // vectors can be XORed starting at the vector containing the pivot word.
+  void (*row_xor)(word*, word const*, unsigned int) = mzd_row_xor;
+  unsigned int align = 1;
+#ifdef WITH_OPT
+#ifdef WITH_SSE2
+  if (CPU_SUPPORTS_SSE2) {
+    row_xor = mzd_row_xor_sse;
+    align   = sse_bound;
+  }
+#endif
+#ifdef WITH_AVX2
+  if (CPU_SUPPORTS_AVX2 && (size_t)A->width >= avx_bound) {
+    row_xor = mzd_row_xor_avx;
+    align   = avx_bound;
+  }
+#endif
+#endif
+
+  rci_t rank = 0;
+  for (rci_t c = 0; c < A->ncols && rank < nrows; ++c) {
+    const wi_t w   = c / m4ri_radix;
+    const wi_t w0  = w - w % align;
+    const word bit = m4ri_one << (c % m4ri_radix);
+
+    rci_t pivot = rank;
+    while (pivot < nrows && !(rows[pivot][w] & bit)) {
+      ++pivot;
+    }
+    if (pivot == nrows) {
+      continue;
+    }
+
+    word* tmp   = rows[pivot];
+    rows[pivot] = rows[rank];
+    rows[rank]  = tmp;
+
+    // all words before w are already zero in the pivot row
+    for (rci_t i = rank + 1; i < nrows; ++i) {
+      if (rows[i][w] & bit) {
+        row_xor(rows[i] + w0, tmp + w0, rowstride - w0);
+      }
+    }
+    ++rank;
+  }
+
+  free(rows);
+  mzd_local_free(B);
+  return rank;
+}
+
 static void xor_comb(const unsigned int len, const word mask, word* Brow, word** const Arows,
                      unsigned int r_offset, unsigned comb) {
   while (comb) {
@@ -1115,6 +1248,34 @@ mzd_t* mzd_mul_vl(mzd_t* c, mzd_t const* v, mzd_t const* A) {
   return mzd_addmul_vl(c, v, A);
 }
 
+static mzd_t* mzd_addmul_vl_uint64(mzd_t* c, mzd_t const* v, mzd_t const* A) {
+  const unsigned int len   = A->width;
+  const word mask          = A->high_bitmask;
+  word* cptr               = FIRST_ROW(c);
+  word const* vptr         = CONST_FIRST_ROW(v);
+  const unsigned int width = v->width;
+
+  for (unsigned int w = 0; w < width; ++w, ++vptr) {
+    word idx         = *vptr;
+    unsigned int add = 0;
+
+    while (idx) {
+      const word comb = idx & 0xff;
+
+      word const* Aptr = CONST_ROW(A, w * sizeof(word) * 8 * 32 + add + comb);
+      for (unsigned int i = 0; i < len - 1; ++i) {
+        cptr[i] ^= Aptr[i];
+      }
+      cptr[len - 1] = (cptr[len - 1] ^ Aptr[len - 1]) & mask;
+
+      idx >>= 8;
+      add += 256;
+    }
+  }
+
+  return c;
+}
+
 mzd_t* mzd_addmul_vl(mzd_t* c, mzd_t const* v, mzd_t const* A) {
   if (A->ncols != c->ncols || A->nrows != 32 * v->ncols) {
     // number of columns does not match
@@ -1146,29 +1307,338 @@ mzd_t* mzd_addmul_vl(mzd_t* c, mzd_t const* v, mzd_t const* A) {
   }
 #endif
 
+  return mzd_addmul_vl_uint64(c, v, A);
+}
+
+// v * A for several vectors v. The table is traversed once and the lookups of
+// the vectors are interleaved, so that they do not wait for each other.
+
+static void mzd_addmul_vlm_uint64(mzd_t** c, mzd_t const* const* v, mzd_t const* A,
+                                  unsigned int sc) {
   const unsigned int len   = A->width;
   const word mask          = A->high_bitmask;
-  word* cptr               = FIRST_ROW(c);
-  word const* vptr         = CONST_FIRST_ROW(v);
-  const unsigned int width = v->width;
+  const unsigned int width = v[0]->width;
+
+  for (unsigned int w = 0; w < width; ++w) {
+    for (unsigned int s = 0; s < sizeof(word) * 8; s += 8) {
+      const unsigned int add = (w * sizeof(word) * 8 + s) * 32;
+      for (unsigned int i = 0; i < sc; ++i) {
+        const word comb  = (CONST_FIRST_ROW(v[i])[w] >> s) & 0xff;
+        word const* Aptr = CONST_ROW(A, add + comb);
+        word* cptr       = FIRST_ROW(c[i]);
+        for (unsigned int j = 0; j < len - 1; ++j) {
+          cptr[j] ^= Aptr[j];
+        }
+        cptr[len - 1] = (cptr[len - 1] ^ Aptr[len - 1]) & mask;
+      }
+    }
+  }
+}
 
-  for (unsigned int w = 0; w < width; ++w, ++vptr) {
-    word idx         = *vptr;
-    unsigned int add = 0;
+static void mzd_mul_vlm_uint64(mzd_t** c, mzd_t const* const* v, mzd_t const* A,
+                               unsigned int sc) {
+  for (unsigned int i = 0; i < sc; ++i) {
+    mzd_local_clear(c[i]);
+  }
+  mzd_addmul_vlm_uint64(c, v, A, sc);
+}
 
-    while (idx) {
-      const word comb = idx & 0xff;
+#ifdef WITH_OPT
+// The specialized kernels process the vectors in groups of MZD_VLM_GROUP with
+// the sums kept in registers, the unused lanes of the last group repeat its
+// last vector.
+#define MZD_VLM_GROUP 4
 
-      word const* Aptr = A->rows[w * sizeof(word) * 8 * 32 + add + comb];
-      for (unsigned int i = 0; i < len - 1; ++i) {
-        cptr[i] ^= Aptr[i];
+#ifdef WITH_SSE2
+__attribute__((target("sse2"))) static void mzd_vlm_sse_128(mzd_t** c, mzd_t const* const* v,
+                                                            mzd_t const* A, unsigned int sc,
+                                                            bool add) {
+  const unsigned int width        = v[0]->width;
+  static const unsigned int moff2 = 256;
+
+  for (unsigned int i = 0; i < sc; i += MZD_VLM_GROUP) {
+    word const* vptr[MZD_VLM_GROUP];
+    __m128i* mcptr[MZD_VLM_GROUP];
+    __m128i mc[MZD_VLM_GROUP];
+    for (unsigned int b = 0; b < MZD_VLM_GROUP; ++b) {
+      const unsigned int idx = i + b < sc ? i + b : sc - 1;
+      vptr[b]                = CONST_FIRST_ROW(v[idx]);
+      mcptr[b]               = __builtin_assume_aligned(FIRST_ROW(c[idx]), 16);
+      mc[b]                  = add ? *mcptr[b] : _mm_setzero_si128();
+    }
+
+    __m128i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 16);
+    for (unsigned int w = 0; w < width; ++w) {
+      for (unsigned int s = 0; s < sizeof(word) * 8; s += 8, mAptr += moff2) {
+        for (unsigned int b = 0; b < MZD_VLM_GROUP; ++b) {
+          mc[b] = _mm_xor_si128(mc[b], mAptr[(vptr[b][w] >> s) & 0xff]);
+        }
       }
-      cptr[len - 1] = (cptr[len - 1] ^ Aptr[len - 1]) & mask;
+    }
 
-      idx >>= 8;
-      add += 256;
+    for (unsigned int b = 0; b < MZD_VLM_GROUP; ++b) {
+      *mcptr[b] = mc[b];
     }
   }
+}
 
-  return c;
+__attribute__((target("sse2"))) static void mzd_addmul_vlm_sse_128(mzd_t** c,
+                                                                   mzd_t const* const* v,
+                                                                   mzd_t const* A,
+                                                                   unsigned int sc) {
+  mzd_vlm_sse_128(c, v, A, sc, true);
+}
+
+__attribute__((target("sse2"))) static void mzd_addmul_vlm_sse(mzd_t** c, mzd_t const* const* v,
+                                                               mzd_t const* A, unsigned int sc) {
+  const unsigned int len        = A->width * sizeof(word) / sizeof(__m128i);
+  const unsigned int width      = v[0]->width;
+  const unsigned int mrowstride = A->rowstride * sizeof(word) / sizeof(__m128i);
+  const unsigned int moff2      = 256 * mrowstride;
+
+  __m128i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 16);
+  for (unsigned int w = 0; w < width; ++w) {
+    for (unsigned int s = 0; s < sizeof(word) * 8; s += 8, mAptr += moff2) {
+      for (unsigned int i = 0; i < sc; ++i) {
+        const word comb = (CONST_FIRST_ROW(v[i])[w] >> s) & 0xff;
+        __m128i* mcptr  = __builtin_assume_aligned(FIRST_ROW(c[i]), 16);
+        mm128_xor_region(mcptr, mAptr + comb * mrowstride, len);
+      }
+    }
+  }
+}
+
+__attribute__((target("sse2"))) static void mzd_mul_vlm_sse_128(mzd_t** c, mzd_t const* const* v,
+                                                                mzd_t const* A, unsigned int sc) {
+  mzd_vlm_sse_128(c, v, A, sc, false);
+}
+
+__attribute__((target("sse2"))) static void mzd_mul_vlm_sse(mzd_t** c, mzd_t const* const* v,
+                                                            mzd_t const* A, unsigned int sc) {
+  for (unsigned int i = 0; i < sc; ++i) {
+    mzd_local_clear(c[i]);
+  }
+  mzd_addmul_vlm_sse(c, v, A, sc);
+}
+#endif
+
+#ifdef WITH_AVX2
+__attribute__((target("avx2"))) static void mzd_vlm_avx_256(mzd_t** c, mzd_t const* const* v,
+                                                            mzd_t const* A, unsigned int sc,
+                                                            bool add) {
+  const unsigned int width        = v[0]->width;
+  static const unsigned int moff2 = 256;
+
+  for (unsigned int i = 0; i < sc; i += MZD_VLM_GROUP) {
+    word const* vptr[MZD_VLM_GROUP];
+    __m256i* mcptr[MZD_VLM_GROUP];
+    __m256i mc[MZD_VLM_GROUP];
+    for (unsigned int b = 0; b < MZD_VLM_GROUP; ++b) {
+      const unsigned int idx = i + b < sc ? i + b : sc - 1;
+      vptr[b]                = CONST_FIRST_ROW(v[idx]);
+      mcptr[b]               = __builtin_assume_aligned(FIRST_ROW(c[idx]), 32);
+      mc[b]                  = add ? *mcptr[b] : _mm256_setzero_si256();
+    }
+
+    __m256i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 32);
+    for (unsigned int w = 0; w < width; ++w) {
+      for (unsigned int s = 0; s < sizeof(word) * 8; s += 8, mAptr += moff2) {
+        for (unsigned int b = 0; b < MZD_VLM_GROUP; ++b) {
+          mc[b] = _mm256_xor_si256(mc[b], mAptr[(vptr[b][w] >> s) & 0xff]);
+        }
+      }
+    }
+
+    for (unsigned int b = 0; b < MZD_VLM_GROUP; ++b) {
+      *mcptr[b] = mc[b];
+    }
+  }
+}
+
+__attribute__((target("avx2"))) static void mzd_addmul_vlm_avx_256(mzd_t** c,
+                                                                   mzd_t const* const* v,
+                                                                   mzd_t const* A,
+                                                                   unsigned int sc) {
+  mzd_vlm_avx_256(c, v, A, sc, true);
+}
+
+__attribute__((target("avx2"))) static void mzd_addmul_vlm_avx(mzd_t** c, mzd_t const* const* v,
+                                                               mzd_t const* A, unsigned int sc) {
+  const unsigned int len        = A->width * sizeof(word) / sizeof(__m256i);
+  const unsigned int width      = v[0]->width;
+  const unsigned int mrowstride = A->rowstride * sizeof(word) / sizeof(__m256i);
+  const unsigned int moff2      = 256 * mrowstride;
+
+  __m256i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 32);
+  for (unsigned int w = 0; w < width; ++w) {
+    for (unsigned int s = 0; s < sizeof(word) * 8; s += 8, mAptr += moff2) {
+      for (unsigned int i = 0; i < sc; ++i) {
+        const word comb = (CONST_FIRST_ROW(v[i])[w] >> s) & 0xff;
+        __m256i* mcptr  = __builtin_assume_aligned(FIRST_ROW(c[i]), 32);
+        mm256_xor_region(mcptr, mAptr + comb * mrowstride, len);
+      }
+    }
+  }
+}
+
+__attribute__((target("avx2"))) static void mzd_mul_vlm_avx_256(mzd_t** c, mzd_t const* const* v,
+                                                                mzd_t const* A, unsigned int sc) {
+  mzd_vlm_avx_256(c, v, A, sc, false);
+}
+
+__attribute__((target("avx2"))) static void mzd_mul_vlm_avx(mzd_t** c, mzd_t const* const* v,
+                                                            mzd_t const* A, unsigned int sc) {
+  for (unsigned int i = 0; i < sc; ++i) {
+    mzd_local_clear(c[i]);
+  }
+  mzd_addmul_vlm_avx(c, v, A, sc);
+}
+#endif
+#endif
+
+void mzd_mul_vlm(mzd_t** c, mzd_t const* const* v, mzd_t const* A, unsigned int sc) {
+  for (unsigned int i = 0; i < sc; ++i) {
+    mzd_local_clear(c[i]);
+  }
+  mzd_addmul_vlm(c, v, A, sc);
+}
+
+void mzd_addmul_vlm(mzd_t** c, mzd_t const* const* v, mzd_t const* A, unsigned int sc) {
+  if (!sc || A->ncols != c[0]->ncols || A->nrows != 32 * v[0]->ncols) {
+    // number of columns does not match
+    return;
+  }
+
+#ifdef WITH_OPT
+  if (A->nrows % (sizeof(word) * 8) == 0) {
+#ifdef WITH_AVX2
+    if (CPU_SUPPORTS_AVX2) {
+      if (A->ncols == 256) {
+        mzd_addmul_vlm_avx_256(c, v, A, sc);
+        return;
+      }
+      if ((A->ncols & 0xff) == 0) {
+        mzd_addmul_vlm_avx(c, v, A, sc);
+        return;
+      }
+    }
+#endif
+#ifdef WITH_SSE2
+    if (CPU_SUPPORTS_SSE2) {
+      if (A->ncols == 128) {
+        mzd_addmul_vlm_sse_128(c, v, A, sc);
+        return;
+      }
+      if ((A->ncols & 0x7f) == 0) {
+        mzd_addmul_vlm_sse(c, v, A, sc);
+        return;
+      }
+    }
+#endif
+  }
+#endif
+
+  mzd_addmul_vlm_uint64(c, v, A, sc);
+}
+
+// v * A for the kernels without a variant of their own
+
+static mzd_t* mzd_mul_v_uint64(mzd_t* c, mzd_t const* v, mzd_t const* A) {
+  mzd_local_clear(c);
+  return mzd_addmul_v_uint64(c, v, A);
+}
+
+static mzd_t* mzd_mul_vl_uint64(mzd_t* c, mzd_t const* v, mzd_t const* A) {
+  mzd_local_clear(c);
+  return mzd_addmul_vl_uint64(c, v, A);
+}
+
+#ifdef WITH_OPT
+#ifdef WITH_SSE2
+__attribute__((target("sse2"))) static mzd_t* mzd_mul_v_sse(mzd_t* c, mzd_t const* v,
+                                                             mzd_t const* A) {
+  mzd_local_clear(c);
+  return mzd_addmul_v_sse(c, v, A);
+}
+
+__attribute__((target("sse2"))) static mzd_t* mzd_mul_vl_sse(mzd_t* c, mzd_t const* v,
+                                                              mzd_t const* A) {
+  mzd_local_clear(c);
+  return mzd_addmul_vl_sse(c, v, A);
+}
+#endif
+
+#ifdef WITH_AVX2
+__attribute__((target("avx2"))) static mzd_t* mzd_mul_v_avx(mzd_t* c, mzd_t const* v,
+                                                             mzd_t const* A) {
+  mzd_local_clear(c);
+  return mzd_addmul_v_avx(c, v, A);
+}
+
+__attribute__((target("avx2"))) static mzd_t* mzd_mul_vl_avx(mzd_t* c, mzd_t const* v,
+                                                              mzd_t const* A) {
+  mzd_local_clear(c);
+  return mzd_addmul_vl_avx(c, v, A);
+}
+#endif
+#endif
+
+void mzd_select_kernels(mzd_kernels_t* kernels, rci_t ncols, unsigned int features) {
+  kernels->mul_v     = mzd_mul_v_uint64;
+  kernels->addmul_v  = mzd_addmul_v_uint64;
+  kernels->mul_vl     = mzd_mul_vl_uint64;
+  kernels->addmul_vl  = mzd_addmul_vl_uint64;
+  kernels->mul_vlm    = mzd_mul_vlm_uint64;
+  kernels->addmul_vlm = mzd_addmul_vlm_uint64;
+  kernels->xor        = mzd_xor_uint64;
+
+#ifdef WITH_OPT
+  // the checks follow the dispatch of mzd_mul_v and friends, with the
+  // preferred variants selected last
+#ifdef WITH_SSE2
+  if (features & CPU_FEATURE_SSE2) {
+    if (ncols % word_size_bits == 0) {
+      kernels->xor = mzd_xor_sse;
+    }
+    if ((ncols & 0x7f) == 0) {
+      kernels->mul_v     = mzd_mul_v_sse;
+      kernels->addmul_v  = mzd_addmul_v_sse;
+      kernels->mul_vl     = mzd_mul_vl_sse;
+      kernels->addmul_vl  = mzd_addmul_vl_sse;
+      kernels->mul_vlm    = mzd_mul_vlm_sse;
+      kernels->addmul_vlm = mzd_addmul_vlm_sse;
+    }
+    if (ncols == 128) {
+      kernels->mul_vl     = mzd_mul_vl_sse_128;
+      kernels->addmul_vl  = mzd_addmul_vl_sse_128;
+      kernels->mul_vlm    = mzd_mul_vlm_sse_128;
+      kernels->addmul_vlm = mzd_addmul_vlm_sse_128;
+    }
+  }
+#endif
+#ifdef WITH_AVX2
+  if (features & CPU_FEATURE_AVX2) {
+    if (ncols >= 256 && ncols % word_size_bits == 0) {
+      kernels->xor = mzd_xor_avx;
+    }
+    if ((ncols & 0xff) == 0) {
+      kernels->mul_v     = mzd_mul_v_avx;
+      kernels->addmul_v  = mzd_addmul_v_avx;
+      kernels->mul_vl     = mzd_mul_vl_avx;
+      kernels->addmul_vl  = mzd_addmul_vl_avx;
+      kernels->mul_vlm    = mzd_mul_vlm_avx;
+      kernels->addmul_vlm = mzd_addmul_vlm_avx;
+    }
+    if (ncols == 256) {
+      kernels->mul_vl     = mzd_mul_vl_avx_256;
+      kernels->addmul_vl  = mzd_addmul_vl_avx_256;
+      kernels->mul_vlm    = mzd_mul_vlm_avx_256;
+      kernels->addmul_vlm = mzd_addmul_vlm_avx_256;
+    }
+  }
+#endif
+#else
+  (void)ncols;
+  (void)features;
+#endif
 }
@@ -9,7 +9,8 @@
 
 /**
  * Modified mzd_init calling malloc less often. Do not pass mzd_t instances
- * initialized with this function to mzd_free.
+ * initialized with this function to mzd_free. Returns NULL if the allocation
+ * failed.
  */
 mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) __attribute__((assume_aligned(32)));
 
@@ -21,8 +22,10 @@ mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) __attribute__((assume_ali
 void mzd_local_free(mzd_t* v);
 /**
  * Initialize multiple mzd_t instances using one large enough memory block.
+ *
+ * \return false and all instances set to NULL if the allocation failed
  */
-void mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear)
+bool mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear)
     __attribute__((nonnull(1)));
 
 #define mzd_local_init_multiple(dst, n, r, c) mzd_local_init_multiple_ex(dst, n, r, c, true)
@@ -38,6 +41,16 @@ mzd_t* mzd_local_copy(mzd_t* dst, mzd_t const* src) __attribute__((nonnull(2)));
 
 void mzd_local_clear(mzd_t* c) __attribute__((nonnull));
 
+/**
+ * Copies the vector v into row i of A.
+ */
+void mzd_local_copy_to_row(mzd_t* A, rci_t i, mzd_t const* v) __attribute__((nonnull));
+
+/**
+ * Copies row i of A into the vector v.
+ */
+void mzd_local_copy_from_row(mzd_t* v, mzd_t const* A, rci_t i) __attribute__((nonnull));
+
 /**
  * Initializes a random vector
  *
@@ -47,12 +60,24 @@ mzd_t* mzd_init_random_vector(rci_t n);
 
 mzd_t* mzd_init_random_vector_prng(rci_t n, aes_prng_t* aes_prng);
 
+/**
+ * Fills a matrix with randomness from the given PRNG.
+ */
+void mzd_randomize_aes_prng(mzd_t* v, aes_prng_t* aes_prng) __attribute__((nonnull));
+
 void mzd_randomize_ssl(mzd_t* val) __attribute__((nonnull(1)));
 
 void mzd_randomize_from_seed(mzd_t* vector, const unsigned char key[16]) __attribute__((nonnull));
 
 mzd_t* mzd_init_random_vector_from_seed(const unsigned char key[16], rci_t n);
 
+/**
+ * Fills the first ncols bits of row i of A with the same randomness as
+ * mzd_init_random_vector_from_seed(key, ncols).
+ */
+void mzd_randomize_row_from_seed(mzd_t* A, rci_t i, rci_t ncols, const unsigned char key[16])
+    __attribute__((nonnull));
+
 void mzd_randomize_multiple_from_seed(mzd_t** vectors, unsigned int count,
                                       const unsigned char key[PRNG_KEYSIZE]);
 
@@ -100,17 +125,61 @@ mzd_t* mzd_mul_vl(mzd_t* c, mzd_t const* v, mzd_t const* At) __attribute__((nonn
 mzd_t* mzd_addmul_vl(mzd_t* c, mzd_t const* v, mzd_t const* At) __attribute__((nonnull));
 
 /**
- * Compute v * A optimized for v being a vector.
+ * Instruction set extensions kernels may be selected for.
+ */
+typedef enum {
+  CPU_FEATURE_SSE2 = 1 << 0,
+  CPU_FEATURE_AVX2 = 1 << 1,
+} cpu_feature_t;
+
+typedef mzd_t* (*mzd_mul_fn)(mzd_t* c, mzd_t const* v, mzd_t const* A);
+typedef void (*mzd_mulm_fn)(mzd_t** c, mzd_t const* const* v, mzd_t const* A, unsigned int sc);
+typedef mzd_t* (*mzd_xor_fn)(mzd_t* res, mzd_t const* first, mzd_t const* second);
+
+/**
+ * Variants of mzd_mul_v, mzd_addmul_v, mzd_mul_vl, mzd_addmul_vl, mzd_mul_vlm,
+ * mzd_addmul_vlm and mzd_xor without any checks of the dimensions or the CPU.
+ */
+typedef struct {
+  mzd_mul_fn mul_v;
+  mzd_mul_fn addmul_v;
+  mzd_mul_fn mul_vl;
+  mzd_mul_fn addmul_vl;
+  mzd_mulm_fn mul_vlm;
+  mzd_mulm_fn addmul_vlm;
+  mzd_xor_fn xor;
+} mzd_kernels_t;
+
+/**
+ * Selects the kernels for vectors and matrices with ncols columns that may use
+ * the instruction set extensions in features (a combination of cpu_feature_t).
+ * The SIMD kernels require the number of rows of the matrices to be a multiple
+ * of 64.
+ */
+void mzd_select_kernels(mzd_kernels_t* kernels, rci_t ncols, unsigned int features)
+    __attribute__((nonnull));
+
+/**
+ * Compute v[i] * A for the sc vectors v[i] with the lookup table A, passing
+ * over the table only once.
  */
 void mzd_mul_vlm(mzd_t** c, mzd_t const* const* v, mzd_t const* At, unsigned int sc)
     __attribute__((nonnull));
 
 /**
- * Compute c + v * A optimized for c and v being vectors.
+ * Compute c[i] + v[i] * A for the sc vectors c[i] and v[i] with the lookup
+ * table A, passing over the table only once.
  */
 void mzd_addmul_vlm(mzd_t** c, mzd_t const* const* v, mzd_t const* At, unsigned int sc)
     __attribute__((nonnull));
 
+/**
+ * Computes the rank of A using word-wise Gaussian elimination on a copy of A
+ * with SIMD row additions. In contrast to mzd_echelonize, this function is
+ * reentrant and thus safe to call from multiple threads.
+ */
+rci_t mzd_local_rank(mzd_t const* A) __attribute__((nonnull));
+
 /**
  * Pre-compute matrices for faster mzd_addmul_v computions.
  *
@@ -119,5 +188,9 @@ mzd_t* mzd_precompute_matrix_lookup(mzd_t const* A) __attribute__((nonnull));
 
 #define FIRST_ROW(v) ((word*)(((void*)(v)) + 64))
 #define CONST_FIRST_ROW(v) ((word const*)(((void const*)(v)) + 64))
+#define ROW(v, i) (FIRST_ROW(v) + (size_t)(i) * (v)->rowstride)
+// Only relies on the rowstride and thus also works for matrices without row
+// pointers (e.g. from a mapped instance image).
+#define CONST_ROW(v, i) (CONST_FIRST_ROW(v) + (size_t)(i) * (v)->rowstride)
 
 #endif
@@ -0,0 +1,330 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "mzd_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_MZD_POOL
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Chunks are carved from 64 KiB slabs, one list of slabs per size class. The
+// size classes are multiples of 32 bytes up to 2 KiB, which covers vectors and
+// small groups of vectors. Matrices and lookup tables are larger and are
+// allocated directly.
+//
+// Every chunk is preceded by a 32 byte prefix pointing to its slab (or NULL for
+// direct allocations), so freeing requires no lookup. Each thread owns a pool.
+// Chunks freed by the owning thread go to its free list, chunks freed by other
+// threads are pushed to an atomic list of the owner, which it drains once its
+// free list runs empty. Once all chunks of a slab are freed, mzd_pool_reset
+// rewinds it, so that chunks are handed out in address order again instead of
+// in the scattered order of the free list. Pools of exited threads are kept and
+// handed to the next new thread, so slabs never lose their owner.
+
+#define POOL_ALIGNMENT 32
+#define POOL_SLAB_SIZE (64 * 1024)
+#define POOL_CLASSES 64
+
+typedef struct pool_s pool_t;
+typedef struct slab_s slab_t;
+
+typedef struct chunk_s {
+  slab_t* slab;
+  struct chunk_s* next;
+} chunk_t;
+
+struct slab_s {
+  pool_t* owner;
+  slab_t* next;
+  unsigned int cls;
+  unsigned int used;
+  unsigned int carved;
+  unsigned int capacity;
+  bool empty;
+};
+
+struct pool_s {
+  chunk_t* free[POOL_CLASSES];
+  slab_t* slabs[POOL_CLASSES];
+  slab_t* current[POOL_CLASSES];
+  _Atomic(chunk_t*) remote[POOL_CLASSES];
+  mzd_pool_stats_t stats;
+  pool_t* next;
+};
+
+static const size_t chunk_prefix_size = 32;
+static const size_t slab_header_size  = 64;
+static_assert(sizeof(chunk_t) <= 32, "chunk prefix too large");
+static_assert(sizeof(slab_t) <= 64, "slab header too large");
+
+static pthread_key_t pool_key;
+static pthread_once_t pool_once          = PTHREAD_ONCE_INIT;
+static pthread_mutex_t abandoned_lock    = PTHREAD_MUTEX_INITIALIZER;
+static pool_t* abandoned                 = NULL;
+static _Thread_local pool_t* thread_pool = NULL;
+
+static size_t class_size(unsigned int cls) {
+  return (cls + 1) * POOL_ALIGNMENT;
+}
+
+static void pool_push(pool_t* pool, chunk_t* chunk) {
+  slab_t* slab          = chunk->slab;
+  chunk->next           = pool->free[slab->cls];
+  pool->free[slab->cls] = chunk;
+
+  --slab->used;
+  ++pool->stats.frees;
+  pool->stats.bytes_in_use -= class_size(slab->cls);
+}
+
+static void pool_drain(pool_t* pool, unsigned int cls) {
+  chunk_t* chunk = atomic_exchange_explicit(&pool->remote[cls], NULL, memory_order_acquire);
+  while (chunk) {
+    chunk_t* next = chunk->next;
+    pool_push(pool, chunk);
+    chunk = next;
+  }
+}
+
+// Rewinds all slabs without live chunks, so that they are carved again from the
+// start, or returns them to the system if release is set.
+static void pool_rewind(pool_t* pool, bool release) {
+  for (unsigned int cls = 0; cls < POOL_CLASSES; ++cls) {
+    pool_drain(pool, cls);
+
+    bool any = false, all = true;
+    for (slab_t* slab = pool->slabs[cls]; slab; slab = slab->next) {
+      slab->empty = !slab->used;
+      any |= slab->empty;
+      all &= slab->empty;
+    }
+    if (!any) {
+      continue;
+    }
+
+    if (all) {
+      pool->free[cls] = NULL;
+    } else {
+      for (chunk_t** link = &pool->free[cls]; *link;) {
+        if ((*link)->slab->empty) {
+          *link = (*link)->next;
+        } else {
+          link = &(*link)->next;
+        }
+      }
+    }
+
+    for (slab_t** link = &pool->slabs[cls]; *link;) {
+      slab_t* slab = *link;
+      if (slab->empty && release) {
+        *link = slab->next;
+        free(slab);
+        --pool->stats.slabs;
+        pool->stats.bytes_reserved -= POOL_SLAB_SIZE;
+      } else {
+        if (slab->empty) {
+          slab->carved = 0;
+        }
+        link = &slab->next;
+      }
+    }
+
+    pool->current[cls] = pool->slabs[cls];
+  }
+}
+
+static void pool_abandon(void* arg) {
+  pool_t* pool = arg;
+  pool_rewind(pool, true);
+
+  pthread_mutex_lock(&abandoned_lock);
+  pool->next = abandoned;
+  abandoned  = pool;
+  pthread_mutex_unlock(&abandoned_lock);
+}
+
+static void pool_key_init(void) {
+  pthread_key_create(&pool_key, pool_abandon);
+}
+
+static pool_t* get_pool(void) {
+  pool_t* pool = thread_pool;
+  if (pool) {
+    return pool;
+  }
+
+  pthread_once(&pool_once, pool_key_init);
+
+  pthread_mutex_lock(&abandoned_lock);
+  pool = abandoned;
+  if (pool) {
+    abandoned = pool->next;
+  }
+  pthread_mutex_unlock(&abandoned_lock);
+
+  if (!pool) {
+    pool = calloc(1, sizeof(pool_t));
+    if (!pool) {
+      return NULL;
+    }
+  }
+
+  pool->next  = NULL;
+  thread_pool = pool;
+  pthread_setspecific(pool_key, pool);
+  return pool;
+}
+
+static slab_t* slab_new(pool_t* pool, unsigned int cls) {
+  slab_t* slab = aligned_alloc(POOL_ALIGNMENT, POOL_SLAB_SIZE);
+  if (!slab) {
+    return NULL;
+  }
+
+  slab->owner    = pool;
+  slab->next     = pool->slabs[cls];
+  slab->cls      = cls;
+  slab->used     = 0;
+  slab->carved   = 0;
+  slab->capacity = (POOL_SLAB_SIZE - slab_header_size) / class_size(cls);
+  slab->empty    = false;
+
+  pool->slabs[cls]   = slab;
+  pool->current[cls] = slab;
+  ++pool->stats.slabs;
+  pool->stats.bytes_reserved += POOL_SLAB_SIZE;
+  return slab;
+}
+
+static chunk_t* pool_get_chunk(pool_t* pool, unsigned int cls) {
+  if (!pool->free[cls]) {
+    pool_drain(pool, cls);
+  }
+
+  chunk_t* chunk = pool->free[cls];
+  if (chunk) {
+    pool->free[cls] = chunk->next;
+  } else {
+    slab_t* slab = pool->current[cls];
+    while (slab && slab->carved == slab->capacity) {
+      slab = slab->next;
+    }
+    if (!slab) {
+      slab = slab_new(pool, cls);
+      if (!slab) {
+        return NULL;
+      }
+    }
+    pool->current[cls] = slab;
+
+    chunk = (chunk_t*)((unsigned char*)slab + slab_header_size +
+                       slab->carved++ * class_size(cls));
+    chunk->slab = slab;
+  }
+
+  ++chunk->slab->used;
+  ++pool->stats.allocations;
+  pool->stats.bytes_in_use += class_size(cls);
+  if (pool->stats.bytes_in_use > pool->stats.peak_bytes_in_use) {
+    pool->stats.peak_bytes_in_use = pool->stats.bytes_in_use;
+  }
+  return chunk;
+}
+
+void* mzd_pool_alloc(size_t size) {
+  const size_t total = (size + chunk_prefix_size + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+  const size_t cls   = total / POOL_ALIGNMENT - 1;
+
+  pool_t* pool   = get_pool();
+  chunk_t* chunk = NULL;
+  if (pool && cls < POOL_CLASSES) {
+    chunk = pool_get_chunk(pool, cls);
+  }
+
+  if (!chunk) {
+    chunk = aligned_alloc(POOL_ALIGNMENT, total);
+    if (!chunk) {
+      return NULL;
+    }
+    chunk->slab = NULL;
+    if (pool) {
+      ++pool->stats.large_allocations;
+    }
+  }
+
+  return (unsigned char*)chunk + chunk_prefix_size;
+}
+
+void mzd_pool_free(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  chunk_t* chunk = (chunk_t*)((unsigned char*)ptr - chunk_prefix_size);
+  slab_t* slab   = chunk->slab;
+  if (!slab) {
+    free(chunk);
+    return;
+  }
+
+  pool_t* pool = thread_pool;
+  if (slab->owner == pool) {
+    pool_push(pool, chunk);
+    return;
+  }
+
+  // hand the chunk back to the owning thread
+  _Atomic(chunk_t*)* remote = &slab->owner->remote[slab->cls];
+  chunk_t* head             = atomic_load_explicit(remote, memory_order_relaxed);
+  do {
+    chunk->next = head;
+  } while (!atomic_compare_exchange_weak_explicit(remote, &head, chunk, memory_order_release,
+                                                  memory_order_relaxed));
+  if (pool) {
+    ++pool->stats.remote_frees;
+  }
+}
+
+void mzd_pool_reset(void) {
+  if (thread_pool) {
+    pool_rewind(thread_pool, false);
+  }
+}
+
+void mzd_pool_trim(void) {
+  if (thread_pool) {
+    pool_rewind(thread_pool, true);
+  }
+}
+
+void mzd_pool_get_stats(mzd_pool_stats_t* stats) {
+  if (thread_pool) {
+    *stats = thread_pool->stats;
+  } else {
+    memset(stats, 0, sizeof(*stats));
+  }
+}
+
+#else
+void* mzd_pool_alloc(size_t size) {
+  return aligned_alloc(32, (size + 31) & ~31);
+}
+
+void mzd_pool_free(void* ptr) {
+  free(ptr);
+}
+
+void mzd_pool_reset(void) {}
+
+void mzd_pool_trim(void) {}
+
+void mzd_pool_get_stats(mzd_pool_stats_t* stats) {
+  memset(stats, 0, sizeof(*stats));
+}
+#endif
@@ -0,0 +1,49 @@
+#ifndef MZD_POOL_H
+#define MZD_POOL_H
+
+#include <stddef.h>
+
+/**
+ * Statistics of the pool of the calling thread.
+ */
+typedef struct {
+  size_t allocations;       // allocations served from slabs
+  size_t large_allocations; // allocations too large for the size classes
+  size_t frees;             // chunks returned to this thread's slabs
+  size_t remote_frees;      // chunks handed back to slabs of other threads
+  size_t slabs;             // slabs currently held
+  size_t bytes_reserved;    // memory held by slabs
+  size_t bytes_in_use;      // memory of live chunks
+  size_t peak_bytes_in_use; // high-water mark of bytes_in_use
+} mzd_pool_stats_t;
+
+/**
+ * Allocates size bytes aligned to 32 bytes. Small allocations are served in
+ * O(1) from thread-local size-class slabs, larger ones by aligned_alloc.
+ */
+void* mzd_pool_alloc(size_t size) __attribute__((assume_aligned(32), malloc));
+
+/**
+ * Frees memory obtained from mzd_pool_alloc. The memory may be freed by any
+ * thread.
+ */
+void mzd_pool_free(void* ptr);
+
+/**
+ * Bulk reset of the pool of the calling thread: all slabs without live chunks
+ * are handed out from the start again. Chunks that are still in use are not
+ * affected.
+ */
+void mzd_pool_reset(void);
+
+/**
+ * Like mzd_pool_reset, but returns the slabs without live chunks to the system.
+ */
+void mzd_pool_trim(void);
+
+/**
+ * Retrieves statistics of the pool of the calling thread.
+ */
+void mzd_pool_get_stats(mzd_pool_stats_t* stats) __attribute__((nonnull));
+
+#endif
@@ -8,11 +8,15 @@
 // Size of the randomness for the commitment (\nu)
 #define COMMITMENT_RAND_LENGTH 0
 
-// Repetition count (\gamma)
+// Repetition counts (\gamma) for classical and post-quantum security
+#define NUM_ROUNDS_CLASSICAL 219
+#define NUM_ROUNDS_PQ 438
+
+// Default repetition count
 #ifdef WITH_PQ_PARAMETERS
-#define NUM_ROUNDS 438
+#define NUM_ROUNDS NUM_ROUNDS_PQ
 #else
-#define NUM_ROUNDS 219
+#define NUM_ROUNDS NUM_ROUNDS_CLASSICAL
 #endif
 
 #define FIS_NUM_ROUNDS NUM_ROUNDS
@@ -26,4 +30,11 @@
 // Key size for PRNG
 #define PRNG_KEYSIZE 16
 
+// Maximal party count of the proofs with preprocessing (KKW)
+#define KKW_MAX_PARTIES 64
+// Size of the seeds of the instances and parties
+#define KKW_SEED_SIZE 16
+// Size of the salt bound to all seeds and commitments of a signature
+#define KKW_SALT_SIZE 32
+
 #endif
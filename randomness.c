@@ -2,6 +2,7 @@
 #include "parameters.h"
 
 #include <openssl/rand.h>
+#include <pthread.h>
 
 void init_EVP() {
 #if OPENSSL_VERSION_NUMBER >= 0x10100000
@@ -24,13 +25,17 @@ void cleanup_EVP() {
 #endif
 }
 
+/* A 128 bit IV */
+static const unsigned char aes_prng_iv[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                              '8', '9', '0', '1', '2', '3', '4', '5'};
+
 void aes_prng_init(aes_prng_t* aes_prng, const unsigned char* key) {
   aes_prng->ctx = EVP_CIPHER_CTX_new();
+  EVP_EncryptInit_ex(aes_prng->ctx, EVP_aes_128_ctr(), NULL, key, aes_prng_iv);
+}
 
-  /* A 128 bit IV */
-  static const unsigned char iv[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
-                                       '8', '9', '0', '1', '2', '3', '4', '5'};
-  EVP_EncryptInit_ex(aes_prng->ctx, EVP_aes_128_ctr(), NULL, key, iv);
+void aes_prng_reseed(aes_prng_t* aes_prng, const unsigned char* key) {
+  EVP_EncryptInit_ex(aes_prng->ctx, NULL, NULL, key, aes_prng_iv);
 }
 
 void aes_prng_clear(aes_prng_t* aes_prng) {
@@ -52,22 +57,135 @@ void aes_prng_get_randomness(aes_prng_t* aes_prng, unsigned char* dst, size_t co
   }
 }
 
-// maybe seed with data from /dev/urandom
+static inline uint64_t grain_tap(grain_ssg_t const* grain, unsigned int offset) {
+  return (grain->state_lo >> offset) | (grain->state_hi << (64 - offset));
+}
+
+/**
+ * Clocks the LFSR 16 times at once. This is possible since all taps are at
+ * least 18 bits away from the end of the 80 bit state.
+ */
+static uint64_t grain_clock_16(grain_ssg_t* grain) {
+  const uint64_t bits = (grain->state_lo ^ grain_tap(grain, 13) ^ grain_tap(grain, 23) ^
+                         grain_tap(grain, 38) ^ grain_tap(grain, 51) ^ grain_tap(grain, 62)) &
+                        0xffff;
+
+  grain->state_lo = (grain->state_lo >> 16) | (grain->state_hi << 48);
+  grain->state_hi = bits;
+  return bits;
+}
 
-static aes_prng_t aes_prng;
+bool grain_ssg_init(grain_ssg_t* grain, const unsigned char seed[GRAIN_SEED_SIZE]) {
+  grain->state_lo = 0;
+  for (unsigned int i = 0; i < 8; ++i) {
+    grain->state_lo |= (uint64_t)seed[i] << (8 * i);
+  }
+  grain->state_hi = seed[8] | ((uint64_t)seed[9] << 8);
+  grain->buffer   = 0;
+  grain->buffered = 0;
 
-void init_rand_bytes(void) {
+  // discard the first 160 bits
+  for (unsigned int i = 0; i < 10; ++i) {
+    grain_clock_16(grain);
+  }
+
+  return grain->state_lo || grain->state_hi;
+}
+
+unsigned int grain_ssg_get_bit(grain_ssg_t* grain) {
+  while (!grain->buffered) {
+    // self-shrinking: of each pair of bits, output the second one if the first
+    // one is set
+    const uint64_t bits = grain_clock_16(grain);
+    for (unsigned int i = 0; i < 16; i += 2) {
+      if ((bits >> i) & 0x1) {
+        grain->buffer |= ((bits >> (i + 1)) & 0x1) << grain->buffered++;
+      }
+    }
+  }
+
+  const unsigned int bit = grain->buffer & 0x1;
+  grain->buffer >>= 1;
+  --grain->buffered;
+  return bit;
+}
+
+// Every thread draws from its own AES-CTR generator keyed with RAND_bytes. It
+// is seeded on first use, after RAND_RESEED_INTERVAL bytes and in the child
+// after a fork. Only seeding the first time allocates.
+typedef struct {
+  aes_prng_t aes_prng;
+  size_t remaining;
+  // fork_generation when seeded, 0 if never seeded
+  unsigned int generation;
+} thread_rng_t;
+
+static pthread_key_t rng_key;
+static pthread_once_t rng_once               = PTHREAD_ONCE_INIT;
+static unsigned int fork_generation          = 1;
+static _Thread_local thread_rng_t thread_rng = {{NULL}, 0, 0};
+
+static void rng_clear(void* arg) {
+  thread_rng_t* rng = arg;
+  if (rng->aes_prng.ctx) {
+    aes_prng_clear(&rng->aes_prng);
+  }
+  rng->aes_prng.ctx = NULL;
+  rng->generation   = 0;
+}
+
+// Only the forking thread exists in the child, so no other generator can be
+// stale afterwards.
+static void rng_after_fork(void) {
+  ++fork_generation;
+}
+
+static void rng_key_init(void) {
+  pthread_key_create(&rng_key, rng_clear);
+  pthread_atfork(NULL, NULL, rng_after_fork);
+}
+
+static bool rng_seed(thread_rng_t* rng) {
   unsigned char key[PRNG_KEYSIZE];
-  RAND_bytes(key, sizeof(key));
+  if (RAND_bytes(key, sizeof(key)) != 1) {
+    return false;
+  }
+
+  if (rng->aes_prng.ctx) {
+    aes_prng_reseed(&rng->aes_prng, key);
+  } else {
+    pthread_once(&rng_once, rng_key_init);
+    aes_prng_init(&rng->aes_prng, key);
+    // frees the generator when the thread exits
+    pthread_setspecific(rng_key, rng);
+  }
+  OPENSSL_cleanse(key, sizeof(key));
 
-  aes_prng_init(&aes_prng, key);
+  rng->remaining  = RAND_RESEED_INTERVAL;
+  rng->generation = fork_generation;
+  return rng->aes_prng.ctx != NULL;
+}
+
+void init_rand_bytes(void) {
+  rng_seed(&thread_rng);
 }
 
 int rand_bytes(unsigned char* dst, size_t len) {
-  aes_prng_get_randomness(&aes_prng, dst, len);
+  thread_rng_t* rng = &thread_rng;
+  while (len) {
+    if ((rng->generation != fork_generation || !rng->remaining) && !rng_seed(rng)) {
+      return 0;
+    }
+
+    const size_t count = len < rng->remaining ? len : rng->remaining;
+    aes_prng_get_randomness(&rng->aes_prng, dst, count);
+    rng->remaining -= count;
+    dst += count;
+    len -= count;
+  }
   return 1;
 }
 
 void deinit_rand_bytes(void) {
-  aes_prng_clear(&aes_prng);
+  rng_clear(&thread_rng);
 }
@@ -5,6 +5,7 @@
 #include <openssl/conf.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 void init_EVP();
@@ -13,11 +14,50 @@ void cleanup_EVP();
 typedef struct { EVP_CIPHER_CTX* ctx; } aes_prng_t;
 
 void aes_prng_init(aes_prng_t* aes_prng, const unsigned char* key);
+/**
+ * Restarts the generator with a new key without allocating.
+ */
+void aes_prng_reseed(aes_prng_t* aes_prng, const unsigned char* key);
 void aes_prng_clear(aes_prng_t* aes_prng);
 void aes_prng_get_randomness(aes_prng_t* aes_prng, unsigned char* dst, size_t count);
 
+#define GRAIN_SEED_SIZE 10
+
+/**
+ * The Grain LFSR used as self-shrinking generator as in the LowMC reference
+ * implementation (https://github.com/LowMC/lowmc).
+ */
+typedef struct {
+  uint64_t state_lo;
+  uint64_t state_hi;
+  uint64_t buffer;
+  unsigned int buffered;
+} grain_ssg_t;
+
+/**
+ * Initializes the generator. Bit i of the 80 bit LFSR state is taken from bit
+ * i % 8 of seed[i / 8]. The reference implementation uses a state of all ones.
+ *
+ * \return false if the seed is all zero
+ */
+bool grain_ssg_init(grain_ssg_t* grain, const unsigned char seed[GRAIN_SEED_SIZE]);
+unsigned int grain_ssg_get_bit(grain_ssg_t* grain);
+
+/**
+ * rand_bytes is thread-safe, each thread uses its own generator. It is seeded
+ * lazily, init_rand_bytes only seeds the generator of the calling thread
+ * upfront. deinit_rand_bytes frees the generator of the calling thread, those
+ * of other threads are freed when they exit.
+ */
 void init_rand_bytes(void);
 void deinit_rand_bytes(void);
+/**
+ * Number of bytes a generator outputs before it is reseeded.
+ */
+#define RAND_RESEED_INTERVAL (1 << 24)
+/**
+ * \return 1 on success and 0 if the generator could not be seeded
+ */
 int rand_bytes(unsigned char* dst, size_t len);
 
 #endif
@@ -3,8 +3,19 @@
 #include "timing.h"
 
 bool create_instance(public_parameters_t* pp, int m, int n, int r, int k) {
+  return create_instance_ex(pp, m, n, r, k, NUM_ROUNDS);
+}
+
+bool create_instance_ex(public_parameters_t* pp, int m, int n, int r, int k,
+                        unsigned int num_rounds) {
   TIME_FUNCTION;
 
+  // only the analyzed repetition counts give the claimed soundness
+  if (num_rounds != NUM_ROUNDS_CLASSICAL && num_rounds != NUM_ROUNDS_PQ) {
+    return false;
+  }
+  pp->num_rounds = num_rounds;
+
   START_TIMING;
   pp->lowmc = lowmc_init(m, n, r, k);
   END_TIMING(timing_and_size->gen.lowmc_init);
@@ -16,29 +27,3 @@ void destroy_instance(public_parameters_t* pp) {
   lowmc_free(pp->lowmc);
   pp->lowmc = NULL;
 }
-
-void init_view(mpc_lowmc_t const* mpc_lowmc, view_t* views[NUM_ROUNDS]) {
-  const unsigned int view_count = 2 + mpc_lowmc->r;
-
-  unsigned char* buffer = malloc((view_count * NUM_ROUNDS) * (sizeof(view_t)));
-
-  for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
-    views[i] = (view_t*)buffer;
-    buffer += view_count * sizeof(view_t);
-
-    for (unsigned m = 0; m < SC_PROOF; ++m) {
-      views[i][0].s[m] = mzd_local_init_ex(1, mpc_lowmc->k, false);
-    }
-
-    for (unsigned n = 1; n < view_count; n++) {
-      for (unsigned m = 0; m < SC_PROOF; m++) {
-        views[i][n].s[m] = mzd_local_init(1, mpc_lowmc->n);
-      }
-    }
-  }
-}
-
-void free_view(mpc_lowmc_t const* mpc_lowmc, view_t* views[NUM_ROUNDS]) {
-  (void)mpc_lowmc;
-  free(views[0]);
-}
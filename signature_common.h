@@ -10,13 +10,23 @@
 typedef struct {
   // The LowMC instance.
   mpc_lowmc_t* lowmc;
+  // The repetition count (\gamma).
+  unsigned int num_rounds;
 } public_parameters_t;
 
+/**
+ * Creates an instance with the default repetition count NUM_ROUNDS.
+ */
 bool create_instance(public_parameters_t* pp, int m, int n, int r, int k);
 
-void destroy_instance(public_parameters_t* pp);
+/**
+ * Creates an instance with the given repetition count, which has to be either
+ * NUM_ROUNDS_CLASSICAL or NUM_ROUNDS_PQ. Instances with different counts can be used side by
+ * side.
+ */
+bool create_instance_ex(public_parameters_t* pp, int m, int n, int r, int k,
+                        unsigned int num_rounds);
 
-void init_view(mpc_lowmc_t const* lowmc, view_t* views[NUM_ROUNDS]);
-void free_view(mpc_lowmc_t const* lowmc, view_t* views[NUM_ROUNDS]);
+void destroy_instance(public_parameters_t* pp);
 
 #endif
@@ -1,22 +1,36 @@
 #include "signature_fis.h"
 #include "hashing_util.h"
+#include "io.h"
 #include "lowmc.h"
 #include "mpc.h"
 #include "mpc_lowmc.h"
+#include "mzd_pool.h"
 #include "randomness.h"
 #include "timing.h"
+#include "tree.h"
 
-unsigned fis_compute_sig_size(unsigned m, unsigned n, unsigned r, unsigned k) {
-  unsigned first_view_size = k;
-  unsigned full_view_size  = n;
-  unsigned int_view_size   = 3 * m;
-  // views for mpc_and in sbox, intial view and last view
-  unsigned views = r * int_view_size + first_view_size + full_view_size;
-  // commitment and r and seed
-  unsigned int commitment = 8 * (COMMITMENT_LENGTH + 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE));
-  unsigned int challenge  = (FIS_NUM_ROUNDS + 3) / 4;
+#include <pthread.h>
 
-  return (FIS_NUM_ROUNDS * (commitment + views) + full_view_size + challenge + 7) / 8;
+unsigned fis_compute_sig_size(unsigned m, unsigned n, unsigned r, unsigned k,
+                              unsigned num_rounds) {
+  (void)n;
+  // challenge and commitments of the unopened parties
+  const unsigned header = (num_rounds + 3) / 4 + num_rounds * COMMITMENT_LENGTH;
+  // seeds, key share of the third party and AND gate outputs of the opened
+  // parties, the output shares are recomputed
+  const unsigned repetition =
+      2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + k / 8 + r * ((3 * m + 7) / 8);
+
+  return header + num_rounds * repetition;
+}
+
+unsigned fis_sig_max_size(public_parameters_t const* pp) {
+  return proof_max_size(pp->lowmc, pp->num_rounds, true);
+}
+
+unsigned fis_sig_serialize(public_parameters_t const* pp, fis_signature_t const* sig,
+                           unsigned char* buf, unsigned buflen) {
+  return proof_to_buffer(pp->lowmc, sig->proof, buf, buflen, true);
 }
 
 unsigned char* fis_sig_to_char_array(public_parameters_t* pp, fis_signature_t* sig, unsigned* len) {
@@ -26,7 +40,7 @@ unsigned char* fis_sig_to_char_array(public_parameters_t* pp, fis_signature_t* s
 fis_signature_t* fis_sig_from_char_array(public_parameters_t* pp, unsigned char* data) {
   unsigned len         = 0;
   fis_signature_t* sig = malloc(sizeof(fis_signature_t));
-  sig->proof           = proof_from_char_array(pp->lowmc, 0, data, &len, true);
+  sig->proof           = proof_from_char_array(pp->lowmc, pp->num_rounds, data, &len, true);
   return sig;
 }
 
@@ -35,10 +49,11 @@ bool fis_create_key(public_parameters_t* pp, fis_private_key_t* private_key,
   TIME_FUNCTION;
 
   START_TIMING;
-  private_key->k = lowmc_keygen(pp->lowmc);
+  private_key->k          = lowmc_keygen(pp->lowmc);
+  private_key->round_keys = private_key->k ? lowmc_expand_key(pp->lowmc, private_key->k) : NULL;
   END_TIMING(timing_and_size->gen.keygen);
 
-  if (!private_key->k) {
+  if (!private_key->round_keys) {
     return false;
   }
 
@@ -59,46 +74,336 @@ bool fis_create_key(public_parameters_t* pp, fis_private_key_t* private_key,
 void fis_destroy_key(fis_private_key_t* private_key, fis_public_key_t* public_key) {
   lowmc_key_free(private_key->k);
   private_key->k = NULL;
+  lowmc_round_keys_free(private_key->round_keys);
+  private_key->round_keys = NULL;
 
   mzd_local_free(public_key->pk);
   public_key->pk = NULL;
 }
 
-static proof_t* fis_prove(mpc_lowmc_t* lowmc, lowmc_key_t* lowmc_key, mzd_t* p, const uint8_t* m,
-                          unsigned m_len) {
-  TIME_FUNCTION;
+// The key formats store whole bytes only.
+static bool fis_keys_serializable(public_parameters_t const* pp) {
+  return !(pp->lowmc->k % 8) && !(pp->lowmc->n % 8);
+}
+
+static void store_uint32_be(unsigned char* dst, uint32_t value) {
+  dst[0] = value >> 24;
+  dst[1] = value >> 16;
+  dst[2] = value >> 8;
+  dst[3] = value;
+}
+
+static uint32_t load_uint32_be(const unsigned char* src) {
+  return (uint32_t)src[0] << 24 | (uint32_t)src[1] << 16 | (uint32_t)src[2] << 8 | src[3];
+}
+
+unsigned fis_private_key_size(public_parameters_t const* pp) {
+  return pp->lowmc->k / 8;
+}
+
+unsigned fis_public_key_size(public_parameters_t const* pp) {
+  return pp->lowmc->n / 8;
+}
+
+unsigned fis_private_key_serialize(public_parameters_t const* pp,
+                                   fis_private_key_t const* private_key, unsigned char* buf,
+                                   unsigned buflen) {
+  const unsigned len = fis_private_key_size(pp);
+  if (!fis_keys_serializable(pp) || buflen < len) {
+    return 0;
+  }
+
+  mzd_row_to_char_array(buf, CONST_FIRST_ROW(private_key->k), len, pp->lowmc->k);
+  return len;
+}
 
-  const unsigned int view_count = lowmc->r + 2;
+unsigned fis_public_key_serialize(public_parameters_t const* pp,
+                                  fis_public_key_t const* public_key, unsigned char* buf,
+                                  unsigned buflen) {
+  const unsigned len = fis_public_key_size(pp);
+  if (!fis_keys_serializable(pp) || buflen < len) {
+    return 0;
+  }
 
-  unsigned char r[FIS_NUM_ROUNDS][3][COMMITMENT_RAND_LENGTH];
-  unsigned char keys[FIS_NUM_ROUNDS][3][16];
-  unsigned char secret_sharing_key[16];
+  mzd_row_to_char_array(buf, CONST_FIRST_ROW(public_key->pk), len, pp->lowmc->n);
+  return len;
+}
+
+bool fis_private_key_deserialize(public_parameters_t const* pp, fis_private_key_t* private_key,
+                                 const unsigned char* buf, unsigned len) {
+  private_key->k          = NULL;
+  private_key->round_keys = NULL;
+  if (!fis_keys_serializable(pp) || len != fis_private_key_size(pp)) {
+    return false;
+  }
+
+  private_key->k = mzd_local_init(1, pp->lowmc->k);
+  if (!private_key->k) {
+    return false;
+  }
+  mzd_row_from_char_array(FIRST_ROW(private_key->k), buf, len, pp->lowmc->k);
+  private_key->round_keys = lowmc_expand_key(pp->lowmc, private_key->k);
+  return private_key->round_keys != NULL;
+}
+
+bool fis_public_key_deserialize(public_parameters_t const* pp, fis_public_key_t* public_key,
+                                const unsigned char* buf, unsigned len) {
+  public_key->pk = NULL;
+  if (!fis_keys_serializable(pp) || len != fis_public_key_size(pp)) {
+    return false;
+  }
+
+  public_key->pk = mzd_local_init(1, pp->lowmc->n);
+  if (!public_key->pk) {
+    return false;
+  }
+  mzd_row_from_char_array(FIRST_ROW(public_key->pk), buf, len, pp->lowmc->n);
+  return true;
+}
+
+// Allocates a store for num_keys key pairs, the key vectors are left
+// uninitialized.
+static fis_key_store_t* key_store_init(lowmc_t const* lowmc, unsigned int num_keys) {
+  if (!num_keys) {
+    return NULL;
+  }
+
+  const unsigned int num_round_keys = num_keys * (lowmc->r + 1);
+  fis_key_store_t* store =
+      malloc(sizeof(fis_key_store_t) +
+             num_keys * (sizeof(fis_private_key_t) + sizeof(fis_public_key_t)) +
+             (2 * num_keys + num_round_keys) * sizeof(mzd_t*));
+  if (!store) {
+    return NULL;
+  }
+
+  store->num_keys     = num_keys;
+  store->private_keys = (fis_private_key_t*)(store + 1);
+  store->public_keys  = (fis_public_key_t*)(store->private_keys + num_keys);
+  store->keys         = (mzd_t**)(store->public_keys + num_keys);
+  store->round_keys   = store->keys + num_keys;
+  store->pks          = store->round_keys + num_round_keys;
+
+  // failed allocations are set to NULL, so the store can always be freed
+  bool ok = mzd_local_init_multiple_ex(store->keys, num_keys, 1, lowmc->k, false);
+  ok &= mzd_local_init_multiple_ex(store->round_keys, num_round_keys, 1, lowmc->n, false);
+  ok &= mzd_local_init_multiple_ex(store->pks, num_keys, 1, lowmc->n, false);
+  if (!ok) {
+    fis_free_key_store(store);
+    return NULL;
+  }
+  for (unsigned int i = 0; i < num_keys; ++i) {
+    store->private_keys[i].k          = store->keys[i];
+    store->private_keys[i].round_keys = store->round_keys + i * (lowmc->r + 1);
+    store->public_keys[i].pk          = store->pks[i];
+  }
+  return store;
+}
+
+// Expands the private keys of a store.
+static void key_store_expand(lowmc_t const* lowmc, fis_key_store_t* store) {
+  const unsigned int num_keys = store->num_keys;
+
+#pragma omp parallel for
+  for (unsigned int i = 0; i < num_keys; ++i) {
+    lowmc_expand_key_into(lowmc, store->private_keys[i].k, store->private_keys[i].round_keys);
+  }
+}
+
+// Computes pk = E_k(0) for all keys of a store from their expanded keys.
+static bool key_store_compute_public_keys(lowmc_t const* lowmc, fis_key_store_t* store) {
+  const unsigned int num_keys = store->num_keys;
+
+  mzd_t* const** rk = malloc(num_keys * sizeof(*rk));
+  mzd_t const** p   = malloc(num_keys * sizeof(*p));
+  if (!rk || !p) {
+    free(p);
+    free(rk);
+    return false;
+  }
+
+  // all blocks share the same plaintext
+  mzd_t* zero = mzd_local_init(1, lowmc->n);
+  for (unsigned int i = 0; i < num_keys; ++i) {
+    rk[i] = store->private_keys[i].round_keys;
+    p[i]  = zero;
+  }
+  lowmc_encrypt_batch_round_keys(lowmc, rk, store->pks, p, num_keys);
+
+  mzd_local_free(zero);
+  free(p);
+  free(rk);
+  return true;
+}
+
+fis_key_store_t* fis_create_keys_batch(public_parameters_t const* pp, unsigned int num_keys) {
+  if (!fis_keys_serializable(pp)) {
+    return NULL;
+  }
+
+  lowmc_t const* lowmc   = pp->lowmc;
+  fis_key_store_t* store = key_store_init(lowmc, num_keys);
+  if (!store) {
+    return NULL;
+  }
+
+  // the key material of all keys is drawn at once
+  const unsigned key_size = fis_private_key_size(pp);
+  unsigned char* material = malloc(num_keys * key_size);
+  if (!material || rand_bytes(material, num_keys * key_size) != 1) {
+    free(material);
+    fis_free_key_store(store);
+    return NULL;
+  }
+
+  for (unsigned int i = 0; i < num_keys; ++i) {
+    mzd_t* k = store->keys[i];
+    memset(FIRST_ROW(k), 0, k->rowstride * sizeof(word));
+    mzd_row_from_char_array(FIRST_ROW(k), material + i * key_size, key_size, lowmc->k);
+  }
+  memset(material, 0, num_keys * key_size);
+  free(material);
+
+  key_store_expand(lowmc, store);
+  if (!key_store_compute_public_keys(lowmc, store)) {
+    fis_free_key_store(store);
+    return NULL;
+  }
+  return store;
+}
+
+unsigned fis_key_store_size(public_parameters_t const* pp, unsigned int num_keys) {
+  return sizeof(uint32_t) + num_keys * (fis_private_key_size(pp) + fis_public_key_size(pp));
+}
+
+unsigned fis_key_store_serialize(public_parameters_t const* pp, fis_key_store_t const* store,
+                                 unsigned char* buf, unsigned buflen) {
+  const unsigned len = fis_key_store_size(pp, store->num_keys);
+  if (!fis_keys_serializable(pp) || buflen < len) {
+    return 0;
+  }
+
+  store_uint32_be(buf, store->num_keys);
+  unsigned char* temp = buf + sizeof(uint32_t);
+  for (unsigned int i = 0; i < store->num_keys; ++i) {
+    temp += fis_private_key_serialize(pp, &store->private_keys[i], temp, buf + len - temp);
+    temp += fis_public_key_serialize(pp, &store->public_keys[i], temp, buf + len - temp);
+  }
+  return len;
+}
+
+fis_key_store_t* fis_key_store_deserialize(public_parameters_t const* pp,
+                                           const unsigned char* buf, unsigned len) {
+  if (!fis_keys_serializable(pp) || len < sizeof(uint32_t)) {
+    return NULL;
+  }
+  const uint32_t num_keys = load_uint32_be(buf);
+
+  const unsigned pair_size = fis_private_key_size(pp) + fis_public_key_size(pp);
+  if ((len - sizeof(num_keys)) / pair_size != num_keys ||
+      (len - sizeof(num_keys)) % pair_size) {
+    return NULL;
+  }
+
+  lowmc_t const* lowmc   = pp->lowmc;
+  fis_key_store_t* store = key_store_init(lowmc, num_keys);
+  if (!store) {
+    return NULL;
+  }
+
+  unsigned char const* temp = buf + sizeof(num_keys);
+  for (unsigned int i = 0; i < num_keys; ++i, temp += pair_size) {
+    mzd_t* k = store->keys[i];
+    memset(FIRST_ROW(k), 0, k->rowstride * sizeof(word));
+    mzd_row_from_char_array(FIRST_ROW(k), temp, fis_private_key_size(pp), lowmc->k);
+
+    mzd_t* pk = store->pks[i];
+    memset(FIRST_ROW(pk), 0, pk->rowstride * sizeof(word));
+    mzd_row_from_char_array(FIRST_ROW(pk), temp + fis_private_key_size(pp),
+                            fis_public_key_size(pp), lowmc->n);
+  }
+
+  key_store_expand(lowmc, store);
+  return store;
+}
+
+void fis_free_key_store(fis_key_store_t* store) {
+  if (store) {
+    mzd_local_free_multiple(store->pks);
+    mzd_local_free_multiple(store->round_keys);
+    mzd_local_free_multiple(store->keys);
+    free(store);
+  }
+}
+
+// Seeds and commitments of a proof. The arrays are stored in the same
+// allocation.
+typedef struct {
+  unsigned int num_rounds;
+  unsigned char (*r)[SC_PROOF][COMMITMENT_RAND_LENGTH];
+  unsigned char (*keys)[SC_PROOF][16];
+  unsigned char (*hashes)[SC_PROOF][COMMITMENT_LENGTH];
+  unsigned char* ch;
+} lean_proof_t;
+
+static lean_proof_t* lean_proof_init(unsigned int num_rounds) {
+  const size_t r_size      = num_rounds * SC_PROOF * COMMITMENT_RAND_LENGTH;
+  const size_t keys_size   = num_rounds * SC_PROOF * 16;
+  const size_t hashes_size = num_rounds * SC_PROOF * COMMITMENT_LENGTH;
+
+  lean_proof_t* lean = malloc(sizeof(lean_proof_t) + r_size + keys_size + hashes_size + num_rounds);
+  if (!lean) {
+    return NULL;
+  }
+
+  unsigned char* temp = (unsigned char*)(lean + 1);
+  lean->num_rounds    = num_rounds;
+  lean->r             = (unsigned char(*)[SC_PROOF][COMMITMENT_RAND_LENGTH])temp;
+  temp += r_size;
+  lean->keys = (unsigned char(*)[SC_PROOF][16])temp;
+  temp += keys_size;
+  lean->hashes = (unsigned char(*)[SC_PROOF][COMMITMENT_LENGTH])temp;
+  temp += hashes_size;
+  lean->ch = temp;
+  return lean;
+}
+
+// Message-independent part of the prover: runs the MPC of all repetitions and
+// computes the commitments, but not the challenge.
+static proof_t* fis_prove_commit(mpc_lowmc_t const* lowmc, fis_private_key_t const* private_key,
+                                 mzd_t const* p, lean_proof_t* lean) {
+  TIME_FUNCTION;
+
+  const unsigned int num_rounds                       = lean->num_rounds;
+  unsigned char(*r)[SC_PROOF][COMMITMENT_RAND_LENGTH] = lean->r;
+  unsigned char(*keys)[SC_PROOF][16]                  = lean->keys;
 
   // Generating keys
   START_TIMING;
-  if (rand_bytes((unsigned char*)keys, sizeof(keys)) != 1 ||
-      rand_bytes((unsigned char*)r, sizeof(r)) != 1 ||
-      rand_bytes(secret_sharing_key, sizeof(secret_sharing_key)) != 1) {
-    return 0;
+  if (rand_bytes((unsigned char*)keys, num_rounds * sizeof(*keys)) != 1 ||
+      rand_bytes((unsigned char*)r, num_rounds * sizeof(*r)) != 1) {
+    return NULL;
   }
   END_TIMING(timing_and_size->sign.rand);
 
   START_TIMING;
-  view_t* views[FIS_NUM_ROUNDS];
-  init_view(lowmc, views);
+  proof_t* proof = init_proof(lowmc, num_rounds, SC_PROOF);
+  if (!proof) {
+    return NULL;
+  }
 
-  mzd_shared_t s[FIS_NUM_ROUNDS];
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-    mzd_shared_init(&s[i], lowmc_key);
+  mzd_shared_t s[num_rounds];
+  for (unsigned int i = 0; i < num_rounds; ++i) {
+    mzd_shared_init(&s[i], private_key->k);
     mzd_shared_share_from_keys(&s[i], keys[i]);
   }
   END_TIMING(timing_and_size->sign.secret_sharing);
 
   START_TIMING;
-  mzd_t** c_mpc[FIS_NUM_ROUNDS];
+  mzd_t** c_mpc[num_rounds];
 
 #ifdef WITH_OPENMP
-  mzd_t** rvecs[FIS_NUM_ROUNDS][3];
+  mzd_t** rvecs[num_rounds][3];
 #else
   mzd_t** rvec[SC_PROOF];
   for (unsigned int i = 0; i < SC_PROOF; ++i) {
@@ -108,7 +413,7 @@ static proof_t* fis_prove(mpc_lowmc_t* lowmc, lowmc_key_t* lowmc_key, mzd_t* p,
 #endif
 
 #pragma omp parallel for
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
+  for (unsigned int i = 0; i < num_rounds; ++i) {
 #ifdef WITH_OPENMP
     mzd_t*** rvec = rvecs[i];
     rvec[0]       = mzd_init_random_vectors_from_seed(keys[i][0], lowmc->n, lowmc->r);
@@ -119,27 +424,21 @@ static proof_t* fis_prove(mpc_lowmc_t* lowmc, lowmc_key_t* lowmc_key, mzd_t* p,
       mzd_randomize_multiple_from_seed(rvec[j], lowmc->r, keys[i][j]);
     }
 #endif
-    c_mpc[i] = mpc_lowmc_call(lowmc, &s[i], p, views[i], rvec);
+    c_mpc[i] = mpc_lowmc_call(lowmc, &s[i], p, &proof->views[i], rvec, private_key->round_keys);
   }
   END_TIMING(timing_and_size->sign.lowmc_enc);
 
   START_TIMING;
-  unsigned char hashes[FIS_NUM_ROUNDS][3][COMMITMENT_LENGTH];
+  unsigned char(*hashes)[SC_PROOF][COMMITMENT_LENGTH] = lean->hashes;
 #pragma omp parallel for
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-    H(keys[i][0], c_mpc[i], views[i], 0, view_count, r[i][0], hashes[i][0]);
-    H(keys[i][1], c_mpc[i], views[i], 1, view_count, r[i][1], hashes[i][1]);
-    H(keys[i][2], c_mpc[i], views[i], 2, view_count, r[i][2], hashes[i][2]);
+  for (unsigned int i = 0; i < num_rounds; ++i) {
+    H(keys[i][0], c_mpc[i], &proof->views[i], 0, r[i][0], hashes[i][0]);
+    H(keys[i][1], c_mpc[i], &proof->views[i], 1, r[i][1], hashes[i][1]);
+    H(keys[i][2], c_mpc[i], &proof->views[i], 2, r[i][2], hashes[i][2]);
   }
   END_TIMING(timing_and_size->sign.views);
 
-  START_TIMING;
-  unsigned char ch[FIS_NUM_ROUNDS];
-  fis_H3(hashes, m, m_len, ch);
-
-  proof_t* proof = create_proof(NULL, lowmc, hashes, ch, r, keys, views);
-
-  for (unsigned int j = 0; j < FIS_NUM_ROUNDS; ++j) {
+  for (unsigned int j = 0; j < num_rounds; ++j) {
     mzd_shared_clear(&s[j]);
 #ifdef WITH_OPENMP
     for (unsigned int i = 0; i < SC_PROOF; ++i) {
@@ -157,102 +456,351 @@ static proof_t* fis_prove(mpc_lowmc_t* lowmc, lowmc_key_t* lowmc_key, mzd_t* p,
   }
 #endif
 
-  free_view(lowmc, views);
-  END_TIMING(timing_and_size->sign.challenge);
-
   return proof;
 }
 
-static int fis_proof_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
-                            proof_t const* prf, const uint8_t* m, unsigned m_len) {
+static proof_t* fis_prove(mpc_lowmc_t const* lowmc, unsigned int num_rounds,
+                          fis_private_key_t const* private_key, mzd_t const* p, const uint8_t* m,
+                          unsigned m_len) {
   TIME_FUNCTION;
 
-  const unsigned int view_count      = lowmc->r + 2;
-  const unsigned int last_view_index = lowmc->r + 1;
+  lean_proof_t* lean = lean_proof_init(num_rounds);
+  proof_t* proof     = lean ? fis_prove_commit(lowmc, private_key, p, lean) : NULL;
+  if (proof) {
+    START_TIMING;
+    fis_H3(lean->hashes, num_rounds, m, m_len, lean->ch);
+    create_proof(proof, lowmc, lean->hashes, lean->ch, lean->r, lean->keys);
+    END_TIMING(timing_and_size->sign.challenge);
+  }
 
-#ifdef WITH_OPENMP
-  mzd_t* ycs[FIS_NUM_ROUNDS] = {NULL};
-  mzd_local_init_multiple(ycs, FIS_NUM_ROUNDS, 1, lowmc->n);
-#else
-  mzd_t* yc    = mzd_local_init(1, lowmc->n);
-#endif
+  free(lean);
+  return proof;
+}
 
-  START_TIMING;
-  unsigned char ch[FIS_NUM_ROUNDS];
-  unsigned char hash[FIS_NUM_ROUNDS][2][COMMITMENT_LENGTH];
+// Per-thread scratch space for running the MPC of one repetition at a time.
+typedef struct {
+  view_t view;
+  mzd_t* view_storage;
+  mzd_t** rvec[SC_PROOF];
+} prove_scratch_t;
 
-#ifndef WITH_OPENMP
-  mzd_t** rv[SC_VERIFY];
-  for (unsigned int i = 0; i < SC_VERIFY; ++i) {
-    rv[i] = malloc(sizeof(mzd_t*) * lowmc->r);
-    mzd_local_init_multiple_ex(rv[i], lowmc->r, 1, lowmc->n, false);
+// Returns false if an allocation failed. The scratch space has to be cleared
+// in either case.
+static bool prove_scratch_init(mpc_lowmc_t const* lowmc, prove_scratch_t* scratch) {
+  scratch->view_storage = init_views(lowmc, &scratch->view, 1, SC_PROOF);
+  bool ok               = scratch->view_storage;
+  for (unsigned int i = 0; i < SC_PROOF; ++i) {
+    scratch->rvec[i] = malloc(sizeof(mzd_t*) * lowmc->r);
+    if (!scratch->rvec[i] ||
+        !mzd_local_init_multiple_ex(scratch->rvec[i], lowmc->r, 1, lowmc->n, false)) {
+      ok = false;
+    }
   }
-#endif
+  return ok;
+}
 
-#pragma omp parallel for
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-    unsigned int a_i = getChAt(prf->ch, i);
-    unsigned int b_i = (a_i + 1) % 3;
-    unsigned int c_i = (a_i + 2) % 3;
+static void prove_scratch_clear(prove_scratch_t* scratch) {
+  for (unsigned int i = 0; i < SC_PROOF; ++i) {
+    mzd_local_free_multiple(scratch->rvec[i]);
+    free(scratch->rvec[i]);
+  }
+  mzd_local_free_multiple(&scratch->view_storage);
+}
 
-#ifdef WITH_OPENMP
-    mzd_t** rv[2];
-    rv[0] = mzd_init_random_vectors_from_seed(prf->keys[i][0], lowmc->n, lowmc->r);
-    rv[1] = mzd_init_random_vectors_from_seed(prf->keys[i][1], lowmc->n, lowmc->r);
-#else
-    for (unsigned int j = 0; j < SC_VERIFY; ++j) {
-      mzd_randomize_multiple_from_seed(rv[j], lowmc->r, prf->keys[i][j]);
+// Runs the MPC of one repetition into the scratch views. Everything is derived
+// from the seeds, so running it again yields the same views.
+static mzd_t** fis_prove_repetition(mpc_lowmc_t const* lowmc, fis_private_key_t const* private_key,
+                                    mzd_t const* p, const unsigned char keys[SC_PROOF][16],
+                                    prove_scratch_t* scratch) {
+  mzd_shared_t s;
+  mzd_shared_init(&s, private_key->k);
+  mzd_shared_share_from_keys(&s, keys);
+
+  for (unsigned int j = 0; j < SC_PROOF; ++j) {
+    mzd_randomize_multiple_from_seed(scratch->rvec[j], lowmc->r, keys[j]);
+    // the AND outputs are accumulated into the views
+    mzd_t* view = scratch->view.s[j];
+    memset(FIRST_ROW(view), 0, view->nrows * view->rowstride * sizeof(word));
+  }
+
+  mzd_t** c =
+      mpc_lowmc_call(lowmc, &s, p, &scratch->view, scratch->rvec, private_key->round_keys);
+  mzd_shared_clear(&s);
+  return c;
+}
+
+// First pass of the low-memory prover: computes the commitments of all
+// repetitions and the challenge, but keeps no views.
+static bool fis_commit_low_memory(mpc_lowmc_t const* lowmc, fis_private_key_t const* private_key,
+                                  mzd_t const* p, const uint8_t* m, unsigned m_len,
+                                  lean_proof_t* lean) {
+  const unsigned int num_rounds = lean->num_rounds;
+  if (rand_bytes((unsigned char*)lean->keys, num_rounds * sizeof(*lean->keys)) != 1 ||
+      rand_bytes((unsigned char*)lean->r, num_rounds * sizeof(*lean->r)) != 1) {
+    return false;
+  }
+
+  bool failed = false;
+#pragma omp parallel
+  {
+    prove_scratch_t scratch;
+    const bool scratch_ok = prove_scratch_init(lowmc, &scratch);
+    if (!scratch_ok) {
+#pragma omp atomic write
+      failed = true;
     }
-#endif
 
-    for (unsigned int j = 1; j < view_count - 1; ++j) {
-      mzd_local_clear(prf->views[i][j].s[0]);
+    // every thread has to reach the worksharing loop
+#pragma omp for
+    for (unsigned int i = 0; i < num_rounds; ++i) {
+      if (!scratch_ok) {
+        continue;
+      }
+      mzd_t** c = fis_prove_repetition(lowmc, private_key, p, lean->keys[i], &scratch);
+      for (unsigned int j = 0; j < SC_PROOF; ++j) {
+        H(lean->keys[i][j], c, &scratch.view, j, lean->r[i][j], lean->hashes[i][j]);
+      }
+      mpc_free(c, SC_PROOF);
     }
 
-    mpc_lowmc_verify_keys(lowmc, p, prf->views[i], rv, a_i, prf->keys[i]);
+    prove_scratch_clear(&scratch);
+  }
+  if (failed) {
+    return false;
+  }
 
-    mzd_t* ys[3];
-    ys[a_i] = prf->views[i][last_view_index].s[0];
-    ys[b_i] = prf->views[i][last_view_index].s[1];
-    ys[c_i] = (mzd_t*)c;
+  fis_H3(lean->hashes, num_rounds, m, m_len, lean->ch);
+  return true;
+}
 
-#ifdef WITH_OPENMP
-    mzd_t* yc = ycs[i];
-#endif
-    ys[c_i] = mpc_reconstruct_from_share(yc, ys);
+// Second pass of the low-memory prover: recomputes repetition i and returns the
+// views of the opened parties in s[0] and s[1] of view.
+static void fis_open_low_memory(mpc_lowmc_t const* lowmc, fis_private_key_t const* private_key,
+                                mzd_t const* p, lean_proof_t const* lean, unsigned int i,
+                                prove_scratch_t* scratch, view_t* view) {
+  const unsigned int a = lean->ch[i];
+  const unsigned int b = (a + 1) % 3;
 
-    H(prf->keys[i][0], ys, prf->views[i], 0, view_count, prf->r[i][0], hash[i][0]);
-    H(prf->keys[i][1], ys, prf->views[i], 1, view_count, prf->r[i][1], hash[i][1]);
+  mzd_t** c = fis_prove_repetition(lowmc, private_key, p, lean->keys[i], scratch);
+  mpc_free(c, SC_PROOF);
 
-#ifdef WITH_OPENMP
-    mzd_local_free_multiple(rv[1]);
-    free(rv[1]);
-    mzd_local_free_multiple(rv[0]);
-    free(rv[0]);
-#endif
+  view->s[0] = scratch->view.s[a];
+  view->s[1] = scratch->view.s[b];
+  view->s[2] = NULL;
+}
+
+static proof_t* fis_prove_low_memory(mpc_lowmc_t const* lowmc, unsigned int num_rounds,
+                                     fis_private_key_t const* private_key, mzd_t const* p,
+                                     const uint8_t* m, unsigned m_len) {
+  lean_proof_t* lean = lean_proof_init(num_rounds);
+  if (!lean || !fis_commit_low_memory(lowmc, private_key, p, m, m_len, lean)) {
+    free(lean);
+    return NULL;
   }
-  fis_H3_verify(hash, prf->hashes, prf->ch, m, m_len, ch);
 
-#ifdef WITH_OPENMP
-  mzd_local_free_multiple(ycs);
-#else
+  // only the views of the two opened parties are kept
+  proof_t* proof = init_proof(lowmc, num_rounds, SC_VERIFY);
+  if (!proof) {
+    free(lean);
+    return NULL;
+  }
+
+  bool failed = false;
+#pragma omp parallel
+  {
+    prove_scratch_t scratch;
+    const bool scratch_ok = prove_scratch_init(lowmc, &scratch);
+    if (!scratch_ok) {
+#pragma omp atomic write
+      failed = true;
+    }
+
+#pragma omp for
+    for (unsigned int i = 0; i < num_rounds; ++i) {
+      if (!scratch_ok) {
+        continue;
+      }
+      const unsigned int a = lean->ch[i];
+      const unsigned int b = (a + 1) % 3;
+      const unsigned int c = (a + 2) % 3;
+
+      view_t opened;
+      fis_open_low_memory(lowmc, private_key, p, lean, i, &scratch, &opened);
+      for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+        mzd_t* dst = proof->views[i].s[j];
+        memcpy(FIRST_ROW(dst), CONST_FIRST_ROW(opened.s[j]),
+               dst->nrows * dst->rowstride * sizeof(word));
+      }
+
+      memcpy(proof->hashes[i], lean->hashes[i][c], COMMITMENT_LENGTH);
+      memcpy(proof->r[i][0], lean->r[i][a], COMMITMENT_RAND_LENGTH);
+      memcpy(proof->r[i][1], lean->r[i][b], COMMITMENT_RAND_LENGTH);
+      memcpy(proof->keys[i][0], lean->keys[i][a], PRNG_KEYSIZE);
+      memcpy(proof->keys[i][1], lean->keys[i][b], PRNG_KEYSIZE);
+    }
+
+    prove_scratch_clear(&scratch);
+  }
+  if (failed) {
+    free_proof(lowmc, proof);
+    free(lean);
+    return NULL;
+  }
+
+  for (unsigned int i = 0; i < num_rounds; ++i) {
+    proof->ch[i / 4] |= lean->ch[i] << ((i % 4) << 1);
+  }
+
+  free(lean);
+  return proof;
+}
+
+// Size of the challenge and the commitments of the unopened parties at the
+// start of a serialized signature.
+static unsigned fis_header_size(unsigned int num_rounds) {
+  return (num_rounds + 3) / 4 + num_rounds * COMMITMENT_LENGTH;
+}
+
+// Size of one serialized repetition with challenge ch.
+static unsigned fis_repetition_size(mpc_lowmc_t const* lowmc, unsigned int ch) {
+  return 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + (ch ? lowmc->k / 8 : 0) +
+         lowmc->r * ((3 * lowmc->m + 7) / 8);
+}
+
+// Per-thread scratch space for verifying one repetition at a time.
+typedef struct {
+  view_t view;
+  mzd_t* view_storage;
+  mzd_t** rv[SC_VERIFY];
+  mzd_t* ys[3];
+} verify_scratch_t;
+
+// Returns false if an allocation failed. The scratch space has to be cleared
+// in either case.
+static bool verify_scratch_init(mpc_lowmc_t const* lowmc, verify_scratch_t* scratch,
+                                bool with_view) {
+  scratch->view_storage = with_view ? init_views(lowmc, &scratch->view, 1, SC_VERIFY) : NULL;
+  bool ok               = !with_view || scratch->view_storage;
   for (unsigned int i = 0; i < SC_VERIFY; ++i) {
-    mzd_local_free_multiple(rv[i]);
-    free(rv[i]);
+    scratch->rv[i] = malloc(sizeof(mzd_t*) * lowmc->r);
+    if (!scratch->rv[i] ||
+        !mzd_local_init_multiple_ex(scratch->rv[i], lowmc->r, 1, lowmc->n, false)) {
+      ok = false;
+    }
   }
-  mzd_local_free(yc);
-#endif
+  if (!mzd_local_init_multiple(scratch->ys, 3, 1, lowmc->n)) {
+    ok = false;
+  }
+  return ok;
+}
+
+static void verify_scratch_clear(verify_scratch_t* scratch) {
+  mzd_local_free_multiple(scratch->ys);
+  for (unsigned int i = 0; i < SC_VERIFY; ++i) {
+    mzd_local_free_multiple(scratch->rv[i]);
+    free(scratch->rv[i]);
+  }
+  if (scratch->view_storage) {
+    mzd_local_free_multiple(&scratch->view_storage);
+  }
+}
+
+// Recomputes the view of the first opened party and the commitments of both.
+static void fis_verify_repetition(mpc_lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
+                                  view_t const* view,
+                                  const unsigned char keys[SC_VERIFY][PRNG_KEYSIZE],
+                                  const unsigned char r[SC_VERIFY][COMMITMENT_RAND_LENGTH],
+                                  unsigned int a_i, verify_scratch_t* scratch,
+                                  unsigned char hash[SC_VERIFY][COMMITMENT_LENGTH]) {
+  const unsigned int last_view_index = lowmc->r + 1;
+  const unsigned int b_i             = (a_i + 1) % 3;
+  const unsigned int c_i             = (a_i + 2) % 3;
 
-  unsigned char ch_collapsed[(FIS_NUM_ROUNDS + 3) / 4] = {0};
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    mzd_randomize_multiple_from_seed(scratch->rv[j], lowmc->r, keys[j]);
+  }
+
+  // the AND outputs of the first party are recomputed
+  memset(ROW(view->s[0], 1), 0, lowmc->r * view->s[0]->rowstride * sizeof(word));
+
+  // also recomputes the output shares of both parties
+  mpc_lowmc_verify_keys(lowmc, p, view, scratch->rv, a_i, keys);
+
+  mzd_t** ys = scratch->ys;
+  mzd_t* y[3];
+  y[a_i] = ys[a_i];
+  y[b_i] = ys[b_i];
+  y[c_i] = (mzd_t*)c;
+  mzd_local_copy_from_row(y[a_i], view->s[0], last_view_index);
+  mzd_local_copy_from_row(y[b_i], view->s[1], last_view_index);
+
+  y[c_i] = mpc_reconstruct_from_share(ys[c_i], y);
+
+  H(keys[0], y, view, 0, r[0], hash[0]);
+  H(keys[1], y, view, 1, r[1], hash[1]);
+}
+
+static int fis_compare_challenge(unsigned char const* ch, unsigned char const* ch_in,
+                                 unsigned int num_rounds) {
+  unsigned char ch_collapsed[(num_rounds + 3) / 4];
+  memset(ch_collapsed, 0, sizeof(ch_collapsed));
+  for (unsigned int i = 0; i < num_rounds; ++i) {
     const unsigned int idx   = i / 4;
     const unsigned int shift = (i % 4) << 1;
 
     ch_collapsed[idx] |= ch[i] << shift;
   }
 
+  return memcmp(ch_collapsed, ch_in, sizeof(ch_collapsed));
+}
+
+static int fis_check_challenge(unsigned char const hash[][2][COMMITMENT_LENGTH],
+                               unsigned char const hashes[][COMMITMENT_LENGTH],
+                               unsigned char const* ch_in, unsigned int num_rounds,
+                               const uint8_t* m, unsigned m_len) {
+  unsigned char ch[num_rounds];
+  fis_H3_verify(hash, hashes, ch_in, num_rounds, m, m_len, ch);
+
+  return fis_compare_challenge(ch, ch_in, num_rounds);
+}
+
+static int fis_proof_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
+                            proof_t const* prf, const uint8_t* m, unsigned m_len) {
+  TIME_FUNCTION;
+
+  const unsigned int num_rounds = prf->num_rounds;
+
+  START_TIMING;
+  unsigned char hash[num_rounds][2][COMMITMENT_LENGTH];
+
+  bool failed = false;
+#pragma omp parallel
+  {
+    verify_scratch_t scratch;
+    const bool scratch_ok = verify_scratch_init(lowmc, &scratch, false);
+    if (!scratch_ok) {
+#pragma omp atomic write
+      failed = true;
+    }
+
+    // every thread has to reach the worksharing loop
+#pragma omp for
+    for (unsigned int i = 0; i < num_rounds; ++i) {
+      if (!scratch_ok) {
+        continue;
+      }
+      fis_verify_repetition(lowmc, p, c, &prf->views[i], prf->keys[i], prf->r[i],
+                            getChAt(prf->ch, i), &scratch, hash[i]);
+    }
+
+    verify_scratch_clear(&scratch);
+  }
+  if (failed) {
+    return -1;
+  }
+
   const int success_status =
-      memcmp(ch_collapsed, prf->ch, ((FIS_NUM_ROUNDS + 3) / 4) * sizeof(unsigned char));
+      fis_check_challenge(hash, prf->hashes, prf->ch, num_rounds, m, m_len);
   END_TIMING(timing_and_size->verify.verify);
 
   START_TIMING;
@@ -260,24 +808,750 @@ static int fis_proof_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, mzd_t cons
   return success_status;
 }
 
+// Verifies a serialized signature. The repetitions are parsed one at a time
+// into the scratch space of the verifying thread, so the memory needed does not
+// depend on the number of repetitions.
+static int fis_proof_verify_bytes(mpc_lowmc_t const* lowmc, unsigned int num_rounds,
+                                  mzd_t const* p, mzd_t const* c, unsigned char const* data,
+                                  unsigned len, const uint8_t* m, unsigned m_len) {
+  TIME_FUNCTION;
+
+  const unsigned ch_size    = (num_rounds + 3) / 4;
+  const unsigned seeds_size = 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE);
+
+  if (len < fis_header_size(num_rounds)) {
+    return -1;
+  }
+
+  unsigned char const* ch_in = data;
+  unsigned char const(*hashes)[COMMITMENT_LENGTH] =
+      (unsigned char const(*)[COMMITMENT_LENGTH])(data + ch_size);
+
+  // the repetitions differ in size, so compute their offsets upfront
+  unsigned offsets[num_rounds];
+  unsigned offset = fis_header_size(num_rounds);
+  for (unsigned int i = 0; i < num_rounds; ++i) {
+    const unsigned int ch = getChAt(ch_in, i);
+    if (ch > 2) {
+      return -1;
+    }
+    offsets[i] = offset;
+    offset += fis_repetition_size(lowmc, ch);
+  }
+  if (offset != len) {
+    return -1;
+  }
+
+  START_TIMING;
+  unsigned char hash[num_rounds][2][COMMITMENT_LENGTH];
+
+  bool failed = false;
+#pragma omp parallel
+  {
+    verify_scratch_t scratch;
+    const bool scratch_ok = verify_scratch_init(lowmc, &scratch, true);
+    if (!scratch_ok) {
+#pragma omp atomic write
+      failed = true;
+    }
+
+#pragma omp for
+    for (unsigned int i = 0; i < num_rounds; ++i) {
+      if (!scratch_ok) {
+        continue;
+      }
+      unsigned char const* rep = data + offsets[i];
+      const unsigned int a_i   = getChAt(ch_in, i);
+
+      unsigned char const(*r)[COMMITMENT_RAND_LENGTH] =
+          (unsigned char const(*)[COMMITMENT_RAND_LENGTH])rep;
+      unsigned char const(*keys)[PRNG_KEYSIZE] =
+          (unsigned char const(*)[PRNG_KEYSIZE])(rep + 2 * COMMITMENT_RAND_LENGTH);
+
+      views_from_char_array(lowmc, &scratch.view, rep + seeds_size, keys, a_i);
+      fis_verify_repetition(lowmc, p, c, &scratch.view, keys, r, a_i, &scratch, hash[i]);
+    }
+
+    verify_scratch_clear(&scratch);
+  }
+  if (failed) {
+    return -1;
+  }
+
+  const int success_status = fis_check_challenge(hash, hashes, ch_in, num_rounds, m, m_len);
+  END_TIMING(timing_and_size->verify.verify);
+
+  return success_status;
+}
+
+struct fis_verifier_s {
+  mpc_lowmc_t const* lowmc;
+  unsigned int num_rounds;
+  mzd_t const* pk;
+  mzd_t* p;
+  SHA256_CTX ctx;
+  verify_scratch_t scratch;
+
+  // the challenge followed by the commitments of the unopened parties
+  unsigned char* header;
+  unsigned int header_size;
+  bool header_done;
+  bool failed;
+  // next repetition to verify
+  unsigned int round;
+  // bytes of the header or the current repetition collected so far
+  unsigned int received;
+  // repetitions split across chunks are collected here
+  unsigned char* buffer;
+};
+
+fis_verifier_t* fis_verifier_init(public_parameters_t* pp, fis_public_key_t* public_key) {
+  fis_verifier_t* verifier = calloc(1, sizeof(fis_verifier_t));
+  if (!verifier) {
+    return NULL;
+  }
+
+  verifier->header_size = fis_header_size(pp->num_rounds);
+  verifier->header      = malloc(verifier->header_size);
+  verifier->buffer      = malloc(fis_repetition_size(pp->lowmc, 1));
+  if (!verifier->header || !verifier->buffer) {
+    free(verifier->header);
+    free(verifier->buffer);
+    free(verifier);
+    return NULL;
+  }
+
+  verifier->lowmc      = pp->lowmc;
+  verifier->num_rounds = pp->num_rounds;
+  verifier->pk         = public_key->pk;
+  verifier->p          = mzd_local_init(1, pp->lowmc->n);
+  if (!verify_scratch_init(pp->lowmc, &verifier->scratch, true) || !verifier->p) {
+    verify_scratch_clear(&verifier->scratch);
+    mzd_local_free(verifier->p);
+    free(verifier->header);
+    free(verifier->buffer);
+    free(verifier);
+    return NULL;
+  }
+  fis_H3_verify_init(&verifier->ctx);
+
+  return verifier;
+}
+
+static void fis_verifier_process(fis_verifier_t* verifier, unsigned char const* rep) {
+  const unsigned int i            = verifier->round++;
+  const unsigned int a_i          = getChAt(verifier->header, i);
+  verify_scratch_t* const scratch = &verifier->scratch;
+
+  unsigned char const(*r)[COMMITMENT_RAND_LENGTH] =
+      (unsigned char const(*)[COMMITMENT_RAND_LENGTH])rep;
+  unsigned char const(*keys)[PRNG_KEYSIZE] =
+      (unsigned char const(*)[PRNG_KEYSIZE])(rep + 2 * COMMITMENT_RAND_LENGTH);
+  unsigned char const* hp =
+      verifier->header + (verifier->num_rounds + 3) / 4 + i * COMMITMENT_LENGTH;
+
+  unsigned char hash[SC_VERIFY][COMMITMENT_LENGTH];
+  views_from_char_array(verifier->lowmc, &scratch->view,
+                        rep + 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE), keys, a_i);
+  fis_verify_repetition(verifier->lowmc, verifier->p, verifier->pk, &scratch->view, keys, r, a_i,
+                        scratch, hash);
+  fis_H3_verify_update(&verifier->ctx, hash, hp, a_i);
+}
+
+int fis_verifier_update(fis_verifier_t* verifier, const unsigned char* data, size_t len) {
+  if (!verifier->header_done && len) {
+    const size_t missing = verifier->header_size - verifier->received;
+    const size_t count   = len < missing ? len : missing;
+    memcpy(verifier->header + verifier->received, data, count);
+    verifier->received += count;
+    data += count;
+    len -= count;
+
+    if (verifier->received == verifier->header_size) {
+      verifier->header_done = true;
+      verifier->received    = 0;
+      for (unsigned int i = 0; i < verifier->num_rounds; ++i) {
+        if (getChAt(verifier->header, i) > 2) {
+          verifier->failed = true;
+        }
+      }
+    }
+  }
+
+  while (len && !verifier->failed) {
+    if (verifier->round == verifier->num_rounds) {
+      // trailing bytes
+      verifier->failed = true;
+      break;
+    }
+
+    const unsigned size =
+        fis_repetition_size(verifier->lowmc, getChAt(verifier->header, verifier->round));
+    if (!verifier->received && len >= size) {
+      // complete repetitions are processed in place
+      fis_verifier_process(verifier, data);
+      data += size;
+      len -= size;
+      continue;
+    }
+
+    const size_t missing = size - verifier->received;
+    const size_t count   = len < missing ? len : missing;
+    memcpy(verifier->buffer + verifier->received, data, count);
+    verifier->received += count;
+    data += count;
+    len -= count;
+
+    if (verifier->received == size) {
+      fis_verifier_process(verifier, verifier->buffer);
+      verifier->received = 0;
+    }
+  }
+
+  return verifier->failed ? -1 : 0;
+}
+
+int fis_verifier_update_message(fis_verifier_t* verifier, const uint8_t* msg, size_t msglen) {
+  if (!verifier->header_done || verifier->round != verifier->num_rounds) {
+    verifier->failed = true;
+  }
+  if (!verifier->failed) {
+    fis_H3_update(&verifier->ctx, msg, msglen);
+  }
+  return verifier->failed ? -1 : 0;
+}
+
+int fis_verifier_final(fis_verifier_t* verifier, const uint8_t* msg, size_t msglen) {
+  int res                       = -1;
+  const unsigned int num_rounds = verifier->num_rounds;
+  if (!verifier->failed && verifier->header_done && verifier->round == num_rounds) {
+    unsigned char ch[num_rounds];
+    fis_H3_verify_final(&verifier->ctx, num_rounds, msg, msglen, ch);
+    res = fis_compare_challenge(ch, verifier->header, num_rounds);
+  }
+
+  verify_scratch_clear(&verifier->scratch);
+  mzd_local_free(verifier->p);
+  free(verifier->buffer);
+  free(verifier->header);
+  free(verifier);
+  mzd_pool_reset();
+  return res;
+}
+
+int fis_verify_read(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
+                    size_t msglen, fis_read_callback_t read, void* opaque) {
+  fis_verifier_t* verifier = fis_verifier_init(pp, public_key);
+  if (!verifier) {
+    return -1;
+  }
+
+  unsigned char chunk[4096];
+  size_t len;
+  while ((len = read(opaque, chunk, sizeof(chunk))) > 0) {
+    if (fis_verifier_update(verifier, chunk, len)) {
+      break;
+    }
+  }
+
+  return fis_verifier_final(verifier, msg, msglen);
+}
+
 fis_signature_t* fis_sign(public_parameters_t* pp, fis_private_key_t* private_key,
                           const uint8_t* msg, size_t msglen) {
   fis_signature_t* sig = malloc(sizeof(fis_signature_t));
   mzd_t* p             = mzd_local_init(1, pp->lowmc->n);
-  sig->proof           = fis_prove(pp->lowmc, private_key->k, p, msg, msglen);
+  sig->proof           = fis_prove(pp->lowmc, pp->num_rounds, private_key, p, msg, msglen);
+  mzd_local_free(p);
+  // temporaries of the proof are gone, reuse their memory in address order
+  mzd_pool_reset();
+  return sig;
+}
+
+// Writes the proof repetition by repetition, collecting them in chunks to
+// avoid tiny writes.
+static int fis_write_proof(mpc_lowmc_t const* lowmc, proof_t const* proof,
+                           fis_write_callback_t write, void* opaque) {
+  const unsigned int num_rounds = proof->num_rounds;
+  if (write(opaque, proof->ch, (num_rounds + 3) / 4) ||
+      write(opaque, (unsigned char const*)proof->hashes, num_rounds * COMMITMENT_LENGTH)) {
+    return -1;
+  }
+
+  unsigned char chunk[4096];
+  unsigned int used = 0;
+  for (unsigned int i = 0; i < num_rounds; ++i) {
+    const unsigned int ch = getChAt(proof->ch, i);
+    if (used + fis_repetition_size(lowmc, ch) > sizeof(chunk)) {
+      if (write(opaque, chunk, used)) {
+        return -1;
+      }
+      used = 0;
+    }
+
+    unsigned char* temp = chunk + used;
+    memcpy(temp, proof->r[i], 2 * COMMITMENT_RAND_LENGTH);
+    temp += 2 * COMMITMENT_RAND_LENGTH;
+    memcpy(temp, proof->keys[i], 2 * PRNG_KEYSIZE);
+    temp += 2 * PRNG_KEYSIZE;
+    temp += views_to_char_array(lowmc, temp, &proof->views[i], ch);
+    used = temp - chunk;
+  }
+
+  return used ? write(opaque, chunk, used) : 0;
+}
+
+int fis_sign_write(public_parameters_t* pp, fis_private_key_t* private_key, const uint8_t* msg,
+                   size_t msglen, fis_write_callback_t write, void* opaque) {
+  mzd_t* p       = mzd_local_init(1, pp->lowmc->n);
+  proof_t* proof = fis_prove(pp->lowmc, pp->num_rounds, private_key, p, msg, msglen);
   mzd_local_free(p);
+
+  int res = -1;
+  if (proof) {
+    res = fis_write_proof(pp->lowmc, proof, write, opaque);
+    free_proof(pp->lowmc, proof);
+  }
+  mzd_pool_reset();
+  return res;
+}
+
+fis_signature_t* fis_sign_low_memory(public_parameters_t* pp, fis_private_key_t* private_key,
+                                     const uint8_t* msg, size_t msglen) {
+  mzd_t* p       = mzd_local_init(1, pp->lowmc->n);
+  proof_t* proof =
+      p ? fis_prove_low_memory(pp->lowmc, pp->num_rounds, private_key, p, msg, msglen) : NULL;
+  mzd_local_free(p);
+  mzd_pool_reset();
+
+  if (!proof) {
+    return NULL;
+  }
+
+  fis_signature_t* sig = malloc(sizeof(fis_signature_t));
+  if (!sig) {
+    free_proof(pp->lowmc, proof);
+    return NULL;
+  }
+  sig->proof = proof;
   return sig;
 }
 
+// Writes the challenge and the commitments of the unopened parties.
+static int fis_write_header_low_memory(lean_proof_t const* lean, fis_write_callback_t write,
+                                       void* opaque) {
+  const unsigned int num_rounds = lean->num_rounds;
+
+  unsigned char ch[(num_rounds + 3) / 4];
+  memset(ch, 0, sizeof(ch));
+  for (unsigned int i = 0; i < num_rounds; ++i) {
+    ch[i / 4] |= lean->ch[i] << ((i % 4) << 1);
+  }
+  if (write(opaque, ch, sizeof(ch))) {
+    return -1;
+  }
+  for (unsigned int i = 0; i < num_rounds; ++i) {
+    if (write(opaque, lean->hashes[i][(lean->ch[i] + 2) % 3], COMMITMENT_LENGTH)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int fis_sign_write_low_memory(public_parameters_t* pp, fis_private_key_t* private_key,
+                              const uint8_t* msg, size_t msglen, fis_write_callback_t write,
+                              void* opaque) {
+  mpc_lowmc_t const* lowmc     = pp->lowmc;
+  const unsigned int num_rounds = pp->num_rounds;
+
+  lean_proof_t* lean = lean_proof_init(num_rounds);
+  mzd_t* p           = mzd_local_init(1, lowmc->n);
+  int res            = -1;
+  if (!lean || !p || !fis_commit_low_memory(lowmc, private_key, p, msg, msglen, lean)) {
+    goto out;
+  }
+
+  if (fis_write_header_low_memory(lean, write, opaque)) {
+    goto out;
+  }
+
+  // the repetitions are recomputed and written one at a time, so only the
+  // views of a single repetition are alive
+  prove_scratch_t scratch;
+  const bool scratch_ok = prove_scratch_init(lowmc, &scratch);
+  unsigned char* buffer = malloc(fis_repetition_size(lowmc, 1));
+
+  res = scratch_ok && buffer ? 0 : -1;
+  for (unsigned int i = 0; i < num_rounds && !res; ++i) {
+    const unsigned int a = lean->ch[i];
+    const unsigned int b = (a + 1) % 3;
+
+    view_t opened;
+    fis_open_low_memory(lowmc, private_key, p, lean, i, &scratch, &opened);
+
+    unsigned char* temp = buffer;
+    memcpy(temp, lean->r[i][a], COMMITMENT_RAND_LENGTH);
+    temp += COMMITMENT_RAND_LENGTH;
+    memcpy(temp, lean->r[i][b], COMMITMENT_RAND_LENGTH);
+    temp += COMMITMENT_RAND_LENGTH;
+    memcpy(temp, lean->keys[i][a], PRNG_KEYSIZE);
+    temp += PRNG_KEYSIZE;
+    memcpy(temp, lean->keys[i][b], PRNG_KEYSIZE);
+    temp += PRNG_KEYSIZE;
+    temp += views_to_char_array(lowmc, temp, &opened, a);
+
+    res = write(opaque, buffer, temp - buffer);
+  }
+
+  free(buffer);
+  prove_scratch_clear(&scratch);
+
+out:
+  free(lean);
+  mzd_local_free(p);
+  mzd_pool_reset();
+  return res;
+}
+
+// prefix of the digest signed in pre-hash mode (see also HASH_PREFIX_BATCH)
+#define HASH_PREFIX_PREHASH 8
+
+static void fis_prehash_init(SHA256_CTX* ctx) {
+  const unsigned char prefix = HASH_PREFIX_PREHASH;
+  SHA256_Init(ctx);
+  SHA256_Update(ctx, &prefix, sizeof(prefix));
+}
+
+// The signed message is tagged so that it cannot be confused with a message
+// signed with fis_sign.
+static void fis_prehash_final(SHA256_CTX* ctx, unsigned char dst[FIS_PREHASH_SIZE]) {
+  dst[0] = HASH_PREFIX_PREHASH;
+  SHA256_Final(dst + 1, ctx);
+}
+
+void fis_prehash(const uint8_t* msg, size_t msglen, unsigned char dst[FIS_PREHASH_SIZE]) {
+  SHA256_CTX ctx;
+  fis_prehash_init(&ctx);
+  SHA256_Update(&ctx, msg, msglen);
+  fis_prehash_final(&ctx, dst);
+}
+
+struct fis_signer_s {
+  mpc_lowmc_t const* lowmc;
+  fis_private_key_t const* private_key;
+  // views of all parties, completed in fis_sign_final
+  proof_t* proof;
+  lean_proof_t* lean;
+  SHA256_CTX ctx;
+
+  // in pre-hash mode the message is hashed into msg_ctx while the MPC runs on
+  // the worker thread
+  bool prehash;
+  bool worker_started;
+  pthread_t worker;
+  SHA256_CTX msg_ctx;
+};
+
+// Runs the message-independent part of the prover.
+static void* fis_signer_commit(void* arg) {
+  fis_signer_t* signer = arg;
+  mzd_t* p             = mzd_local_init(1, signer->lowmc->n);
+  if (p) {
+    signer->proof = fis_prove_commit(signer->lowmc, signer->private_key, p, signer->lean);
+  }
+  mzd_local_free(p);
+  mzd_pool_reset();
+  return NULL;
+}
+
+static fis_signer_t* fis_signer_init(public_parameters_t* pp, fis_private_key_t* private_key) {
+  fis_signer_t* signer = calloc(1, sizeof(fis_signer_t));
+  lean_proof_t* lean   = lean_proof_init(pp->num_rounds);
+  if (!signer || !lean) {
+    free(lean);
+    free(signer);
+    return NULL;
+  }
+
+  signer->lowmc       = pp->lowmc;
+  signer->private_key = private_key;
+  signer->lean        = lean;
+  return signer;
+}
+
+// Waits for the MPC of a signer in pre-hash mode.
+static void fis_signer_join(fis_signer_t* signer) {
+  if (signer->worker_started) {
+    pthread_join(signer->worker, NULL);
+    signer->worker_started = false;
+  }
+}
+
+fis_signer_t* fis_sign_init(public_parameters_t* pp, fis_private_key_t* private_key) {
+  fis_signer_t* signer = fis_signer_init(pp, private_key);
+  if (!signer) {
+    return NULL;
+  }
+
+  fis_signer_commit(signer);
+  if (!signer->proof) {
+    fis_signer_free(signer);
+    return NULL;
+  }
+
+  fis_H3_init(&signer->ctx, signer->lean->hashes, signer->lean->num_rounds);
+  return signer;
+}
+
+fis_signer_t* fis_sign_init_prehash(public_parameters_t* pp, fis_private_key_t* private_key) {
+  fis_signer_t* signer = fis_signer_init(pp, private_key);
+  if (!signer) {
+    return NULL;
+  }
+
+  signer->prehash = true;
+  fis_prehash_init(&signer->msg_ctx);
+  // if no thread can be started, the MPC runs before the message is hashed
+  signer->worker_started = !pthread_create(&signer->worker, NULL, fis_signer_commit, signer);
+  if (!signer->worker_started) {
+    fis_signer_commit(signer);
+    if (!signer->proof) {
+      fis_signer_free(signer);
+      return NULL;
+    }
+  }
+  return signer;
+}
+
+void fis_sign_update(fis_signer_t* signer, const uint8_t* msg, size_t msglen) {
+  if (signer->prehash) {
+    SHA256_Update(&signer->msg_ctx, msg, msglen);
+  } else {
+    fis_H3_update(&signer->ctx, msg, msglen);
+  }
+}
+
+fis_signature_t* fis_sign_final(fis_signer_t* signer) {
+  fis_signer_join(signer);
+  lean_proof_t* lean   = signer->lean;
+  fis_signature_t* sig = signer->proof ? malloc(sizeof(fis_signature_t)) : NULL;
+  if (!sig) {
+    fis_signer_free(signer);
+    return NULL;
+  }
+
+  if (signer->prehash) {
+    unsigned char digest[FIS_PREHASH_SIZE];
+    fis_prehash_final(&signer->msg_ctx, digest);
+    fis_H3(lean->hashes, lean->num_rounds, digest, sizeof(digest), lean->ch);
+  } else {
+    fis_H3_final(&signer->ctx, lean->num_rounds, NULL, 0, lean->ch);
+  }
+  sig->proof =
+      create_proof(signer->proof, signer->lowmc, lean->hashes, lean->ch, lean->r, lean->keys);
+
+  free(lean);
+  free(signer);
+  return sig;
+}
+
+void fis_signer_free(fis_signer_t* signer) {
+  if (!signer) {
+    return;
+  }
+
+  fis_signer_join(signer);
+  if (signer->proof) {
+    free_proof(signer->lowmc, signer->proof);
+  }
+  free(signer->lean);
+  free(signer);
+  mzd_pool_reset();
+}
+
 int fis_verify(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
                size_t msglen, fis_signature_t* sig) {
+  if (sig->proof->num_rounds != pp->num_rounds) {
+    return -1;
+  }
+
   mzd_t* p = mzd_local_init(1, pp->lowmc->n);
   int res  = fis_proof_verify(pp->lowmc, p, public_key->pk, sig->proof, msg, msglen);
   mzd_local_free(p);
+  mzd_pool_reset();
+  return res;
+}
+
+int fis_verify_bytes(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
+                     size_t msglen, const unsigned char* sig, unsigned siglen) {
+  mzd_t* p = mzd_local_init(1, pp->lowmc->n);
+  int res  = fis_proof_verify_bytes(pp->lowmc, pp->num_rounds, p, public_key->pk, sig, siglen, msg,
+                                   msglen);
+  mzd_local_free(p);
+  mzd_pool_reset();
   return res;
 }
 
+int fis_verify_prehash(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
+                       size_t msglen, fis_signature_t* sig) {
+  unsigned char digest[FIS_PREHASH_SIZE];
+  fis_prehash(msg, msglen, digest);
+  return fis_verify(pp, public_key, digest, sizeof(digest), sig);
+}
+
 void fis_free_signature(public_parameters_t* pp, fis_signature_t* signature) {
   free_proof(pp->lowmc, signature->proof);
   free(signature);
+  mzd_pool_reset();
+}
+
+// prefix of the leaves of batches and of the message signed for a batch (see also the prefixes in
+// tree.c)
+#define HASH_PREFIX_BATCH 7
+
+struct fis_batch_s {
+  unsigned int num_messages;
+  unsigned char salt[KKW_SALT_SIZE];
+  tree_t* tree;
+  fis_signature_t* sig;
+};
+
+static void fis_batch_leaf(const unsigned char salt[KKW_SALT_SIZE], unsigned int index,
+                           const uint8_t* msg, size_t msglen, unsigned char* dst) {
+  const unsigned char prefix = HASH_PREFIX_BATCH;
+  unsigned char idx[sizeof(uint32_t)];
+  store_uint32_be(idx, index);
+
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  SHA256_Update(&ctx, &prefix, sizeof(prefix));
+  SHA256_Update(&ctx, salt, KKW_SALT_SIZE);
+  SHA256_Update(&ctx, idx, sizeof(idx));
+  SHA256_Update(&ctx, msg, msglen);
+  SHA256_Final(dst, &ctx);
+}
+
+// The message signed for a batch is tagged so that it cannot be confused with a message signed
+// with fis_sign.
+static void fis_batch_root(unsigned int num_messages, unsigned char const* root,
+                           unsigned char dst[FIS_BATCH_ROOT_SIZE]) {
+  dst[0] = HASH_PREFIX_BATCH;
+  store_uint32_be(dst + 1, num_messages);
+  memcpy(dst + 1 + sizeof(uint32_t), root, SHA256_DIGEST_LENGTH);
+}
+
+fis_batch_t* fis_sign_batch(public_parameters_t* pp, fis_private_key_t* private_key,
+                            const uint8_t* const* msgs, const size_t* msglens,
+                            unsigned int num_messages) {
+  if (!num_messages) {
+    return NULL;
+  }
+
+  fis_batch_t* batch = calloc(1, sizeof(fis_batch_t));
+  if (!batch) {
+    return NULL;
+  }
+  batch->num_messages = num_messages;
+  batch->tree         = tree_init(num_messages, SHA256_DIGEST_LENGTH);
+  if (!batch->tree || rand_bytes(batch->salt, sizeof(batch->salt)) != 1) {
+    fis_free_batch(pp, batch);
+    return NULL;
+  }
+
+#pragma omp parallel for
+  for (unsigned int i = 0; i < num_messages; ++i) {
+    fis_batch_leaf(batch->salt, i, msgs[i], msglens[i], tree_leaf(batch->tree, i));
+  }
+  merkle_tree_build(batch->tree, batch->salt);
+
+  unsigned char root[FIS_BATCH_ROOT_SIZE];
+  fis_batch_root(num_messages, tree_root(batch->tree), root);
+  batch->sig = fis_sign(pp, private_key, root, sizeof(root));
+  if (!batch->sig) {
+    fis_free_batch(pp, batch);
+    return NULL;
+  }
+  return batch;
+}
+
+fis_signature_t const* fis_batch_signature(fis_batch_t const* batch) {
+  return batch->sig;
+}
+
+unsigned fis_batch_path_max_size(unsigned int num_messages) {
+  return KKW_SALT_SIZE + tree_max_cover_size(num_messages, 1) * SHA256_DIGEST_LENGTH;
+}
+
+unsigned fis_batch_path(fis_batch_t const* batch, unsigned int index, unsigned char* dst) {
+  if (index >= batch->num_messages) {
+    return 0;
+  }
+
+  memcpy(dst, batch->salt, KKW_SALT_SIZE);
+  return KKW_SALT_SIZE + merkle_tree_open_leaf(batch->tree, index, dst + KKW_SALT_SIZE);
+}
+
+void fis_free_batch(public_parameters_t* pp, fis_batch_t* batch) {
+  if (batch) {
+    if (batch->sig) {
+      fis_free_signature(pp, batch->sig);
+    }
+    tree_free(batch->tree);
+    free(batch);
+  }
+}
+
+// Binds cache entries to the public key and the parameters they were verified
+// with.
+static void fis_batch_key_digest(public_parameters_t const* pp, fis_public_key_t const* public_key,
+                                 unsigned char dst[SHA256_DIGEST_LENGTH]) {
+  const uint32_t params[5] = {pp->num_rounds, pp->lowmc->m, pp->lowmc->n, pp->lowmc->r,
+                              pp->lowmc->k};
+  mzd_t const* pk          = public_key->pk;
+
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  SHA256_Update(&ctx, params, sizeof(params));
+  SHA256_Update(&ctx, CONST_FIRST_ROW(pk), pk->width * sizeof(word));
+  SHA256_Final(dst, &ctx);
+}
+
+int fis_verify_batch_member(public_parameters_t* pp, fis_public_key_t* public_key,
+                            const uint8_t* msg, size_t msglen, unsigned int index,
+                            unsigned int num_messages, const unsigned char* path,
+                            unsigned pathlen, const unsigned char* sig, unsigned siglen,
+                            fis_batch_cache_t* cache) {
+  // path holds the salt followed by the nodes; its size is fixed by the shape
+  // of the tree and is checked before any node is read
+  if (index >= num_messages ||
+      pathlen != KKW_SALT_SIZE + merkle_tree_leaf_path_size(num_messages, index)) {
+    return -1;
+  }
+
+  unsigned char leaf[SHA256_DIGEST_LENGTH], digest[SHA256_DIGEST_LENGTH];
+  fis_batch_leaf(path, index, msg, msglen, leaf);
+  merkle_tree_verify_leaf(num_messages, index, leaf, path + KKW_SALT_SIZE, path, digest);
+
+  unsigned char root[FIS_BATCH_ROOT_SIZE];
+  fis_batch_root(num_messages, digest, root);
+
+  unsigned char sig_digest[SHA256_DIGEST_LENGTH], key_digest[SHA256_DIGEST_LENGTH];
+  if (cache) {
+    SHA256(sig, siglen, sig_digest);
+    fis_batch_key_digest(pp, public_key, key_digest);
+    if (cache->valid && !memcmp(cache->key_digest, key_digest, sizeof(key_digest)) &&
+        !memcmp(cache->root, root, sizeof(root)) &&
+        !memcmp(cache->sig_digest, sig_digest, sizeof(sig_digest))) {
+      return 0;
+    }
+  }
+
+  const int res = fis_verify_bytes(pp, public_key, root, sizeof(root), sig, siglen);
+  if (!res && cache) {
+    memcpy(cache->key_digest, key_digest, sizeof(key_digest));
+    memcpy(cache->root, root, sizeof(root));
+    memcpy(cache->sig_digest, sig_digest, sizeof(sig_digest));
+    cache->valid = true;
+  }
+  return res;
 }
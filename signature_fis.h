@@ -8,11 +8,35 @@ typedef struct {
   mzd_t* pk;
 } fis_public_key_t;
 
-typedef struct { lowmc_key_t* k; } fis_private_key_t;
+typedef struct {
+  lowmc_key_t* k;
+  // the expanded key of k, see lowmc_expand_key
+  mzd_t** round_keys;
+} fis_private_key_t;
 
 typedef struct { proof_t* proof; } fis_signature_t;
 
-unsigned fis_compute_sig_size(unsigned m, unsigned n, unsigned r, unsigned k);
+/**
+ * Size of the largest signature for the given parameters, i.e. of a signature
+ * where every repetition carries the key share of the third party. Matches
+ * fis_sig_max_size.
+ */
+unsigned fis_compute_sig_size(unsigned m, unsigned n, unsigned r, unsigned k,
+                              unsigned num_rounds);
+
+/**
+ * Upper bound of the size of a serialized signature, i.e. the size of a buffer
+ * that can hold any signature for the given parameters.
+ */
+unsigned fis_sig_max_size(public_parameters_t const* pp);
+
+/**
+ * Serializes a signature directly into buf.
+ *
+ * \return the number of bytes written or 0 if buflen is too small
+ */
+unsigned fis_sig_serialize(public_parameters_t const* pp, fis_signature_t const* sig,
+                           unsigned char* buf, unsigned buflen);
 
 unsigned char* fis_sig_to_char_array(public_parameters_t* pp, fis_signature_t* sig, unsigned* len);
 
@@ -23,12 +47,267 @@ bool fis_create_key(public_parameters_t* pp, fis_private_key_t* private_key,
 
 void fis_destroy_key(fis_private_key_t* private_key, fis_public_key_t* public_key);
 
+/**
+ * Sizes of the serialized keys: the private key only stores the k key bits,
+ * the public key the n bits of E_k(0). Keys can only be serialized if k and n
+ * are multiples of 8.
+ */
+unsigned fis_private_key_size(public_parameters_t const* pp);
+unsigned fis_public_key_size(public_parameters_t const* pp);
+
+/**
+ * \return the number of bytes written or 0 if buflen is too small
+ */
+unsigned fis_private_key_serialize(public_parameters_t const* pp,
+                                   fis_private_key_t const* private_key, unsigned char* buf,
+                                   unsigned buflen);
+unsigned fis_public_key_serialize(public_parameters_t const* pp,
+                                  fis_public_key_t const* public_key, unsigned char* buf,
+                                  unsigned buflen);
+
+/**
+ * Deserializes a key, len has to be the exact size of the key. The key is
+ * freed with fis_destroy_key.
+ */
+bool fis_private_key_deserialize(public_parameters_t const* pp, fis_private_key_t* private_key,
+                                 const unsigned char* buf, unsigned len);
+bool fis_public_key_deserialize(public_parameters_t const* pp, fis_public_key_t* public_key,
+                                const unsigned char* buf, unsigned len);
+
+/**
+ * Key pairs stored in a few contiguous allocations. The keys must not be passed
+ * to fis_destroy_key, the store is freed as a whole with fis_free_key_store.
+ */
+typedef struct {
+  unsigned int num_keys;
+  fis_private_key_t* private_keys;
+  fis_public_key_t* public_keys;
+
+  // storage of the vectors of all keys
+  mzd_t** keys;
+  mzd_t** round_keys;
+  mzd_t** pks;
+} fis_key_store_t;
+
+/**
+ * Generates num_keys key pairs. The key material is drawn at once and the
+ * public keys are computed with lowmc_encrypt_batch_round_keys.
+ */
+fis_key_store_t* fis_create_keys_batch(public_parameters_t const* pp, unsigned int num_keys);
+
+/**
+ * Size of a serialized key store: the key count as big-endian 32 bit integer
+ * followed by the serialized private and public key of each pair.
+ */
+unsigned fis_key_store_size(public_parameters_t const* pp, unsigned int num_keys);
+
+/**
+ * \return the number of bytes written or 0 if buflen is too small
+ */
+unsigned fis_key_store_serialize(public_parameters_t const* pp, fis_key_store_t const* store,
+                                 unsigned char* buf, unsigned buflen);
+
+/**
+ * Deserializes a key store, len has to be its exact size.
+ */
+fis_key_store_t* fis_key_store_deserialize(public_parameters_t const* pp,
+                                           const unsigned char* buf, unsigned len);
+
+void fis_free_key_store(fis_key_store_t* store);
+
 fis_signature_t* fis_sign(public_parameters_t* pp, fis_private_key_t* private_key,
                           const uint8_t* msg, size_t msglen);
 
+/**
+ * Writes len bytes from data, returns 0 on success.
+ */
+typedef int (*fis_write_callback_t)(void* opaque, const unsigned char* data, size_t len);
+
+/**
+ * Signs a message and writes the signature in the format of fis_sig_serialize
+ * with the given callback, without materializing it in memory.
+ *
+ * \return 0 on success and a value != 0 otherwise
+ */
+int fis_sign_write(public_parameters_t* pp, fis_private_key_t* private_key, const uint8_t* msg,
+                   size_t msglen, fis_write_callback_t write, void* opaque);
+
+/**
+ * Low-memory variants of fis_sign and fis_sign_write. The MPC is run twice:
+ * the first pass only computes the commitments and the challenge, the second
+ * one recomputes the views of the opened parties from the seeds. This roughly
+ * doubles the signing time, but the views of all parties of all repetitions
+ * are never held at the same time. fis_sign_write_low_memory only keeps the
+ * views of a single repetition.
+ */
+fis_signature_t* fis_sign_low_memory(public_parameters_t* pp, fis_private_key_t* private_key,
+                                     const uint8_t* msg, size_t msglen);
+
+int fis_sign_write_low_memory(public_parameters_t* pp, fis_private_key_t* private_key,
+                              const uint8_t* msg, size_t msglen, fis_write_callback_t write,
+                              void* opaque);
+
+/**
+ * Incremental signing of a message that is passed in parts. The MPC does not
+ * depend on the message: fis_sign_init runs it and commits to the views, so it
+ * can be called before the message is available. fis_sign_update only hashes
+ * the parts of the message and fis_sign_final derives the challenge and opens
+ * the views. The signature is the same as the one of fis_sign on the
+ * concatenation of all parts.
+ */
+typedef struct fis_signer_s fis_signer_t;
+
+fis_signer_t* fis_sign_init(public_parameters_t* pp, fis_private_key_t* private_key);
+
+// Size of the message signed in pre-hash mode: a tag byte and the digest
+#define FIS_PREHASH_SIZE (1 + SHA256_DIGEST_LENGTH)
+
+/**
+ * Pre-hash mode: the signature is made on the tagged SHA-256 digest of the
+ * message computed by fis_prehash. The MPC runs on a worker thread while
+ * fis_sign_update hashes the message on the calling thread, and
+ * fis_sign_final waits for it. The private key has to stay valid until then.
+ * Such signatures verify with fis_verify_prehash, or with the other verifiers
+ * on the output of fis_prehash.
+ */
+fis_signer_t* fis_sign_init_prehash(public_parameters_t* pp, fis_private_key_t* private_key);
+
+void fis_prehash(const uint8_t* msg, size_t msglen, unsigned char dst[FIS_PREHASH_SIZE]);
+
+void fis_sign_update(fis_signer_t* signer, const uint8_t* msg, size_t msglen);
+
+/**
+ * Finishes the signature and frees the signer.
+ */
+fis_signature_t* fis_sign_final(fis_signer_t* signer);
+
+/**
+ * Frees a signer without finishing the signature.
+ */
+void fis_signer_free(fis_signer_t* signer);
+
 int fis_verify(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
                size_t msglen, fis_signature_t* sig);
 
+int fis_verify_prehash(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
+                       size_t msglen, fis_signature_t* sig);
+
+/**
+ * Verifies a signature serialized with fis_sig_serialize without
+ * deserializing it first. siglen has to be the exact size of the signature.
+ *
+ * \return 0 on success and a value != 0 otherwise
+ */
+int fis_verify_bytes(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
+                     size_t msglen, const unsigned char* sig, unsigned siglen);
+
+/**
+ * Incremental verification of a serialized signature. The signature is passed
+ * in chunks of arbitrary size to fis_verifier_update, repetitions are verified
+ * as soon as they are complete. Memory usage is independent of the size of
+ * the signature.
+ */
+typedef struct fis_verifier_s fis_verifier_t;
+
+/**
+ * \return the verifier or NULL if an allocation failed
+ */
+fis_verifier_t* fis_verifier_init(public_parameters_t* pp, fis_public_key_t* public_key);
+
+/**
+ * \return 0 if the signature is still well-formed and a value != 0 otherwise
+ */
+int fis_verifier_update(fis_verifier_t* verifier, const unsigned char* data, size_t len);
+
+/**
+ * Absorbs a part of the message. The message is hashed after the signature, so
+ * the signature has to be passed completely before. The remaining part of the
+ * message is passed to fis_verifier_final.
+ *
+ * \return 0 on success and a value != 0 otherwise
+ */
+int fis_verifier_update_message(fis_verifier_t* verifier, const uint8_t* msg, size_t msglen);
+
+/**
+ * Finishes the verification and frees the verifier.
+ *
+ * \return 0 on success and a value != 0 otherwise
+ */
+int fis_verifier_final(fis_verifier_t* verifier, const uint8_t* msg, size_t msglen);
+
+/**
+ * Reads up to len bytes into buf, returns 0 at the end of the signature or on
+ * error.
+ */
+typedef size_t (*fis_read_callback_t)(void* opaque, unsigned char* buf, size_t len);
+
+/**
+ * Verifies a signature read incrementally with the given callback.
+ */
+int fis_verify_read(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
+                    size_t msglen, fis_read_callback_t read, void* opaque);
+
 void fis_free_signature(public_parameters_t* pp, fis_signature_t* signature);
 
+/**
+ * Batch signing: a single signature on the root of a Merkle tree over the
+ * digests of many messages authenticates each of them together with its
+ * authentication path.
+ */
+typedef struct fis_batch_s fis_batch_t;
+
+// Size of the message signed for a batch: a tag byte, the message count and the root
+#define FIS_BATCH_ROOT_SIZE (1 + sizeof(uint32_t) + SHA256_DIGEST_LENGTH)
+
+fis_batch_t* fis_sign_batch(public_parameters_t* pp, fis_private_key_t* private_key,
+                            const uint8_t* const* msgs, const size_t* msglens,
+                            unsigned int num_messages);
+
+/**
+ * The signature shared by all messages of the batch.
+ */
+fis_signature_t const* fis_batch_signature(fis_batch_t const* batch);
+
+/**
+ * Upper bound of the size of an authentication path in a batch of
+ * num_messages messages.
+ */
+unsigned fis_batch_path_max_size(unsigned int num_messages);
+
+/**
+ * Writes the authentication path of message index.
+ *
+ * \return the number of bytes written or 0 if index is out of range
+ */
+unsigned fis_batch_path(fis_batch_t const* batch, unsigned int index, unsigned char* dst);
+
+void fis_free_batch(public_parameters_t* pp, fis_batch_t* batch);
+
+/**
+ * Remembers the last root signature that was verified successfully, so that
+ * the other messages of a batch only need to check their authentication
+ * paths. Entries only match for the public key and parameters they were
+ * verified with.
+ */
+typedef struct {
+  bool valid;
+  // digest of the public key and the parameters
+  unsigned char key_digest[SHA256_DIGEST_LENGTH];
+  unsigned char root[FIS_BATCH_ROOT_SIZE];
+  // digest of the serialized signature
+  unsigned char sig_digest[SHA256_DIGEST_LENGTH];
+} fis_batch_cache_t;
+
+/**
+ * Verifies message index of a batch of num_messages messages given its
+ * authentication path and the serialized shared signature. cache may be NULL.
+ *
+ * \return 0 on success and a value != 0 otherwise
+ */
+int fis_verify_batch_member(public_parameters_t* pp, fis_public_key_t* public_key,
+                            const uint8_t* msg, size_t msglen, unsigned int index,
+                            unsigned int num_messages, const unsigned char* path,
+                            unsigned pathlen, const unsigned char* sig, unsigned siglen,
+                            fis_batch_cache_t* cache);
+
 #endif
@@ -0,0 +1,503 @@
+#include "signature_kkw.h"
+#include "block.h"
+#include "io.h"
+#include "lowmc.h"
+#include "mpc_lowmc_kkw.h"
+#include "mzd_pool.h"
+#include "randomness.h"
+#include "tree.h"
+
+#include <openssl/sha.h>
+#include <stdlib.h>
+#include <string.h>
+
+// prefixes of the hashes (see also the prefixes in tree.c)
+#define HASH_PREFIX_COMMITMENT 2
+#define HASH_PREFIX_INSTANCE 3
+#define HASH_PREFIX_ONLINE 4
+#define HASH_PREFIX_CHALLENGE 5
+#define HASH_PREFIX_EXPAND 6
+
+#define DIGEST_SIZE SHA256_DIGEST_LENGTH
+
+// parameter sets for 128, 192 and 256 bits of soundness
+static const kkw_parameters_t kkw_parameter_sets[] = {
+    {16, 343, 27}, {16, 570, 39}, {16, 803, 50},
+};
+
+void kkw_default_parameters(public_parameters_t const* pp, kkw_parameters_t* kp) {
+  // soundness of the repetitions, i.e. num_rounds * log2(3 / 2)
+  const unsigned int soundness = pp->num_rounds * 585 / 1000;
+  *kp = kkw_parameter_sets[soundness <= 128 ? 0 : (soundness <= 192 ? 1 : 2)];
+}
+
+static unsigned kkw_sbox_bytes(lowmc_t const* lowmc) {
+  return (3 * lowmc->m + 7) / 8;
+}
+
+// Size of an instance with checked online phase without the seeds of the
+// parties: aux, masked key, messages of the hidden party and its commitment.
+static unsigned kkw_online_size(lowmc_t const* lowmc, bool with_aux) {
+  return (with_aux ? 2 : 1) * lowmc->r * kkw_sbox_bytes(lowmc) + lowmc->k / 8 + DIGEST_SIZE;
+}
+
+unsigned kkw_sig_max_size(public_parameters_t const* pp, kkw_parameters_t const* kp) {
+  const unsigned int cover       = tree_max_cover_size(kp->num_instances, kp->num_opened);
+  const unsigned int party_cover = tree_max_cover_size(kp->num_parties, 1);
+
+  return DIGEST_SIZE + KKW_SALT_SIZE + cover * (KKW_SEED_SIZE + DIGEST_SIZE) +
+         kp->num_opened * (party_cover * KKW_SEED_SIZE + kkw_online_size(pp->lowmc, true));
+}
+
+static void hash_index(SHA256_CTX* ctx, unsigned int index) {
+  const uint32_t value = index;
+  SHA256_Update(ctx, &value, sizeof(value));
+}
+
+static void hash_prefix(SHA256_CTX* ctx, unsigned char prefix) {
+  SHA256_Init(ctx);
+  SHA256_Update(ctx, &prefix, sizeof(prefix));
+}
+
+// Hashes the first bytes of the rows of A.
+static void hash_rows(SHA256_CTX* ctx, mzd_t const* A, unsigned int first, unsigned int count,
+                      unsigned int bytes) {
+  unsigned char buffer[BLOCK_MAX_BITS / 8];
+  for (unsigned int i = first; i < first + count; ++i) {
+    mzd_row_to_char_array(buffer, CONST_ROW(A, i), bytes, A->ncols);
+    SHA256_Update(ctx, buffer, bytes);
+  }
+}
+
+static unsigned char* write_rows(unsigned char* dst, mzd_t const* A, unsigned int count,
+                                 unsigned int bytes) {
+  for (unsigned int i = 0; i < count; ++i, dst += bytes) {
+    mzd_row_to_char_array(dst, CONST_ROW(A, i), bytes, A->ncols);
+  }
+  return dst;
+}
+
+// Reads rows of S-box bytes into A and rejects bits outside of the S-boxes.
+static bool read_rows(lowmc_t const* lowmc, mzd_t* A, unsigned int count,
+                      unsigned char const* src) {
+  const unsigned int bytes = kkw_sbox_bytes(lowmc);
+  word const* mask         = CONST_FIRST_ROW(lowmc->mask.mask);
+
+  bool valid = true;
+  for (unsigned int i = 0; i < count; ++i, src += bytes) {
+    word* row = ROW(A, i);
+    memset(row, 0, A->width * sizeof(word));
+    mzd_row_from_char_array(row, src, bytes, A->ncols);
+    for (wi_t w = 0; w < A->width; ++w) {
+      valid &= !(row[w] & mask[w]);
+    }
+  }
+  return valid;
+}
+
+// Commitment of party q of instance j. The last party also commits to the
+// aux.
+static void kkw_commit_party(lowmc_t const* lowmc, const unsigned char salt[KKW_SALT_SIZE],
+                             unsigned int j, unsigned int q, const unsigned char* seed,
+                             mzd_t const* aux, unsigned char* dst) {
+  SHA256_CTX ctx;
+  hash_prefix(&ctx, HASH_PREFIX_COMMITMENT);
+  SHA256_Update(&ctx, seed, KKW_SEED_SIZE);
+  if (aux) {
+    hash_rows(&ctx, aux, 0, lowmc->r, kkw_sbox_bytes(lowmc));
+  }
+  SHA256_Update(&ctx, salt, KKW_SALT_SIZE);
+  hash_index(&ctx, j);
+  hash_index(&ctx, q);
+  SHA256_Final(dst, &ctx);
+}
+
+// Hashes the commitments of all parties of instance j. The commitment of the
+// hidden party is given, all others are computed from the seeds.
+static void kkw_hash_instance(lowmc_t const* lowmc, const unsigned char salt[KKW_SALT_SIZE],
+                              unsigned int j, kkw_transcript_t const* transcript,
+                              tree_t const* seeds, unsigned int hidden,
+                              const unsigned char* commitment, unsigned char* dst) {
+  const unsigned int last = transcript->num_parties - 1;
+
+  SHA256_CTX ctx;
+  hash_prefix(&ctx, HASH_PREFIX_INSTANCE);
+  for (unsigned int q = 0; q < transcript->num_parties; ++q) {
+    if (q == hidden) {
+      SHA256_Update(&ctx, commitment, DIGEST_SIZE);
+    } else {
+      unsigned char digest[DIGEST_SIZE];
+      kkw_commit_party(lowmc, salt, j, q, tree_leaf(seeds, q), q == last ? transcript->aux : NULL,
+                       digest);
+      SHA256_Update(&ctx, digest, DIGEST_SIZE);
+    }
+  }
+  SHA256_Final(dst, &ctx);
+}
+
+// Hashes the masked key and the messages and output mask shares of all
+// parties of instance j.
+static void kkw_hash_online(lowmc_t const* lowmc, const unsigned char salt[KKW_SALT_SIZE],
+                            unsigned int j, kkw_transcript_t const* transcript,
+                            unsigned char* dst) {
+  SHA256_CTX ctx;
+  hash_prefix(&ctx, HASH_PREFIX_ONLINE);
+  hash_rows(&ctx, transcript->masked_key, 0, 1, lowmc->k / 8);
+  for (unsigned int q = 0; q < transcript->num_parties; ++q) {
+    hash_rows(&ctx, transcript->msgs[q], 0, lowmc->r, kkw_sbox_bytes(lowmc));
+    hash_rows(&ctx, transcript->msgs[q], lowmc->r, 1, lowmc->n / 8);
+  }
+  SHA256_Update(&ctx, salt, KKW_SALT_SIZE);
+  hash_index(&ctx, j);
+  SHA256_Final(dst, &ctx);
+}
+
+static void kkw_challenge(lowmc_t const* lowmc, kkw_parameters_t const* kp,
+                          unsigned char const (*h)[DIGEST_SIZE], tree_t const* merkle,
+                          const unsigned char salt[KKW_SALT_SIZE], mzd_t const* c,
+                          const uint8_t* msg, size_t msglen, unsigned char* ch) {
+  SHA256_CTX ctx;
+  hash_prefix(&ctx, HASH_PREFIX_CHALLENGE);
+  SHA256_Update(&ctx, h, kp->num_instances * DIGEST_SIZE);
+  SHA256_Update(&ctx, tree_root(merkle), DIGEST_SIZE);
+  SHA256_Update(&ctx, salt, KKW_SALT_SIZE);
+  hash_rows(&ctx, c, 0, 1, lowmc->n / 8);
+  SHA256_Update(&ctx, msg, msglen);
+  SHA256_Final(ch, &ctx);
+}
+
+typedef struct {
+  unsigned char const* ch;
+  unsigned char buffer[DIGEST_SIZE];
+  unsigned int counter;
+  unsigned int pos;
+} challenge_stream_t;
+
+// Reads a uniform value below bound by rejection sampling.
+static unsigned int challenge_stream_next(challenge_stream_t* stream, unsigned int bound) {
+  unsigned int bits = 0;
+  while ((1u << bits) < bound) {
+    ++bits;
+  }
+
+  for (;;) {
+    if (stream->pos == DIGEST_SIZE) {
+      SHA256_CTX ctx;
+      hash_prefix(&ctx, HASH_PREFIX_EXPAND);
+      SHA256_Update(&ctx, stream->ch, DIGEST_SIZE);
+      hash_index(&ctx, stream->counter++);
+      SHA256_Final(stream->buffer, &ctx);
+      stream->pos = 0;
+    }
+
+    const unsigned int value = stream->buffer[stream->pos] | (stream->buffer[stream->pos + 1] << 8);
+    stream->pos += 2;
+    if ((value & ((1u << bits) - 1)) < bound) {
+      return value & ((1u << bits) - 1);
+    }
+  }
+}
+
+// Derives the instances whose online phase is checked and their hidden
+// parties from the challenge.
+static void kkw_expand_challenge(kkw_parameters_t const* kp, unsigned char const* ch,
+                                 bool* opened, unsigned int* hidden) {
+  challenge_stream_t stream = {.ch = ch, .pos = DIGEST_SIZE};
+
+  memset(opened, 0, kp->num_instances * sizeof(bool));
+  for (unsigned int count = 0; count < kp->num_opened;) {
+    const unsigned int j = challenge_stream_next(&stream, kp->num_instances);
+    if (!opened[j]) {
+      opened[j] = true;
+      ++count;
+    }
+  }
+  for (unsigned int j = 0; j < kp->num_instances; ++j) {
+    hidden[j] = opened[j] ? challenge_stream_next(&stream, kp->num_parties) : kp->num_parties;
+  }
+}
+
+// Size of instance j in the signature.
+static unsigned kkw_instance_size(lowmc_t const* lowmc, tree_t* seeds, unsigned int hidden) {
+  bool hidden_parties[seeds->num_leaves];
+  memset(hidden_parties, 0, sizeof(hidden_parties));
+  hidden_parties[hidden] = true;
+
+  return tree_cover_size(seeds, hidden_parties) * KKW_SEED_SIZE +
+         kkw_online_size(lowmc, hidden != seeds->num_leaves - 1);
+}
+
+// Per-thread scratch space of one instance.
+typedef struct {
+  kkw_transcript_t* transcript;
+  tree_t* seeds;
+} kkw_scratch_t;
+
+static bool kkw_scratch_init(lowmc_t const* lowmc, kkw_parameters_t const* kp,
+                             kkw_scratch_t* scratch) {
+  scratch->transcript = kkw_transcript_init(lowmc, kp->num_parties);
+  scratch->seeds      = tree_init(kp->num_parties, KKW_SEED_SIZE);
+  return scratch->transcript && scratch->seeds;
+}
+
+static void kkw_scratch_clear(kkw_scratch_t* scratch) {
+  tree_free(scratch->seeds);
+  kkw_transcript_free(scratch->transcript);
+}
+
+typedef const unsigned char (*kkw_seeds_t)[KKW_SEED_SIZE];
+
+// The seeds of the parties are the consecutive leaves of the seed tree.
+static kkw_seeds_t party_seeds(kkw_scratch_t const* scratch) {
+  return (kkw_seeds_t)tree_leaf(scratch->seeds, 0);
+}
+
+unsigned kkw_sign(public_parameters_t const* pp, kkw_parameters_t const* kp,
+                  fis_private_key_t const* private_key, const uint8_t* msg, size_t msglen,
+                  unsigned char* sig, unsigned siglen) {
+  lowmc_t const* lowmc             = pp->lowmc;
+  const unsigned int num_instances = kp->num_instances;
+  const unsigned int last          = kp->num_parties - 1;
+  const unsigned int sbox_bytes    = kkw_sbox_bytes(lowmc);
+
+  if (kp->num_parties > KKW_MAX_PARTIES || siglen < kkw_sig_max_size(pp, kp)) {
+    return 0;
+  }
+
+  bool opened[num_instances];
+  unsigned int hidden[num_instances];
+  unsigned char salt[KKW_SALT_SIZE];
+  unsigned char root[KKW_SEED_SIZE];
+  if (rand_bytes(salt, sizeof(salt)) != 1 || rand_bytes(root, sizeof(root)) != 1) {
+    return 0;
+  }
+
+  unsigned res                   = 0;
+  tree_t* instances              = tree_init(num_instances, KKW_SEED_SIZE);
+  tree_t* merkle                 = tree_init(num_instances, DIGEST_SIZE);
+  unsigned char(*h)[DIGEST_SIZE] = malloc(num_instances * DIGEST_SIZE);
+  unsigned* offsets              = malloc(num_instances * sizeof(unsigned));
+  mzd_t* p                       = mzd_local_init(1, lowmc->n);
+  mzd_t* c                       = p ? lowmc_call(lowmc, private_key->k, p) : NULL;
+  if (!instances || !merkle || !h || !offsets || !c) {
+    goto out;
+  }
+  seed_tree_expand(instances, root, salt, num_instances);
+
+  bool failed = false;
+#pragma omp parallel
+  {
+    kkw_scratch_t scratch;
+    if (!kkw_scratch_init(lowmc, kp, &scratch)) {
+#pragma omp atomic write
+      failed = true;
+    } else {
+#pragma omp for
+      for (unsigned int j = 0; j < num_instances; ++j) {
+        seed_tree_expand(scratch.seeds, tree_leaf(instances, j), salt, j);
+        mpc_lowmc_kkw_prove(lowmc, private_key->k, p, party_seeds(&scratch), scratch.transcript);
+        kkw_hash_instance(lowmc, salt, j, scratch.transcript, scratch.seeds, kp->num_parties,
+                          NULL, h[j]);
+        kkw_hash_online(lowmc, salt, j, scratch.transcript, tree_leaf(merkle, j));
+      }
+    }
+    kkw_scratch_clear(&scratch);
+  }
+  if (failed) {
+    goto out;
+  }
+  merkle_tree_build(merkle, salt);
+
+  unsigned char* ch = sig;
+  kkw_challenge(lowmc, kp, (unsigned char const(*)[DIGEST_SIZE])h, merkle, salt, c, msg, msglen,
+                ch);
+  kkw_expand_challenge(kp, ch, opened, hidden);
+
+  unsigned char* dst = sig + DIGEST_SIZE;
+  memcpy(dst, salt, KKW_SALT_SIZE);
+  dst += KKW_SALT_SIZE;
+  dst += seed_tree_reveal(instances, opened, dst);
+  dst += merkle_tree_open(merkle, opened, dst);
+
+  // the instances are written in ascending order
+  {
+    tree_t* seeds = tree_init(kp->num_parties, KKW_SEED_SIZE);
+    if (!seeds) {
+      goto out;
+    }
+    res = dst - sig;
+    for (unsigned int j = 0; j < num_instances; ++j) {
+      if (opened[j]) {
+        offsets[j] = res;
+        res += kkw_instance_size(lowmc, seeds, hidden[j]);
+      }
+    }
+    tree_free(seeds);
+  }
+
+#pragma omp parallel
+  {
+    kkw_scratch_t scratch;
+    if (!kkw_scratch_init(lowmc, kp, &scratch)) {
+#pragma omp atomic write
+      failed = true;
+    } else {
+#pragma omp for
+      for (unsigned int j = 0; j < num_instances; ++j) {
+        if (!opened[j]) {
+          continue;
+        }
+
+        const unsigned int q = hidden[j];
+        bool hidden_parties[KKW_MAX_PARTIES] = {false};
+        hidden_parties[q] = true;
+
+        seed_tree_expand(scratch.seeds, tree_leaf(instances, j), salt, j);
+        mpc_lowmc_kkw_prove(lowmc, private_key->k, p, party_seeds(&scratch), scratch.transcript);
+
+        unsigned char* instance = sig + offsets[j];
+        instance += seed_tree_reveal(scratch.seeds, hidden_parties, instance);
+        if (q != last) {
+          instance = write_rows(instance, scratch.transcript->aux, lowmc->r, sbox_bytes);
+        }
+        instance = write_rows(instance, scratch.transcript->masked_key, 1, lowmc->k / 8);
+        instance = write_rows(instance, scratch.transcript->msgs[q], lowmc->r, sbox_bytes);
+        kkw_commit_party(lowmc, salt, j, q, tree_leaf(scratch.seeds, q),
+                         q == last ? scratch.transcript->aux : NULL, instance);
+      }
+    }
+    kkw_scratch_clear(&scratch);
+  }
+  if (failed) {
+    res = 0;
+  }
+
+out:
+  mzd_local_free(c);
+  mzd_local_free(p);
+  free(offsets);
+  free(h);
+  tree_free(merkle);
+  tree_free(instances);
+  mzd_pool_reset();
+  return res;
+}
+
+int kkw_verify(public_parameters_t const* pp, kkw_parameters_t const* kp,
+               fis_public_key_t const* public_key, const uint8_t* msg, size_t msglen,
+               const unsigned char* sig, unsigned siglen) {
+  lowmc_t const* lowmc             = pp->lowmc;
+  const unsigned int num_instances = kp->num_instances;
+  const unsigned int last          = kp->num_parties - 1;
+  const unsigned int sbox_bytes    = kkw_sbox_bytes(lowmc);
+
+  if (kp->num_parties > KKW_MAX_PARTIES || siglen < DIGEST_SIZE + KKW_SALT_SIZE) {
+    return -1;
+  }
+
+  unsigned char const* ch   = sig;
+  unsigned char const* salt = sig + DIGEST_SIZE;
+
+  bool opened[num_instances];
+  unsigned int hidden[num_instances];
+  kkw_expand_challenge(kp, ch, opened, hidden);
+
+  int res                        = -1;
+  tree_t* instances              = tree_init(num_instances, KKW_SEED_SIZE);
+  tree_t* merkle                 = tree_init(num_instances, DIGEST_SIZE);
+  tree_t* seeds                  = tree_init(kp->num_parties, KKW_SEED_SIZE);
+  unsigned char(*h)[DIGEST_SIZE] = malloc(num_instances * DIGEST_SIZE);
+  unsigned* offsets              = malloc(num_instances * sizeof(unsigned));
+  mzd_t* p                       = mzd_local_init(1, lowmc->n);
+  if (!instances || !merkle || !seeds || !h || !offsets || !p) {
+    goto out;
+  }
+
+  // check the size before reading anything beyond salt
+  unsigned size                   = DIGEST_SIZE + KKW_SALT_SIZE;
+  const unsigned instances_offset = size;
+  size += tree_cover_size(instances, opened) * KKW_SEED_SIZE;
+  const unsigned merkle_offset = size;
+  size += tree_cover_size(merkle, opened) * DIGEST_SIZE;
+  for (unsigned int j = 0; j < num_instances; ++j) {
+    if (opened[j]) {
+      offsets[j] = size;
+      size += kkw_instance_size(lowmc, seeds, hidden[j]);
+    }
+  }
+  if (size != siglen) {
+    goto out;
+  }
+
+  seed_tree_reconstruct(instances, opened, sig + instances_offset, salt, num_instances);
+
+  bool failed = false;
+#pragma omp parallel
+  {
+    kkw_scratch_t scratch;
+    if (!kkw_scratch_init(lowmc, kp, &scratch)) {
+#pragma omp atomic write
+      failed = true;
+    } else {
+#pragma omp for
+      for (unsigned int j = 0; j < num_instances; ++j) {
+        kkw_transcript_t* transcript = scratch.transcript;
+        if (!opened[j]) {
+          // only the preprocessing is checked
+          seed_tree_expand(scratch.seeds, tree_leaf(instances, j), salt, j);
+          mpc_lowmc_kkw_prove(lowmc, NULL, p, party_seeds(&scratch), transcript);
+          kkw_hash_instance(lowmc, salt, j, transcript, scratch.seeds, kp->num_parties, NULL,
+                            h[j]);
+          continue;
+        }
+
+        const unsigned int q = hidden[j];
+        bool hidden_parties[KKW_MAX_PARTIES] = {false};
+        hidden_parties[q] = true;
+
+        unsigned char const* instance = sig + offsets[j];
+        instance += seed_tree_reconstruct(scratch.seeds, hidden_parties, instance, salt, j);
+        bool valid = true;
+        if (q != last) {
+          valid &= read_rows(lowmc, transcript->aux, lowmc->r, instance);
+          instance += lowmc->r * sbox_bytes;
+        }
+        mzd_row_from_char_array(FIRST_ROW(transcript->masked_key), instance, lowmc->k / 8,
+                                lowmc->k);
+        instance += lowmc->k / 8;
+        valid &= read_rows(lowmc, transcript->msgs[q], lowmc->r, instance);
+        instance += lowmc->r * sbox_bytes;
+
+        if (!valid || mpc_lowmc_kkw_verify(lowmc, p, public_key->pk, party_seeds(&scratch), q,
+                                           transcript)) {
+#pragma omp atomic write
+          failed = true;
+          continue;
+        }
+        kkw_hash_instance(lowmc, salt, j, transcript, scratch.seeds, q, instance, h[j]);
+        kkw_hash_online(lowmc, salt, j, transcript, tree_leaf(merkle, j));
+      }
+    }
+    kkw_scratch_clear(&scratch);
+  }
+  if (failed) {
+    goto out;
+  }
+
+  merkle_tree_verify(merkle, opened, sig + merkle_offset, salt);
+
+  unsigned char challenge[DIGEST_SIZE];
+  kkw_challenge(lowmc, kp, (unsigned char const(*)[DIGEST_SIZE])h, merkle, salt, public_key->pk,
+                msg, msglen, challenge);
+  res = memcmp(challenge, ch, DIGEST_SIZE) ? -1 : 0;
+
+out:
+  mzd_local_free(p);
+  free(offsets);
+  free(h);
+  tree_free(seeds);
+  tree_free(merkle);
+  tree_free(instances);
+  mzd_pool_reset();
+  return res;
+}
@@ -0,0 +1,47 @@
+#ifndef SIGNATURE_KKW_H
+#define SIGNATURE_KKW_H
+
+#include "signature_fis.h"
+
+/**
+ * Signatures with N-party proofs with preprocessing (KKW,
+ * https://eprint.iacr.org/2018/475.pdf) using the keys of the fis signatures.
+ *
+ * Each of num_instances instances preprocesses the masks of num_parties
+ * parties. The challenge opens the preprocessing of all but num_opened
+ * instances. For the remaining ones, the online phase is checked with the
+ * seeds of all but one party.
+ */
+typedef struct {
+  unsigned int num_parties;
+  unsigned int num_instances;
+  unsigned int num_opened;
+} kkw_parameters_t;
+
+/**
+ * Selects parameters with the same soundness as the repetition count of pp.
+ */
+void kkw_default_parameters(public_parameters_t const* pp, kkw_parameters_t* kp);
+
+/**
+ * Upper bound of the size of a signature.
+ */
+unsigned kkw_sig_max_size(public_parameters_t const* pp, kkw_parameters_t const* kp);
+
+/**
+ * Signs a message into sig, which has to hold kkw_sig_max_size bytes.
+ *
+ * \return the size of the signature or 0 on failure
+ */
+unsigned kkw_sign(public_parameters_t const* pp, kkw_parameters_t const* kp,
+                  fis_private_key_t const* private_key, const uint8_t* msg, size_t msglen,
+                  unsigned char* sig, unsigned siglen);
+
+/**
+ * \return 0 on success and a value != 0 otherwise
+ */
+int kkw_verify(public_parameters_t const* pp, kkw_parameters_t const* kp,
+               fis_public_key_t const* public_key, const uint8_t* msg, size_t msglen,
+               const unsigned char* sig, unsigned siglen);
+
+#endif
@@ -0,0 +1,337 @@
+#include "tree.h"
+
+#include <openssl/sha.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// prefixes of the hashes deriving seeds and Merkle nodes (see also the
+// prefixes in signature_kkw.c)
+#define HASH_PREFIX_SEED 0
+#define HASH_PREFIX_MERKLE 1
+
+static unsigned int tree_depth(unsigned int num_leaves) {
+  unsigned int depth = 0;
+  while ((1u << depth) < num_leaves) {
+    ++depth;
+  }
+  return depth;
+}
+
+tree_t* tree_init(unsigned int num_leaves, size_t node_size) {
+  const unsigned int depth     = tree_depth(num_leaves);
+  const unsigned int num_nodes = (2u << depth) - 1;
+  tree_t* tree = malloc(sizeof(tree_t) + num_nodes * (node_size + sizeof(bool)));
+  if (!tree) {
+    return NULL;
+  }
+
+  tree->num_leaves = num_leaves;
+  tree->depth      = depth;
+  tree->num_nodes  = num_nodes;
+  tree->node_size  = node_size;
+  tree->nodes      = (unsigned char*)(tree + 1);
+  tree->known      = (bool*)(tree->nodes + num_nodes * node_size);
+  memset(tree->known, 0, num_nodes * sizeof(bool));
+  return tree;
+}
+
+void tree_free(tree_t* tree) {
+  free(tree);
+}
+
+static unsigned char* tree_node(tree_t const* tree, unsigned int node) {
+  return tree->nodes + node * tree->node_size;
+}
+
+static unsigned int first_leaf(tree_t const* tree) {
+  return (1u << tree->depth) - 1;
+}
+
+unsigned char* tree_leaf(tree_t const* tree, unsigned int leaf) {
+  return tree_node(tree, first_leaf(tree) + leaf);
+}
+
+static bool node_exists(tree_t const* tree, unsigned int node) {
+  unsigned int level = 0;
+  while ((2u << level) - 1 <= node) {
+    ++level;
+  }
+  const unsigned int pos = node - ((1u << level) - 1);
+  return (pos << (tree->depth - level)) < tree->num_leaves;
+}
+
+static bool is_leaf(tree_t const* tree, unsigned int node) {
+  return node >= first_leaf(tree);
+}
+
+// Marks the nodes whose existing leaves are all not hidden.
+static void compute_full(tree_t const* tree, bool const* hidden, bool* full) {
+  const unsigned int leaves = first_leaf(tree);
+  for (unsigned int node = tree->num_nodes; node--;) {
+    if (!node_exists(tree, node)) {
+      full[node] = false;
+    } else if (node >= leaves) {
+      full[node] = !hidden[node - leaves];
+    } else {
+      const unsigned int left = 2 * node + 1, right = 2 * node + 2;
+      full[node]              = full[left] && (full[right] || !node_exists(tree, right));
+    }
+  }
+}
+
+static bool in_cover(bool const* full, unsigned int node) {
+  return full[node] && (!node || !full[(node - 1) / 2]);
+}
+
+unsigned int tree_cover_size(tree_t const* tree, bool const* hidden) {
+  bool full[tree->num_nodes];
+  compute_full(tree, hidden, full);
+
+  unsigned int count = 0;
+  for (unsigned int node = 0; node < tree->num_nodes; ++node) {
+    count += in_cover(full, node);
+  }
+  return count;
+}
+
+unsigned int tree_max_cover_size(unsigned int num_leaves, unsigned int count) {
+  if (!count) {
+    return 1;
+  }
+
+  const unsigned int depth = tree_depth(num_leaves);
+  // every node of the cover is a sibling of a node on the path to a hidden
+  // leaf and covers at least one of the other leaves
+  const unsigned int bound = count * depth;
+  return bound < num_leaves - count ? bound : num_leaves - count;
+}
+
+static void hash_node(SHA256_CTX* ctx, unsigned char prefix,
+                      const unsigned char salt[KKW_SALT_SIZE], unsigned int tree_index,
+                      unsigned int node) {
+  const uint32_t indices[2] = {tree_index, node};
+  SHA256_Init(ctx);
+  SHA256_Update(ctx, &prefix, sizeof(prefix));
+  SHA256_Update(ctx, salt, KKW_SALT_SIZE);
+  SHA256_Update(ctx, indices, sizeof(indices));
+}
+
+// Derives the seeds below the known nodes.
+static void seed_tree_derive(tree_t* tree, const unsigned char salt[KKW_SALT_SIZE],
+                             unsigned int tree_index) {
+  for (unsigned int node = 0; node < first_leaf(tree); ++node) {
+    if (!tree->known[node]) {
+      continue;
+    }
+
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    SHA256_CTX ctx;
+    hash_node(&ctx, HASH_PREFIX_SEED, salt, tree_index, node);
+    SHA256_Update(&ctx, tree_node(tree, node), KKW_SEED_SIZE);
+    SHA256_Final(digest, &ctx);
+
+    for (unsigned int c = 0; c < 2; ++c) {
+      const unsigned int child = 2 * node + 1 + c;
+      if (node_exists(tree, child)) {
+        memcpy(tree_node(tree, child), digest + c * KKW_SEED_SIZE, KKW_SEED_SIZE);
+        tree->known[child] = true;
+      }
+    }
+  }
+}
+
+void seed_tree_expand(tree_t* tree, const unsigned char root[KKW_SEED_SIZE],
+                      const unsigned char salt[KKW_SALT_SIZE], unsigned int tree_index) {
+  memset(tree->known, 0, tree->num_nodes * sizeof(bool));
+  memcpy(tree_node(tree, 0), root, KKW_SEED_SIZE);
+  tree->known[0] = true;
+  seed_tree_derive(tree, salt, tree_index);
+}
+
+size_t seed_tree_reveal(tree_t const* tree, bool const* hidden, unsigned char* dst) {
+  bool full[tree->num_nodes];
+  compute_full(tree, hidden, full);
+
+  unsigned char* temp = dst;
+  for (unsigned int node = 0; node < tree->num_nodes; ++node) {
+    if (in_cover(full, node)) {
+      memcpy(temp, tree_node(tree, node), KKW_SEED_SIZE);
+      temp += KKW_SEED_SIZE;
+    }
+  }
+  return temp - dst;
+}
+
+size_t seed_tree_reconstruct(tree_t* tree, bool const* hidden, unsigned char const* src,
+                             const unsigned char salt[KKW_SALT_SIZE], unsigned int tree_index) {
+  bool full[tree->num_nodes];
+  compute_full(tree, hidden, full);
+
+  unsigned char const* temp = src;
+  for (unsigned int node = 0; node < tree->num_nodes; ++node) {
+    tree->known[node] = in_cover(full, node);
+    if (tree->known[node]) {
+      memcpy(tree_node(tree, node), temp, KKW_SEED_SIZE);
+      temp += KKW_SEED_SIZE;
+    }
+  }
+
+  seed_tree_derive(tree, salt, tree_index);
+  return temp - src;
+}
+
+// Computes the nodes whose existing children are known.
+static void merkle_tree_derive(tree_t* tree, const unsigned char salt[KKW_SALT_SIZE]) {
+  for (unsigned int node = first_leaf(tree); node--;) {
+    if (tree->known[node] || !node_exists(tree, node)) {
+      continue;
+    }
+
+    const unsigned int left = 2 * node + 1, right = 2 * node + 2;
+    const bool has_right    = node_exists(tree, right);
+    if (!tree->known[left] || (has_right && !tree->known[right])) {
+      continue;
+    }
+
+    SHA256_CTX ctx;
+    hash_node(&ctx, HASH_PREFIX_MERKLE, salt, 0, node);
+    SHA256_Update(&ctx, tree_node(tree, left), tree->node_size);
+    if (has_right) {
+      SHA256_Update(&ctx, tree_node(tree, right), tree->node_size);
+    }
+    SHA256_Final(tree_node(tree, node), &ctx);
+    tree->known[node] = true;
+  }
+}
+
+void merkle_tree_build(tree_t* tree, const unsigned char salt[KKW_SALT_SIZE]) {
+  for (unsigned int node = 0; node < tree->num_nodes; ++node) {
+    tree->known[node] = is_leaf(tree, node) && node_exists(tree, node);
+  }
+  merkle_tree_derive(tree, salt);
+}
+
+size_t merkle_tree_open(tree_t const* tree, bool const* opened, unsigned char* dst) {
+  bool full[tree->num_nodes];
+  compute_full(tree, opened, full);
+
+  unsigned char* temp = dst;
+  for (unsigned int node = 0; node < tree->num_nodes; ++node) {
+    if (in_cover(full, node)) {
+      memcpy(temp, tree_node(tree, node), tree->node_size);
+      temp += tree->node_size;
+    }
+  }
+  return temp - dst;
+}
+
+size_t merkle_tree_verify(tree_t* tree, bool const* opened, unsigned char const* src,
+                          const unsigned char salt[KKW_SALT_SIZE]) {
+  bool full[tree->num_nodes];
+  compute_full(tree, opened, full);
+
+  unsigned char const* temp = src;
+  for (unsigned int node = 0; node < tree->num_nodes; ++node) {
+    tree->known[node] = is_leaf(tree, node) && node_exists(tree, node) &&
+                        opened[node - first_leaf(tree)];
+    if (in_cover(full, node)) {
+      memcpy(tree_node(tree, node), temp, tree->node_size);
+      temp += tree->node_size;
+      tree->known[node] = true;
+    }
+  }
+
+  merkle_tree_derive(tree, salt);
+  if (!tree->known[0]) {
+    // never compare against a stale root
+    memset(tree_node(tree, 0), 0, tree->node_size);
+  }
+  return temp - src;
+}
+
+// Collects the existing siblings of the nodes on the path from a leaf to the
+// root, starting at the leaf.
+static unsigned int path_siblings(tree_t const* tree, unsigned int leaf,
+                                  unsigned int siblings[32]) {
+  unsigned int count = 0;
+  for (unsigned int node = first_leaf(tree) + leaf; node; node = (node - 1) / 2) {
+    const unsigned int sibling = node & 1 ? node + 1 : node - 1;
+    if (node_exists(tree, sibling)) {
+      siblings[count++] = sibling;
+    }
+  }
+  return count;
+}
+
+size_t merkle_tree_open_leaf(tree_t const* tree, unsigned int leaf, unsigned char* dst) {
+  unsigned int siblings[32];
+  unsigned int count = path_siblings(tree, leaf, siblings);
+
+  // the nodes are written in the order of merkle_tree_open
+  unsigned char* temp = dst;
+  while (count--) {
+    memcpy(temp, tree_node(tree, siblings[count]), tree->node_size);
+    temp += tree->node_size;
+  }
+  return temp - dst;
+}
+
+size_t merkle_tree_leaf_path_size(unsigned int num_leaves, unsigned int leaf) {
+  if (leaf >= num_leaves) {
+    return 0;
+  }
+
+  tree_t shape;
+  shape.num_leaves = num_leaves;
+  shape.depth      = tree_depth(num_leaves);
+
+  unsigned int siblings[32];
+  return path_siblings(&shape, leaf, siblings) * SHA256_DIGEST_LENGTH;
+}
+
+size_t merkle_tree_verify_leaf(unsigned int num_leaves, unsigned int leaf,
+                               const unsigned char value[SHA256_DIGEST_LENGTH],
+                               unsigned char const* src, const unsigned char salt[KKW_SALT_SIZE],
+                               unsigned char root[SHA256_DIGEST_LENGTH]) {
+  if (leaf >= num_leaves) {
+    memset(root, 0, SHA256_DIGEST_LENGTH);
+    return 0;
+  }
+
+  // only the shape of the tree is needed
+  tree_t shape;
+  shape.num_leaves = num_leaves;
+  shape.depth      = tree_depth(num_leaves);
+
+  unsigned int siblings[32];
+  const unsigned int count = path_siblings(&shape, leaf, siblings);
+
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  memcpy(digest, value, sizeof(digest));
+
+  unsigned int next = 0;
+  for (unsigned int node = first_leaf(&shape) + leaf; node; node = (node - 1) / 2) {
+    const unsigned int sibling = node & 1 ? node + 1 : node - 1;
+    unsigned char const* sibling_value = NULL;
+    if (next < count && siblings[next] == sibling) {
+      sibling_value = src + (count - 1 - next++) * SHA256_DIGEST_LENGTH;
+    }
+
+    SHA256_CTX ctx;
+    hash_node(&ctx, HASH_PREFIX_MERKLE, salt, 0, (node - 1) / 2);
+    if (node & 1) {
+      SHA256_Update(&ctx, digest, sizeof(digest));
+      if (sibling_value) {
+        SHA256_Update(&ctx, sibling_value, SHA256_DIGEST_LENGTH);
+      }
+    } else {
+      SHA256_Update(&ctx, sibling_value, SHA256_DIGEST_LENGTH);
+      SHA256_Update(&ctx, digest, sizeof(digest));
+    }
+    SHA256_Final(digest, &ctx);
+  }
+
+  memcpy(root, digest, sizeof(digest));
+  return count * SHA256_DIGEST_LENGTH;
+}
@@ -0,0 +1,119 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parameters.h"
+
+/**
+ * Binary tree over num_leaves leaves, stored in heap order: the root is node
+ * 0 and the children of node i are 2i + 1 and 2i + 2. All leaves are on the
+ * same level. If num_leaves is not a power of two, the rightmost leaves and
+ * the nodes without any leaves below them do not exist.
+ *
+ * Seed trees derive the seeds of the leaves from the seed of the root. Hiding
+ * some leaves, the remaining ones are revealed with the roots of the maximal
+ * subtrees without hidden leaves. Merkle trees hash the leaves up to the
+ * root. Opening some leaves, the same kind of cover of the remaining leaves
+ * allows to recompute the root.
+ */
+typedef struct {
+  unsigned int num_leaves;
+  // level of the leaves, the root is on level 0
+  unsigned int depth;
+  unsigned int num_nodes;
+  size_t node_size;
+  unsigned char* nodes;
+  // set for the nodes whose value is known
+  bool* known;
+} tree_t;
+
+tree_t* tree_init(unsigned int num_leaves, size_t node_size);
+void tree_free(tree_t* tree);
+
+unsigned char* tree_leaf(tree_t const* tree, unsigned int leaf);
+
+/**
+ * Number of nodes needed to reveal all leaves but the hidden ones of a seed
+ * tree, or to open the leaves set in hidden of a Merkle tree.
+ */
+unsigned int tree_cover_size(tree_t const* tree, bool const* hidden);
+
+/**
+ * Upper bound of tree_cover_size for count hidden leaves.
+ */
+unsigned int tree_max_cover_size(unsigned int num_leaves, unsigned int count);
+
+/**
+ * Derives all seeds from the seed of the root. The salt and tree_index are
+ * bound to every derived seed.
+ */
+void seed_tree_expand(tree_t* tree, const unsigned char root[KKW_SEED_SIZE],
+                      const unsigned char salt[KKW_SALT_SIZE], unsigned int tree_index);
+
+/**
+ * Writes the seeds revealing all leaves except for the hidden ones.
+ *
+ * \return the number of bytes written
+ */
+size_t seed_tree_reveal(tree_t const* tree, bool const* hidden, unsigned char* dst);
+
+/**
+ * Inverse of seed_tree_reveal: reads the revealed seeds and derives the seeds
+ * of all leaves that are not hidden.
+ *
+ * \return the number of bytes read
+ */
+size_t seed_tree_reconstruct(tree_t* tree, bool const* hidden, unsigned char const* src,
+                             const unsigned char salt[KKW_SALT_SIZE], unsigned int tree_index);
+
+/**
+ * Computes the root from the leaves, which have to be set with tree_leaf.
+ */
+void merkle_tree_build(tree_t* tree, const unsigned char salt[KKW_SALT_SIZE]);
+
+/**
+ * Writes the nodes needed to recompute the root from the opened leaves.
+ *
+ * \return the number of bytes written
+ */
+size_t merkle_tree_open(tree_t const* tree, bool const* opened, unsigned char* dst);
+
+/**
+ * Recomputes the root from the opened leaves, which have to be set with
+ * tree_leaf, and the nodes written by merkle_tree_open.
+ *
+ * \return the number of bytes read
+ */
+size_t merkle_tree_verify(tree_t* tree, bool const* opened, unsigned char const* src,
+                          const unsigned char salt[KKW_SALT_SIZE]);
+
+/**
+ * merkle_tree_open for a single opened leaf without computing the cover.
+ */
+size_t merkle_tree_open_leaf(tree_t const* tree, unsigned int leaf, unsigned char* dst);
+
+/**
+ * Size of the nodes written by merkle_tree_open_leaf for a tree of num_leaves
+ * leaves with SHA-256 digests as nodes.
+ */
+size_t merkle_tree_leaf_path_size(unsigned int num_leaves, unsigned int leaf);
+
+/**
+ * Recomputes the root from a single opened leaf and the nodes written by
+ * merkle_tree_open_leaf without allocating the tree. The nodes have to be
+ * SHA-256 digests and src has to hold merkle_tree_leaf_path_size bytes.
+ *
+ * \return the number of bytes read
+ */
+size_t merkle_tree_verify_leaf(unsigned int num_leaves, unsigned int leaf,
+                               const unsigned char value[SHA256_DIGEST_LENGTH],
+                               unsigned char const* src, const unsigned char salt[KKW_SALT_SIZE],
+                               unsigned char root[SHA256_DIGEST_LENGTH]);
+
+static inline unsigned char const* tree_root(tree_t const* tree) {
+  return tree->nodes;
+}
+
+#endif